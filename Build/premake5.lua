@@ -81,6 +81,38 @@ workspace ("DestroyerOfWorlds")
                 libdirs { "lib/x64" }
                 targetdir ("bin/x64")
 		
+        project ("LoadGenerator")
+            kind ("ConsoleApp")
+            language ("C++")
+
+            includedirs
+            {
+                "../Code/network/include/",
+                "../Code/protocol/include/",
+                "../Code/core/include/"
+            }
+
+            files
+            {
+                "../Code/loadgen/src/**.cpp",
+            }
+
+            links
+            {
+                "Network",
+                "Protocol",
+                "Core",
+                "cryptopp"
+            }
+
+            filter { "architecture:*86" }
+                libdirs { "lib/x32" }
+                targetdir ("bin/x32")
+
+            filter { "architecture:*64" }
+                libdirs { "lib/x64" }
+                targetdir ("bin/x64")
+
     group ("Libraries")
         project ("Network")
             kind ("StaticLib")
@@ -21,15 +21,15 @@ public:
 
     virtual ~Allocator() {}
     virtual void* Allocate(size_t aSize) = 0;
+    // aAlignment must be a power of two, memory is released with Free like any other allocation
+    virtual void* Allocate(size_t aSize, size_t aAlignment) = 0;
     virtual void Free(void* apData) = 0;
     virtual size_t Size(void* apData) = 0;
 
     template<class T>
     T* New()
     {
-        static_assert(alignof(T) <= alignof(details::default_align_t));
-
-        auto pData = (T*)Allocate(sizeof(T));
+        auto pData = (T*)AllocateFor<T>();
         if (pData)
         {
             return new (pData) T();
@@ -41,9 +41,7 @@ public:
     template<class T, class... Args>
     T* New(Args... args)
     {
-        static_assert(alignof(T) <= alignof(details::default_align_t));
-
-        auto pData = (T*)Allocate(sizeof(T));
+        auto pData = (T*)AllocateFor<T>();
         if (pData)
         {
             return new (pData) T(std::forward<Args...>(args...));
@@ -69,6 +67,15 @@ public:
 
 private:
 
+    template<class T>
+    void* AllocateFor()
+    {
+        if constexpr (alignof(T) > alignof(details::default_align_t))
+            return Allocate(sizeof(T), alignof(T));
+        else
+            return Allocate(sizeof(T));
+    }
+
     enum
     {
         kMaxAllocatorCount = 1024
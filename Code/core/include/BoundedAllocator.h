@@ -1,17 +1,23 @@
 #pragma once
 
 #include "StandardAllocator.h"
+#include "MemoryBudget.h"
 
+// Standard allocator refusing allocations once its budget, or one of the parent budgets, is exhausted
 class BoundedAllocator : public StandardAllocator
 {
 public:
 
-    BoundedAllocator(size_t aMaximumAllocationSize);
+    BoundedAllocator(size_t aMaximumAllocationSize, MemoryBudget* apParentBudget = nullptr);
 
     virtual void* Allocate(size_t aSize) override;
+    virtual void* Allocate(size_t aSize, size_t aAlignment) override;
     virtual void Free(void* apData) override;
+    virtual size_t Size(void* apData) override;
+
+    MemoryBudget& GetBudget();
 
 private:
 
-    size_t m_availableMemory;
+    MemoryBudget m_budget;
 };
\ No newline at end of file
@@ -7,26 +7,49 @@ class Buffer : public AllocatorCompatible
 {
 public:
 
+    // Buffers up to this size live inside the object and never touch the allocator
+    static constexpr size_t InlineCapacity = 64;
+
     Buffer();
+    // When the allocator runs out the buffer is empty, GetSize is 0 and GetData is null
     Buffer(size_t aSize);
+    Buffer(size_t aSize, size_t aAlignment);
     Buffer(const Buffer& acBuffer);
     Buffer(Buffer&& aBuffer) noexcept;
     virtual ~Buffer();
 
-    uint8_t operator[](size_t aIndex) const;
-    uint8_t& operator[](size_t aIndex);
+    uint8_t operator[](size_t aIndex) const { return m_pData[aIndex]; }
+    uint8_t& operator[](size_t aIndex) { return m_pData[aIndex]; }
 
     Buffer& operator=(const Buffer& acBuffer);
     Buffer& operator=(Buffer&& aBuffer) noexcept;
 
-    size_t GetSize() const;
+    // Accessors are inline, readers and writers go through them for every field
+    size_t GetSize() const { return m_size; }
+    size_t GetAlignment() const { return m_alignment; }
+    bool IsInline() const { return m_pData == m_inline; }
+
+    const uint8_t* GetData() const { return m_pData; }
+    uint8_t* GetWriteData() { return m_pData; }
+
+    // Reallocates from the buffer's own allocator, the content is kept up to the new size
+    bool Resize(size_t aSize);
 
-    const uint8_t* GetData() const;
-    uint8_t* GetWriteData();
+    // Number of bits needed to store every value in [0, aMaximum]
+    static constexpr size_t BitCountFor(uint64_t aMaximum)
+    {
+        size_t count = 0;
+        while (count < 64 && (aMaximum >> count) != 0)
+            ++count;
+
+        return count;
+    }
 
     struct Cursor
     {
         Cursor(Buffer* apBuffer);
+        // Cursor over memory not owned by a Buffer, such as a BufferView
+        Cursor(const uint8_t* apData, size_t aSize);
 
         void Reset();
         bool Eof() const;
@@ -35,33 +58,103 @@ public:
 
         size_t GetBytePosition() const;
         size_t GetBitPosition() const;
-        size_t GetSize() const;
+        size_t GetSize() const { return m_pBuffer ? m_pBuffer->GetSize() : m_size; }
 
     protected:
 
+        const uint8_t* GetSourceData() const { return m_pBuffer ? m_pBuffer->GetData() : m_pData; }
+
         size_t m_bitPosition;
         Buffer* m_pBuffer;
+        const uint8_t* m_pData;
+        size_t m_size;
     };
 
     struct Reader : public Cursor
     {
         Reader(Buffer* apBuffer);
+        Reader(const uint8_t* apData, size_t aSize);
 
         bool ReadBits(uint64_t& aDestination, size_t aCount);
         bool ReadBytes(uint8_t* apDestination, size_t aCount);
+        // Reads aCount values of aBitCount bits each (at most 32), nothing is read if they don't all fit
+        bool ReadBitsArray(uint32_t* apDestination, size_t aCount, size_t aBitCount);
+
+        // Compact encodings, see the matching Writer functions
+        bool ReadVarint(uint64_t& aDestination);
+        bool ReadSignedVarint(int64_t& aDestination);
+        bool ReadRange(int64_t& aDestination, int64_t aMin, int64_t aMax);
+        bool ReadQuantized(float& aDestination, float aMin, float aMax, size_t aBitCount);
+        bool ReadVector(float (&aDestination)[3], float aMin, float aMax, size_t aBitCount);
+        bool ReadQuaternion(float (&aDestination)[4], size_t aBitCount);
     };
 
+    // Bits are gathered in a 64 bit scratch register and stored a word at a time
+    // Call Flush before reading the buffer while the writer is still alive, byte writes, cursor moves and the destructor flush on their own
+    // A growable writer resizes its buffer geometrically instead of failing, the buffer may then be larger than what was written
     struct Writer : public Cursor
     {
-        Writer(Buffer* apBuffer);
+        enum Mode
+        {
+            // The buffer is up to date after every call, it can be read while the writer is alive
+            kWriteThrough,
+            // Bits are gathered in a word and stored once it is full, on Flush or when the writer is destroyed
+            kBuffered
+        };
+
+        Writer(Buffer* apBuffer, bool aGrowable = false, Mode aMode = kWriteThrough);
         ~Writer();
 
+        void Reset();
+        void Advance(size_t aByteCount);
+        void Reverse(size_t aByteCount);
+        void Flush();
+
+        // Makes room for aByteCount more bytes at once, only growable writers can reserve
+        bool Reserve(size_t aByteCount);
+        bool IsGrowable() const;
+
         bool WriteBits(uint64_t aData, size_t aCount);
         bool WriteBytes(const uint8_t* apSource, size_t aCount);
+        // Same layout as one WriteBits call per value, aBitCount is at most 32
+        // Values are packed with SIMD kernels picked at runtime from the CPU features
+        bool WriteBitsArray(const uint32_t* apData, size_t aCount, size_t aBitCount);
+
+        // LEB128, 7 bits per byte, small values take a single byte
+        bool WriteVarint(uint64_t aData);
+        // Zigzag mapped varint, small negative values stay small
+        bool WriteSignedVarint(int64_t aData);
+        // Clamped to [aMin, aMax] and stored on as few bits as the range needs
+        bool WriteRange(int64_t aData, int64_t aMin, int64_t aMax);
+        // Clamped to [aMin, aMax] and quantized on aBitCount bits (at most 32)
+        bool WriteQuantized(float aData, float aMin, float aMax, size_t aBitCount);
+        bool WriteVector(const float (&acData)[3], float aMin, float aMax, size_t aBitCount);
+        // Unit quaternion as x, y, z, w, only the three smallest components are sent along with the index of the largest one
+        // Components are quantized on aBitCount bits (at most 20), the largest one is rebuilt from the others on read
+        bool WriteQuaternion(const float (&acData)[4], size_t aBitCount);
+
+    private:
+
+        bool Grow(size_t aRequiredSize);
+        // Checks that aBitCount more bits fit, growing the buffer if allowed
+        bool Ensure(size_t aBitCount);
+        // Unchecked WriteBits, aData must not have bits above aCount
+        void Append(uint64_t aData, size_t aCount);
+        // Stores the pending bits unless the writer is buffered
+        void Sync();
+
+        uint64_t m_scratch;
+        size_t m_scratchBits;
+        bool m_growable;
+        Mode m_mode;
     };
 
 private:
 
+    void Swap(Buffer& aBuffer) noexcept;
+
     uint8_t* m_pData;
     size_t m_size;
+    size_t m_alignment;
+    alignas(details::default_align_t) uint8_t m_inline[InlineCapacity];
 };
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "BufferView.h"
+
+// Packet made of separate views, typically a header block, payload slices and trailers
+// Segments are only referenced, headers can be prepended and trailers appended without moving the payload
+class BufferChain
+{
+public:
+
+    // Enough for a header, a few payload slices and a trailer, also well under every platform's iovec limit
+    static constexpr size_t MaxSegments = 8;
+
+    BufferChain() noexcept;
+
+    // Both return false when the chain is full, empty views are ignored
+    bool Append(const BufferView& acSegment) noexcept;
+    bool Prepend(const BufferView& acSegment) noexcept;
+    void Clear() noexcept;
+
+    const BufferView& operator[](size_t aIndex) const noexcept { return m_segments[aIndex]; }
+
+    size_t GetSegmentCount() const noexcept { return m_count; }
+    size_t GetSize() const noexcept { return m_size; }
+    bool IsEmpty() const noexcept { return m_size == 0; }
+
+    // Copies every segment into a single view, for transports that can't gather
+    BufferView Flatten() const noexcept;
+
+private:
+
+    BufferView m_segments[MaxSegments];
+    size_t m_count;
+    size_t m_size;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Buffer.h"
+
+#include <atomic>
+
+// Immutable, reference counted window over a Buffer
+// Copies and slices share the same storage, which is released with the last view
+class BufferView
+{
+public:
+
+    BufferView() noexcept;
+    BufferView(Buffer aBuffer) noexcept;
+    BufferView(const uint8_t* apData, size_t aSize) noexcept;
+    BufferView(const BufferView& acRhs) noexcept;
+    BufferView(BufferView&& aRhs) noexcept;
+    ~BufferView() noexcept;
+
+    BufferView& operator=(const BufferView& acRhs) noexcept;
+    BufferView& operator=(BufferView&& aRhs) noexcept;
+
+    // Shares the storage, the range is clamped to this view
+    BufferView Slice(size_t aOffset, size_t aSize) const noexcept;
+
+    const uint8_t* GetData() const noexcept { return m_pData; }
+    size_t GetSize() const noexcept { return m_size; }
+    bool IsEmpty() const noexcept { return m_size == 0; }
+    uint32_t GetUseCount() const noexcept;
+
+    Buffer::Reader GetReader() const noexcept;
+
+private:
+
+    struct Storage : AllocatorCompatible
+    {
+        Storage(Buffer aBuffer) noexcept;
+
+        std::atomic<uint32_t> RefCount;
+        Buffer Data;
+    };
+
+    void Adopt(Buffer aBuffer) noexcept;
+    void Release() noexcept;
+
+    Storage* m_pStorage;
+    const uint8_t* m_pData;
+    size_t m_size;
+};
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Allocator.h"
+
+// Bump allocator growing in chunks, meant for memory that only lives until the end of a tick
+class FrameArena : public Allocator
+{
+    struct Chunk;
+
+public:
+
+    struct Marker
+    {
+        Chunk* pChunk;
+        size_t Offset;
+    };
+
+    FrameArena(size_t aChunkSize = 1 << 16, Allocator* apParentAllocator = Allocator::GetDefault());
+    FrameArena(const FrameArena& acRhs) = delete;
+    virtual ~FrameArena();
+
+    FrameArena& operator=(const FrameArena& acRhs) = delete;
+
+    virtual void* Allocate(size_t aSize) override;
+    virtual void* Allocate(size_t aSize, size_t aAlignment) override;
+    virtual void Free(void* apData) override;
+    virtual size_t Size(void* apData) override;
+
+    Marker GetMarker() const;
+    void RewindTo(const Marker& acMarker);
+    void Reset();
+
+    size_t GetCapacity() const;
+
+private:
+
+    struct Chunk
+    {
+        Chunk* pNext;
+        size_t Size;
+    };
+
+    void* TryAllocate(Chunk* apChunk, size_t aOffset, size_t aSize, size_t aAlignment);
+    Chunk* AllocateChunk(size_t aSize);
+
+    size_t m_chunkSize;
+    size_t m_offset;
+    Chunk* m_pFirstChunk;
+    Chunk* m_pCurrentChunk;
+    Allocator* m_pParentAllocator;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Meta.h"
+
+#include <atomic>
+
+// Thread safe memory accounting, a reservation must fit in this budget and in all of its parents
+class MemoryBudget
+{
+public:
+
+    static constexpr size_t cUnlimited = ~size_t(0);
+
+    MemoryBudget(size_t aLimit = cUnlimited, MemoryBudget* apParent = nullptr) noexcept;
+    MemoryBudget(const MemoryBudget& acRhs) = delete;
+    ~MemoryBudget() noexcept;
+
+    MemoryBudget& operator=(const MemoryBudget& acRhs) = delete;
+
+    bool Reserve(size_t aSize) noexcept;
+    void Release(size_t aSize) noexcept;
+
+    size_t GetLimit() const noexcept;
+    size_t GetUsed() const noexcept;
+    size_t GetAvailable() const noexcept;
+    size_t GetPeak() const noexcept;
+    size_t GetDeniedCount() const noexcept;
+    MemoryBudget* GetParent() const noexcept;
+
+private:
+
+    size_t m_limit;
+    MemoryBudget* m_pParent;
+    std::atomic<size_t> m_used;
+    std::atomic<size_t> m_peak;
+    std::atomic<size_t> m_deniedCount;
+};
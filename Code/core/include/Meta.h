@@ -6,6 +6,10 @@
 #include <cstddef>
 #include <functional>
 
+#if defined(_WIN64) && !defined(__SIZEOF_INT128__)
+#include <intrin.h>
+#endif
+
 
 using std::size_t;
 
@@ -48,8 +52,33 @@ namespace details
 #endif
 }
 
+constexpr size_t cCacheLineSize = 64;
+
 template<class T>
 void hash_combine(size_t& aSeed, const T& aValue)
 {
     aSeed ^= std::hash<T>()(aValue) + 0x9e3779b9 + (aSeed << 6) + (aSeed >> 2);
 }
+
+// Folds the 128 bit product of two words, a cheap mixing step with a good avalanche for hashes
+inline uint64_t hash_mix(uint64_t aLhs, uint64_t aRhs)
+{
+#if defined(__SIZEOF_INT128__)
+    const __uint128_t cProduct = __uint128_t(aLhs) * aRhs;
+    return uint64_t(cProduct) ^ uint64_t(cProduct >> 64);
+#elif defined(_WIN64)
+    uint64_t high = 0;
+    const uint64_t cLow = _umul128(aLhs, aRhs, &high);
+    return cLow ^ high;
+#else
+    const uint64_t cLowLow = (aLhs & 0xFFFFFFFF) * (aRhs & 0xFFFFFFFF);
+    const uint64_t cHighLow = (aLhs >> 32) * (aRhs & 0xFFFFFFFF);
+    const uint64_t cLowHigh = (aLhs & 0xFFFFFFFF) * (aRhs >> 32);
+    const uint64_t cHighHigh = (aLhs >> 32) * (aRhs >> 32);
+    const uint64_t cMiddle = (cLowLow >> 32) + (cHighLow & 0xFFFFFFFF) + cLowHigh;
+
+    const uint64_t cLow = (cMiddle << 32) | (cLowLow & 0xFFFFFFFF);
+    const uint64_t cHigh = cHighHigh + (cHighLow >> 32) + (cMiddle >> 32);
+    return cLow ^ cHigh;
+#endif
+}
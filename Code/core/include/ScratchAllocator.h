@@ -10,6 +10,7 @@ public:
     virtual ~ScratchAllocator();
 
     virtual void* Allocate(size_t aSize) override;
+    virtual void* Allocate(size_t aSize, size_t aAlignment) override;
     virtual void Free(void* apData) override;
     virtual size_t Size(void* apData) override;
 
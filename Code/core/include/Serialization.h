@@ -0,0 +1,243 @@
+#pragma once
+
+#include "Buffer.h"
+
+#include <algorithm>
+#include <type_traits>
+
+// Declarative bit packing, a schema lists the fields of a struct with the codec used for each of them
+// Schemas of up to 64 bits are packed in a single word and written or read with a single bit stream call
+//
+//     using PositionSchema = Serialization::Schema<
+//         Serialization::Field<&Position::Cell, Serialization::Range<0, 1023>>,
+//         Serialization::Field<&Position::Height, Serialization::Quantized<-100, 100, 12>>>;
+//
+//     PositionSchema::Write(writer, position);
+namespace Serialization
+{
+    namespace details
+    {
+        constexpr uint64_t Mask(size_t aBitCount)
+        {
+            return aBitCount < 64 ? (uint64_t(1) << aBitCount) - 1 : ~uint64_t(0);
+        }
+
+        template<class T>
+        struct MemberTraits;
+
+        template<class C, class M>
+        struct MemberTraits<M C::*>
+        {
+            using Class = C;
+            using Member = M;
+        };
+    }
+
+    // Unsigned integer stored on Count bits, higher bits are dropped
+    template<size_t Count>
+    struct Bits
+    {
+        static_assert(Count > 0 && Count <= 64);
+        static constexpr size_t BitCount = Count;
+
+        template<class T>
+        static uint64_t Encode(const T& acValue)
+        {
+            return uint64_t(acValue) & details::Mask(Count);
+        }
+
+        template<class T>
+        static void Decode(T& aValue, uint64_t aBits)
+        {
+            aValue = T(aBits);
+        }
+    };
+
+    // Integer clamped to [Min, Max] and stored as its offset from Min on as few bits as the range needs
+    template<int64_t Min, int64_t Max>
+    struct Range
+    {
+        static_assert(Min < Max);
+        static constexpr size_t BitCount = Buffer::BitCountFor(uint64_t(Max - Min));
+
+        template<class T>
+        static uint64_t Encode(const T& acValue)
+        {
+            const int64_t cValue = std::min<int64_t>(std::max<int64_t>(int64_t(acValue), Min), Max);
+            return uint64_t(cValue - Min);
+        }
+
+        template<class T>
+        static void Decode(T& aValue, uint64_t aBits)
+        {
+            aValue = T(int64_t(aBits) + Min);
+        }
+    };
+
+    // Float clamped to [Min, Max] and quantized on Count bits, the error is at most half a step of (Max - Min) / (2^Count - 1)
+    // Steps are counted in double, a float can't hold them past 24 bits and Max would round to 2^Count
+    template<int64_t Min, int64_t Max, size_t Count>
+    struct Quantized
+    {
+        static_assert(Min < Max && Count > 0 && Count <= 32);
+        static constexpr size_t BitCount = Count;
+        static constexpr double Steps = double(details::Mask(Count));
+        static constexpr double Range = double(Max) - double(Min);
+
+        template<class T>
+        static uint64_t Encode(const T& acValue)
+        {
+            const double cValue = std::min(std::max(double(acValue), double(Min)), double(Max));
+            return std::min(uint64_t((cValue - double(Min)) / Range * Steps + 0.5), details::Mask(Count));
+        }
+
+        template<class T>
+        static void Decode(T& aValue, uint64_t aBits)
+        {
+            aValue = T(double(aBits) / Steps * Range + double(Min));
+        }
+    };
+
+    // Fixed size byte array, such as a signature
+    template<size_t Count>
+    struct Bytes
+    {
+        static constexpr size_t BitCount = Count * 8;
+
+        template<class T>
+        static uint64_t Encode(const T& acValue)
+        {
+            static_assert(Count <= 8, "Byte arrays larger than a word can't be packed");
+
+            uint64_t bits = 0;
+            for (size_t i = 0; i < Count; ++i)
+                bits |= uint64_t(uint8_t(acValue[i])) << (i * 8);
+
+            return bits;
+        }
+
+        template<class T>
+        static void Decode(T& aValue, uint64_t aBits)
+        {
+            for (size_t i = 0; i < Count; ++i)
+                aValue[i] = std::remove_reference_t<decltype(aValue[i])>(uint8_t(aBits >> (i * 8)));
+        }
+
+        template<class T>
+        static bool Write(Buffer::Writer& aWriter, const T& acValue)
+        {
+            bool result = true;
+            for (size_t i = 0; i < Count; ++i)
+                result &= aWriter.WriteBits(uint8_t(acValue[i]), 8);
+
+            return result;
+        }
+
+        template<class T>
+        static bool Read(Buffer::Reader& aReader, T& aValue)
+        {
+            bool result = true;
+            for (size_t i = 0; i < Count; ++i)
+            {
+                uint64_t byte = 0;
+                result &= aReader.ReadBits(byte, 8);
+                aValue[i] = std::remove_reference_t<decltype(aValue[i])>(uint8_t(byte));
+            }
+
+            return result;
+        }
+    };
+
+    // Binds a codec to a data member
+    template<auto Member, class Codec>
+    struct Field
+    {
+        using Class = typename details::MemberTraits<decltype(Member)>::Class;
+        static constexpr size_t BitCount = Codec::BitCount;
+
+        static uint64_t Encode(const Class& acValue)
+        {
+            return Codec::Encode(acValue.*Member);
+        }
+
+        static void Decode(Class& aValue, uint64_t aBits)
+        {
+            Codec::Decode(aValue.*Member, aBits);
+        }
+
+        static bool Write(Buffer::Writer& aWriter, const Class& acValue)
+        {
+            if constexpr (BitCount > 64)
+                return Codec::Write(aWriter, acValue.*Member);
+            else
+                return aWriter.WriteBits(Encode(acValue), BitCount);
+        }
+
+        static bool Read(Buffer::Reader& aReader, Class& aValue)
+        {
+            if constexpr (BitCount > 64)
+            {
+                return Codec::Read(aReader, aValue.*Member);
+            }
+            else
+            {
+                uint64_t bits = 0;
+                const bool cResult = aReader.ReadBits(bits, BitCount);
+                Decode(aValue, bits);
+                return cResult;
+            }
+        }
+    };
+
+    template<class First, class... Fields>
+    struct Schema
+    {
+        using Class = typename First::Class;
+
+        static constexpr size_t BitCount = (First::BitCount + ... + Fields::BitCount);
+        static constexpr size_t ByteCount = (BitCount + 7) / 8;
+
+        static bool Write(Buffer::Writer& aWriter, const Class& acValue)
+        {
+            if constexpr (BitCount <= 64)
+            {
+                // Fields are shifted in place at compile time known offsets and written at once
+                // Each one is masked to its width, a codec going past it would corrupt the next field
+                uint64_t word = 0;
+                size_t offset = 0;
+                ((word |= (First::Encode(acValue) & details::Mask(First::BitCount)) << offset, offset += First::BitCount));
+                ((word |= (Fields::Encode(acValue) & details::Mask(Fields::BitCount)) << offset, offset += Fields::BitCount), ...);
+
+                return aWriter.WriteBits(word, BitCount);
+            }
+            else
+            {
+                bool result = First::Write(aWriter, acValue);
+                ((result &= Fields::Write(aWriter, acValue)), ...);
+                return result;
+            }
+        }
+
+        // On failure the fields that could not be read are left zeroed
+        static bool Read(Buffer::Reader& aReader, Class& aValue)
+        {
+            if constexpr (BitCount <= 64)
+            {
+                uint64_t word = 0;
+                const bool cResult = aReader.ReadBits(word, BitCount);
+
+                First::Decode(aValue, word & details::Mask(First::BitCount));
+                size_t offset = First::BitCount;
+                ((Fields::Decode(aValue, (word >> offset) & details::Mask(Fields::BitCount)), offset += Fields::BitCount), ...);
+
+                return cResult;
+            }
+            else
+            {
+                bool result = First::Read(aReader, aValue);
+                ((result &= Fields::Read(aReader, aValue)), ...);
+                return result;
+            }
+        }
+    };
+}
\ No newline at end of file
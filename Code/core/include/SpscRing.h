@@ -0,0 +1,137 @@
+#pragma once
+
+#include "Allocator.h"
+#include "Meta.h"
+
+#include <atomic>
+#include <new>
+#include <utility>
+
+// Bounded queue between exactly one producer thread and one consumer thread, neither side ever waits or locks
+// The capacity is rounded up to a power of two, the indices only grow and are masked on access
+// Each side keeps its own copy of the other's index and only reloads it when the ring looks full or empty
+template<class T>
+class SpscRing : public AllocatorCompatible
+{
+public:
+
+    SpscRing(size_t aCapacity) noexcept;
+    SpscRing(const SpscRing&) = delete;
+    ~SpscRing() noexcept;
+
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side, fails when full and aValue is left untouched
+    bool Push(T&& aValue) noexcept;
+    // Consumer side, fails when empty
+    bool Pop(T& aValue) noexcept;
+
+    // Only exact when both sides are idle
+    bool IsEmpty() const noexcept;
+    size_t GetCapacity() const noexcept;
+
+private:
+
+    static size_t RoundCapacity(size_t aCapacity) noexcept;
+
+    T* m_pEntries;
+    size_t m_mask;
+
+    // Written by the consumer
+    alignas(cCacheLineSize) std::atomic<size_t> m_head;
+    size_t m_cachedTail;
+
+    // Written by the producer
+    alignas(cCacheLineSize) std::atomic<size_t> m_tail;
+    size_t m_cachedHead;
+};
+
+template<class T>
+SpscRing<T>::SpscRing(size_t aCapacity) noexcept
+    : m_pEntries((T*)GetAllocator()->Allocate(sizeof(T) * RoundCapacity(aCapacity), alignof(T)))
+    , m_mask(RoundCapacity(aCapacity) - 1)
+    , m_head(0)
+    , m_cachedTail(0)
+    , m_tail(0)
+    , m_cachedHead(0)
+{
+    if (m_pEntries == nullptr)
+        m_mask = 0;
+}
+
+template<class T>
+SpscRing<T>::~SpscRing() noexcept
+{
+    if (m_pEntries == nullptr)
+        return;
+
+    const size_t cTail = m_tail.load(std::memory_order_acquire);
+    for (size_t i = m_head.load(std::memory_order_relaxed); i != cTail; ++i)
+        m_pEntries[i & m_mask].~T();
+
+    GetAllocator()->Free(m_pEntries);
+}
+
+template<class T>
+bool SpscRing<T>::Push(T&& aValue) noexcept
+{
+    if (m_pEntries == nullptr)
+        return false;
+
+    const size_t cTail = m_tail.load(std::memory_order_relaxed);
+
+    if (cTail - m_cachedHead > m_mask)
+    {
+        m_cachedHead = m_head.load(std::memory_order_acquire);
+        if (cTail - m_cachedHead > m_mask)
+            return false;
+    }
+
+    new (&m_pEntries[cTail & m_mask]) T(std::move(aValue));
+    m_tail.store(cTail + 1, std::memory_order_release);
+
+    return true;
+}
+
+template<class T>
+bool SpscRing<T>::Pop(T& aValue) noexcept
+{
+    const size_t cHead = m_head.load(std::memory_order_relaxed);
+
+    if (cHead == m_cachedTail)
+    {
+        m_cachedTail = m_tail.load(std::memory_order_acquire);
+        if (cHead == m_cachedTail)
+            return false;
+    }
+
+    T& entry = m_pEntries[cHead & m_mask];
+    aValue = std::move(entry);
+    entry.~T();
+
+    m_head.store(cHead + 1, std::memory_order_release);
+
+    return true;
+}
+
+template<class T>
+bool SpscRing<T>::IsEmpty() const noexcept
+{
+    return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+}
+
+template<class T>
+size_t SpscRing<T>::GetCapacity() const noexcept
+{
+    return m_pEntries ? m_mask + 1 : 0;
+}
+
+template<class T>
+size_t SpscRing<T>::RoundCapacity(size_t aCapacity) noexcept
+{
+    size_t capacity = 1;
+    while (capacity < aCapacity)
+        capacity <<= 1;
+
+    return capacity;
+}
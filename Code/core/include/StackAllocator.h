@@ -12,6 +12,7 @@ public:
     virtual ~StackAllocator();
 
     virtual void* Allocate(size_t aSize) override;
+    virtual void* Allocate(size_t aSize, size_t aAlignment) override;
     virtual void Free(void* apData) override;
     virtual size_t Size(void* apData) override;
 
@@ -37,7 +38,13 @@ StackAllocator<Bytes>::~StackAllocator()
 template <size_t Bytes>
 void* StackAllocator<Bytes>::Allocate(size_t aSize)
 {
-    if (std::align(alignof(std::max_align_t), aSize, m_pCursor, m_size))
+    return Allocate(aSize, alignof(std::max_align_t));
+}
+
+template <size_t Bytes>
+void* StackAllocator<Bytes>::Allocate(size_t aSize, size_t aAlignment)
+{
+    if (std::align(aAlignment, aSize, m_pCursor, m_size))
     {
         void* pResult = m_pCursor;
         m_pCursor = (char*)m_pCursor + aSize;
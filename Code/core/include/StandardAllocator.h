@@ -7,6 +7,7 @@ class StandardAllocator : public Allocator
 public:
 
     virtual void* Allocate(size_t aSize) override;
+    virtual void* Allocate(size_t aSize, size_t aAlignment) override;
     virtual void Free(void* apData) override;
     virtual size_t Size(void* apData) override;
 };
\ No newline at end of file
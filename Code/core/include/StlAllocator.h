@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Allocator.h"
+
+#include <cstdlib>
+
+// Standard conforming allocator forwarding to an Allocator, the allocator is captured from the scoped stack by default
+template<class T>
+class StlAllocator
+{
+public:
+
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    StlAllocator() noexcept
+        : m_pAllocator{ Allocator::Get() }
+    {}
+
+    StlAllocator(Allocator* apAllocator) noexcept
+        : m_pAllocator{ apAllocator }
+    {}
+
+    template<class U>
+    StlAllocator(const StlAllocator<U>& acRhs) noexcept
+        : m_pAllocator{ acRhs.GetAllocator() }
+    {}
+
+    // Containers can't be told about a failure without exceptions and would dereference null, the process stops instead
+    T* allocate(size_t aCount)
+    {
+        void* pData;
+        if constexpr (alignof(T) > alignof(details::default_align_t))
+            pData = m_pAllocator->Allocate(aCount * sizeof(T), alignof(T));
+        else
+            pData = m_pAllocator->Allocate(aCount * sizeof(T));
+
+        if (pData == nullptr)
+            std::abort();
+
+        return (T*)pData;
+    }
+
+    void deallocate(T* apData, size_t aCount) noexcept
+    {
+        (void)aCount;
+        m_pAllocator->Free(apData);
+    }
+
+    // Copies behave like Buffer copies and pick the allocator of the current scope
+    StlAllocator select_on_container_copy_construction() const noexcept
+    {
+        return StlAllocator();
+    }
+
+    Allocator* GetAllocator() const noexcept
+    {
+        return m_pAllocator;
+    }
+
+    template<class U>
+    bool operator==(const StlAllocator<U>& acRhs) const noexcept
+    {
+        return m_pAllocator == acRhs.GetAllocator();
+    }
+
+    template<class U>
+    bool operator!=(const StlAllocator<U>& acRhs) const noexcept
+    {
+        return m_pAllocator != acRhs.GetAllocator();
+    }
+
+private:
+
+    Allocator* m_pAllocator;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Runs fixed length ticks at a constant rate from a monotonic nanosecond clock
+// Deadlines are computed from the start time and the tick number, rounding never accumulates into drift
+// After a stall the due ticks run back to back up to a limit, older ones are dropped to get back on schedule
+class TickScheduler
+{
+public:
+
+    static constexpr uint32_t DefaultMaxCatchUpTicks = 5;
+
+    struct Stats
+    {
+        uint64_t TickCount;
+        // Dropped after stalls longer than the catch up limit
+        uint64_t SkippedCount;
+        // Ticks that took longer than a period to run
+        uint64_t OverrunCount;
+        uint64_t MinNanoseconds;
+        uint64_t MaxNanoseconds;
+        uint64_t TotalNanoseconds;
+        // Longest delay between a tick's deadline and the moment it started
+        uint64_t MaxLatenessNanoseconds;
+    };
+
+    // The schedule starts at construction, the first tick is due one period later
+    TickScheduler(uint32_t aTicksPerSecond, uint32_t aMaxCatchUpTicks = DefaultMaxCatchUpTicks) noexcept;
+
+    // Nanoseconds from an arbitrary origin, never goes back
+    static uint64_t Now() noexcept;
+
+    void Reset(uint64_t aNow) noexcept;
+
+    uint32_t GetTicksPerSecond() const noexcept;
+    uint64_t GetNextDeadline() const noexcept;
+    // Zero once the next tick is due
+    uint64_t GetTimeUntilNextTick(uint64_t aNow) const noexcept;
+
+    // Calls aTick(aElapsedMilliseconds) for each tick due at aNow and returns how many ran
+    // Elapsed times are whole milliseconds adding up to the scheduled time, at 60Hz they alternate between 16 and 17
+    template<class T>
+    uint32_t RunDue(uint64_t aNow, T&& aTick) noexcept;
+
+    const Stats& GetStats() const noexcept;
+    uint64_t GetMeanNanoseconds() const noexcept;
+    void ResetStats() noexcept;
+
+private:
+
+    // Rounded up, a tick is never due before its exact time
+    uint64_t GetDeadline(uint64_t aTick) const noexcept;
+    // Milliseconds from the start to a tick, rounded down
+    uint64_t GetTickMilliseconds(uint64_t aTick) const noexcept;
+    // Drops what can't be caught up and returns the number of ticks to run
+    uint32_t CollectDue(uint64_t aNow) noexcept;
+    void Record(uint64_t aDeadline, uint64_t aStart, uint64_t aEnd) noexcept;
+
+    uint64_t m_start;
+    // Ticks run or skipped since the start
+    uint64_t m_tick;
+    uint32_t m_ticksPerSecond;
+    uint32_t m_maxCatchUpTicks;
+    Stats m_stats;
+};
+
+template<class T>
+uint32_t TickScheduler::RunDue(uint64_t aNow, T&& aTick) noexcept
+{
+    const uint32_t cCount = CollectDue(aNow);
+
+    for (uint32_t i = 0; i < cCount; ++i)
+    {
+        ++m_tick;
+
+        const uint64_t cElapsed = GetTickMilliseconds(m_tick) - GetTickMilliseconds(m_tick - 1);
+        const uint64_t cStart = Now();
+
+        aTick(cElapsed);
+
+        Record(GetDeadline(m_tick), cStart, Now());
+    }
+
+    return cCount;
+}
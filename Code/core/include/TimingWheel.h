@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Allocator.h"
+#include "StlAllocator.h"
+
+#include <functional>
+#include <vector>
+
+// Hierarchical timing wheel, scheduling and cancelling are O(1) and advancing only touches timers that fire or cascade
+// Level 0 has one slot per tick, each following level has slots 64 times wider, deadlines past the last level wait in an overflow list
+// Timers are stored in a pool sized at construction, ids are reused once a timer fired or was cancelled
+class TimingWheel : public AllocatorCompatible
+{
+public:
+
+    using TimerId = uint32_t;
+
+    static constexpr TimerId cInvalidTimer = UINT32_MAX;
+    static constexpr size_t SlotBits = 6;
+    static constexpr size_t SlotCount = 1 << SlotBits;
+    static constexpr size_t LevelCount = 4;
+
+    TimingWheel(size_t aCapacity);
+    TimingWheel(const TimingWheel&) = delete;
+
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    // Fires after aDelay ticks, a delay of 0 fires on the next tick, returns cInvalidTimer when the pool is exhausted
+    TimerId Schedule(uint64_t aDelay, uint64_t aUserData);
+    bool Cancel(TimerId aTimer);
+    bool IsScheduled(TimerId aTimer) const;
+
+    // Moves time forward, expired timers are released before the callback so it can schedule again
+    // Timers fire in deadline order and GetTime returns their deadline while the callback runs
+    size_t Advance(uint64_t aTicks, const std::function<void(uint64_t aUserData)>& acCallback);
+
+    uint64_t GetTime() const;
+    size_t GetCount() const;
+    size_t GetCapacity() const;
+
+private:
+
+    static constexpr uint32_t cNone = UINT32_MAX;
+    static constexpr uint16_t cOverflow = LevelCount * SlotCount;
+    static constexpr uint16_t cFree = cOverflow + 1;
+
+    struct Timer
+    {
+        uint64_t Deadline;
+        uint64_t UserData;
+        uint32_t Next;
+        uint32_t Previous;
+        uint16_t Bucket;
+    };
+
+    void Link(uint32_t aIndex);
+    void Unlink(uint32_t aIndex);
+    void Cascade(uint16_t aBucket);
+    size_t Expire(uint16_t aBucket, const std::function<void(uint64_t aUserData)>& acCallback);
+
+    std::vector<Timer, StlAllocator<Timer>> m_timers;
+    uint32_t m_heads[LevelCount * SlotCount + 1];
+    uint64_t m_occupied[LevelCount];
+    uint32_t m_freeHead;
+    uint64_t m_time;
+    size_t m_count;
+};
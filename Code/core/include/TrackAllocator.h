@@ -19,9 +19,20 @@ public:
         return pData;
     }
 
+    virtual void* Allocate(size_t aSize, size_t aAlignment) override
+    {
+        void* pData = m_allocator.Allocate(aSize, aAlignment);
+
+        if (pData)
+            m_usedMemory += m_allocator.Size(pData);
+
+        return pData;
+    }
+
     virtual void Free(void* apData) override
     {
         m_usedMemory -= m_allocator.Size(apData);
+        m_allocator.Free(apData);
     }
 
     virtual size_t Size(void* apData) override
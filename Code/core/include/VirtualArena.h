@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Allocator.h"
+
+// Bump allocator over a single reserved range of address space, pages are committed as the arena grows
+// Huge pages are used when the system provides them so that hot packet memory stays contiguous and TLB friendly
+class VirtualArena : public Allocator
+{
+public:
+
+    enum PageMode
+    {
+        kRegularPages,
+        // Only a hint, the kernel backs the range with huge pages when it can and they are never pinned
+        kTransparentHugePages,
+        // Taken from the reserved huge page pool first, they stay pinned for the lifetime of the arena
+        kHugePages
+    };
+
+    VirtualArena(size_t aReservedSize, PageMode aPageMode = kTransparentHugePages);
+    VirtualArena(const VirtualArena& acRhs) = delete;
+    virtual ~VirtualArena();
+
+    VirtualArena& operator=(const VirtualArena& acRhs) = delete;
+
+    virtual void* Allocate(size_t aSize) override;
+    virtual void* Allocate(size_t aSize, size_t aAlignment) override;
+    virtual void Free(void* apData) override;
+    virtual size_t Size(void* apData) override;
+
+    // Commits and touches the first aSize bytes so the first ticks don't pay for page faults
+    bool Prefault(size_t aSize);
+    void Reset();
+
+    bool IsValid() const;
+    bool UsesHugePages() const;
+    size_t GetReservedSize() const;
+    size_t GetCommittedSize() const;
+    size_t GetPageSize() const;
+
+private:
+
+    bool Commit(size_t aSize);
+
+    char* m_pBase;
+    size_t m_reservedSize;
+    size_t m_committedSize;
+    size_t m_offset;
+    size_t m_pageSize;
+    bool m_hugePages;
+};
\ No newline at end of file
@@ -1,26 +1,74 @@
 #include "BoundedAllocator.h"
 
+// Every block starts with a header remembering the requested size, so Free gives back exactly what Allocate took
+struct AllocationHeader
+{
+    size_t Size;
+    size_t Offset;
+};
+
+static constexpr size_t cHeaderSize = (sizeof(AllocationHeader) + alignof(details::default_align_t) - 1) & ~(alignof(details::default_align_t) - 1);
+
+static AllocationHeader* GetHeader(void* apData)
+{
+    return (AllocationHeader*)((char*)apData - sizeof(AllocationHeader));
+}
 
-BoundedAllocator::BoundedAllocator(size_t aMaximumAllocationSize)
-    : m_availableMemory{aMaximumAllocationSize}
+
+BoundedAllocator::BoundedAllocator(size_t aMaximumAllocationSize, MemoryBudget* apParentBudget)
+    : m_budget{ aMaximumAllocationSize, apParentBudget }
 {
 
 }
 
 void* BoundedAllocator::Allocate(size_t aSize)
 {
-    if (m_availableMemory >= aSize)
+    return Allocate(aSize, alignof(details::default_align_t));
+}
+
+void* BoundedAllocator::Allocate(size_t aSize, size_t aAlignment)
+{
+    if (!m_budget.Reserve(aSize))
+        return nullptr;
+
+    // The header takes a whole alignment step so the data keeps the requested alignment
+    const size_t cOffset = aAlignment > cHeaderSize ? aAlignment : cHeaderSize;
+
+    auto pBase = (char*)StandardAllocator::Allocate(cOffset + aSize, aAlignment);
+    if (pBase == nullptr)
     {
-        m_availableMemory -= aSize;
-        return StandardAllocator::Allocate(aSize);
+        m_budget.Release(aSize);
+        return nullptr;
     }
 
-    return nullptr;
+    auto pData = pBase + cOffset;
+    auto pHeader = GetHeader(pData);
+    pHeader->Size = aSize;
+    pHeader->Offset = cOffset;
+
+    return pData;
 }
 
 void BoundedAllocator::Free(void* apData)
 {
-    m_availableMemory += Size(apData);
+    if (apData == nullptr)
+        return;
+
+    auto pHeader = GetHeader(apData);
+    m_budget.Release(pHeader->Size);
+
+    StandardAllocator::Free((char*)apData - pHeader->Offset);
+}
+
+size_t BoundedAllocator::Size(void* apData)
+{
+    if (apData == nullptr)
+        return m_budget.GetAvailable();
 
-    StandardAllocator::Free(apData);
+    return GetHeader(apData)->Size;
+}
+
+MemoryBudget& BoundedAllocator::GetBudget()
+{
+    return m_budget;
 }
@@ -1,24 +1,213 @@
 #include "Buffer.h"
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BUFFER_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define BUFFER_TARGET_AVX2
+#else
+#define BUFFER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Largest value the three smallest components of a unit quaternion can take, 1 / sqrt(2)
+static constexpr float s_quaternionBound = 0.70710678f;
+
+// Computed in double, a float can't hold 2^24 - 1 steps and the top of the range would round past the mask
+static uint64_t Quantize(float aValue, float aMin, float aMax, size_t aBitCount)
+{
+    const uint64_t cMask = (uint64_t(1) << aBitCount) - 1;
+    const double cValue = std::min(std::max(aValue, aMin), aMax);
+
+    return std::min(uint64_t((cValue - aMin) / (double(aMax) - aMin) * double(cMask) + 0.5), cMask);
+}
+
+static float Dequantize(uint64_t aValue, float aMin, float aMax, size_t aBitCount)
+{
+    const double cSteps = double((uint64_t(1) << aBitCount) - 1);
+
+    return float(aMin + double(aValue) / cSteps * (double(aMax) - aMin));
+}
+
+
+// Array kernels, values are combined in pairs (2 * width bits) before going through the scratch register
+// or extracted straight from memory, the layout is the same as one WriteBits call per value
+namespace details
+{
+    using PackKernel = size_t(*)(const uint32_t* apData, size_t aCount, size_t aBitCount, uint64_t* apPairs);
+    using UnpackKernel = size_t(*)(const uint8_t* apSource, size_t aSize, size_t aBitPosition, size_t aCount, size_t aBitCount, uint32_t* apDestination);
+
+    static uint64_t LoadWord(const uint8_t* apSource, size_t aSize, size_t aBytePosition)
+    {
+        uint64_t word = 0;
+        std::memcpy(&word, apSource + aBytePosition, std::min(sizeof(word), aSize - aBytePosition));
+        return word;
+    }
+
+    static size_t PackScalar(const uint32_t* apData, size_t aCount, size_t aBitCount, uint64_t* apPairs)
+    {
+        const uint64_t cMask = (uint64_t(1) << aBitCount) - 1;
+
+        size_t i = 0;
+        for (; i + 2 <= aCount; i += 2)
+            *apPairs++ = (apData[i] & cMask) | (apData[i + 1] & cMask) << aBitCount;
+
+        return i;
+    }
+
+    static size_t UnpackScalar(const uint8_t* apSource, size_t aSize, size_t aBitPosition, size_t aCount, size_t aBitCount, uint32_t* apDestination)
+    {
+        const uint64_t cMask = (uint64_t(1) << aBitCount) - 1;
+
+        // A value is at most 32 bits shifted by at most 7, a single word always holds it
+        for (size_t i = 0; i < aCount; ++i, aBitPosition += aBitCount)
+            apDestination[i] = uint32_t((LoadWord(apSource, aSize, aBitPosition >> 3) >> (aBitPosition & 0x7)) & cMask);
+
+        return aCount;
+    }
+
+#ifdef BUFFER_SIMD_X86
+    static size_t PackSse2(const uint32_t* apData, size_t aCount, size_t aBitCount, uint64_t* apPairs)
+    {
+        const __m128i cMask = _mm_set1_epi32(int((uint64_t(1) << aBitCount) - 1));
+        const __m128i cLow = _mm_set1_epi64x(0xFFFFFFFF);
+        const __m128i cShift = _mm_cvtsi32_si128(int(aBitCount));
+
+        size_t i = 0;
+        for (; i + 4 <= aCount; i += 4)
+        {
+            const __m128i cValues = _mm_and_si128(_mm_loadu_si128((const __m128i*)(apData + i)), cMask);
+            const __m128i cEven = _mm_and_si128(cValues, cLow);
+            const __m128i cOdd = _mm_srli_epi64(cValues, 32);
+
+            _mm_storeu_si128((__m128i*)apPairs, _mm_or_si128(cEven, _mm_sll_epi64(cOdd, cShift)));
+            apPairs += 2;
+        }
+
+        return i;
+    }
+
+    BUFFER_TARGET_AVX2 static size_t PackAvx2(const uint32_t* apData, size_t aCount, size_t aBitCount, uint64_t* apPairs)
+    {
+        const __m256i cMask = _mm256_set1_epi32(int((uint64_t(1) << aBitCount) - 1));
+        const __m256i cLow = _mm256_set1_epi64x(0xFFFFFFFF);
+        const __m128i cShift = _mm_cvtsi32_si128(int(aBitCount));
+
+        size_t i = 0;
+        for (; i + 8 <= aCount; i += 8)
+        {
+            const __m256i cValues = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(apData + i)), cMask);
+            const __m256i cEven = _mm256_and_si256(cValues, cLow);
+            const __m256i cOdd = _mm256_srli_epi64(cValues, 32);
+
+            _mm256_storeu_si256((__m256i*)apPairs, _mm256_or_si256(cEven, _mm256_sll_epi64(cOdd, cShift)));
+            apPairs += 4;
+        }
+
+        return i;
+    }
+
+    BUFFER_TARGET_AVX2 static size_t UnpackAvx2(const uint8_t* apSource, size_t aSize, size_t aBitPosition, size_t aCount, size_t aBitCount, uint32_t* apDestination)
+    {
+        const __m256i cMask = _mm256_set1_epi64x(int64_t((uint64_t(1) << aBitCount) - 1));
+        const __m256i cSteps = _mm256_setr_epi64x(0, int64_t(aBitCount), int64_t(2 * aBitCount), int64_t(3 * aBitCount));
+        const __m256i cSeven = _mm256_set1_epi64x(7);
+        const __m256i cPack = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+
+        // Gathers load full words, stop while the last one of the group is still in bounds
+        size_t i = 0;
+        for (; i + 4 <= aCount && ((aBitPosition + 3 * aBitCount) >> 3) + sizeof(uint64_t) <= aSize; i += 4, aBitPosition += 4 * aBitCount)
+        {
+            const __m256i cPositions = _mm256_add_epi64(_mm256_set1_epi64x(int64_t(aBitPosition)), cSteps);
+            const __m256i cWords = _mm256_i64gather_epi64((const long long*)apSource, _mm256_srli_epi64(cPositions, 3), 1);
+            const __m256i cValues = _mm256_and_si256(_mm256_srlv_epi64(cWords, _mm256_and_si256(cPositions, cSeven)), cMask);
+
+            _mm_storeu_si128((__m128i*)(apDestination + i), _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(cValues, cPack)));
+        }
+
+        return i;
+    }
 
+    static bool HasAvx2()
+    {
+#ifdef _MSC_VER
+        int registers[4];
+        __cpuid(registers, 1);
+
+        // The OS must save the AVX state
+        const bool cOsxsave = (registers[2] & (1 << 27)) != 0;
+        if (!cOsxsave || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+
+        __cpuidex(registers, 7, 0);
+        return (registers[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+    static PackKernel GetPackKernel()
+    {
+#ifdef BUFFER_SIMD_X86
+        static const PackKernel s_kernel = HasAvx2() ? PackAvx2 : PackSse2;
+        return s_kernel;
+#else
+        return PackScalar;
+#endif
+    }
+
+    static UnpackKernel GetUnpackKernel()
+    {
+#ifdef BUFFER_SIMD_X86
+        // SSE2 has neither gathers nor per lane shifts, it gains nothing over the scalar loop
+        static const UnpackKernel s_kernel = HasAvx2() ? UnpackAvx2 : UnpackScalar;
+        return s_kernel;
+#else
+        return UnpackScalar;
+#endif
+    }
+}
 
 Buffer::Buffer()
     : m_pData(nullptr)
     , m_size(0)
+    , m_alignment(alignof(details::default_align_t))
 {
 
 }
 
 Buffer::Buffer(size_t aSize)
+    : Buffer(aSize, alignof(details::default_align_t))
+{
+}
+
+Buffer::Buffer(size_t aSize, size_t aAlignment)
     : m_pData(nullptr)
     , m_size(aSize)
+    , m_alignment(aAlignment)
 {
-    if(m_size > 0)
-        m_pData = (uint8_t*)GetAllocator()->Allocate(m_size);
+    if (m_size > 0)
+    {
+        if (m_size <= InlineCapacity && m_alignment <= alignof(details::default_align_t))
+            m_pData = m_inline;
+        else if (m_alignment > alignof(details::default_align_t))
+            m_pData = (uint8_t*)GetAllocator()->Allocate(m_size, m_alignment);
+        else
+            m_pData = (uint8_t*)GetAllocator()->Allocate(m_size);
+
+        // Readers and writers bound everything by the size, nothing can touch the missing data
+        if (m_pData == nullptr)
+            m_size = 0;
+    }
 }
 
 Buffer::Buffer(const Buffer& acBuffer)
-    : Buffer(acBuffer.m_size)
+    : Buffer(acBuffer.m_size, acBuffer.m_alignment)
 {
     if(m_pData && acBuffer.GetData())
         std::copy(acBuffer.GetData(), acBuffer.GetData() + m_size, m_pData);
@@ -30,6 +219,14 @@ Buffer::Buffer(Buffer&& aBuffer) noexcept
 
     m_pData = aBuffer.m_pData;
     m_size = aBuffer.m_size;
+    m_alignment = aBuffer.m_alignment;
+
+    // Inline data can't be stolen, it has to follow the object
+    if (aBuffer.IsInline())
+    {
+        std::copy(aBuffer.m_inline, aBuffer.m_inline + m_size, m_inline);
+        m_pData = m_inline;
+    }
 
     aBuffer.m_pData = nullptr;
     aBuffer.m_size = 0;
@@ -37,58 +234,84 @@ Buffer::Buffer(Buffer&& aBuffer) noexcept
 
 Buffer::~Buffer()
 {
-    GetAllocator()->Free(m_pData);
+    if (!IsInline())
+        GetAllocator()->Free(m_pData);
 }
 
-uint8_t Buffer::operator[](size_t aIndex) const
+Buffer& Buffer::operator=(const Buffer& acBuffer)
 {
-    return m_pData[aIndex];
+    this->~Buffer();
+    new (this) Buffer(acBuffer);
+
+    return *this;
 }
 
-uint8_t& Buffer::operator[](size_t aIndex)
+Buffer& Buffer::operator=(Buffer&& aBuffer) noexcept
 {
-    return m_pData[aIndex];
+    Swap(aBuffer);
+
+    return *this;
 }
 
-Buffer& Buffer::operator=(const Buffer& acBuffer)
+bool Buffer::Resize(size_t aSize)
 {
-    this->~Buffer();
-    new (this) Buffer(acBuffer);
+    if (aSize == m_size)
+        return true;
 
-    return *this;
+    ScopedAllocator _(GetAllocator());
+
+    Buffer resized(aSize, m_alignment);
+    if (aSize > 0 && resized.GetData() == nullptr)
+        return false;
+
+    if (m_pData)
+        std::copy(m_pData, m_pData + std::min(m_size, aSize), resized.GetWriteData());
+
+    Swap(resized);
+
+    return true;
 }
 
-Buffer& Buffer::operator=(Buffer&& aBuffer) noexcept
+void Buffer::Swap(Buffer& aBuffer) noexcept
 {
+    const bool cWasInline = IsInline();
+    const bool cOtherWasInline = aBuffer.IsInline();
+
     std::swap(aBuffer.m_pData, m_pData);
     std::swap(aBuffer.m_size, m_size);
+    std::swap(aBuffer.m_alignment, m_alignment);
 
     // Swap allocators
     auto pAllocator = GetAllocator();
     SetAllocator(aBuffer.GetAllocator());
     aBuffer.SetAllocator(pAllocator);
 
-    return *this;
-}
+    // Pointers to inline storage must point to the storage of the object that now owns the data
+    if (cWasInline || cOtherWasInline)
+    {
+        std::swap_ranges(m_inline, m_inline + InlineCapacity, aBuffer.m_inline);
 
-size_t Buffer::GetSize() const
-{
-    return m_size;
+        if (cWasInline)
+            aBuffer.m_pData = aBuffer.m_inline;
+        if (cOtherWasInline)
+            m_pData = m_inline;
+    }
 }
 
-const uint8_t* Buffer::GetData() const
+Buffer::Cursor::Cursor(Buffer* apBuffer)
+    : m_bitPosition(0)
+    , m_pBuffer(apBuffer)
+    , m_pData(nullptr)
+    , m_size(0)
 {
-    return m_pData;
-}
 
-uint8_t* Buffer::GetWriteData()
-{
-    return m_pData;
 }
 
-Buffer::Cursor::Cursor(Buffer* apBuffer)
+Buffer::Cursor::Cursor(const uint8_t* apData, size_t aSize)
     : m_bitPosition(0)
-    , m_pBuffer(apBuffer)
+    , m_pBuffer(nullptr)
+    , m_pData(apData)
+    , m_size(aSize)
 {
 
 }
@@ -113,7 +336,7 @@ void Buffer::Cursor::Reset()
 
 bool Buffer::Cursor::Eof() const
 {
-    return m_bitPosition >= m_pBuffer->GetSize() * 8;
+    return m_bitPosition >= GetSize() * 8;
 }
 
 size_t Buffer::Cursor::GetBitPosition() const
@@ -126,13 +349,14 @@ size_t Buffer::Cursor::GetBytePosition() const
     return m_bitPosition / 8;
 }
 
-size_t Buffer::Cursor::GetSize() const
+Buffer::Reader::Reader(Buffer* apBuffer)
+    : Buffer::Cursor(apBuffer)
 {
-    return m_pBuffer->GetSize();
+
 }
 
-Buffer::Reader::Reader(Buffer* apBuffer)
-    : Buffer::Cursor(apBuffer)
+Buffer::Reader::Reader(const uint8_t* apData, size_t aSize)
+    : Buffer::Cursor(apData, aSize)
 {
 
 }
@@ -141,41 +365,30 @@ bool Buffer::Reader::ReadBits(uint64_t& aDestination, size_t aCount)
 {
     aDestination = 0;
 
-    // Number of bits to read in the current byte
-    auto bitIndex = m_bitPosition & 0x7;
-    size_t bitsToRead = 0;
-
-    auto countOffset = aCount + bitIndex;
-    // Compute how many bytes we will end up reading
-    auto bytesToRead = ((countOffset & ~0x7) + ((countOffset & 0x7) != 0 ? 8 : 0)) >> 3;
-    if (bytesToRead + GetBytePosition() > m_pBuffer->GetSize())
+    const size_t cSize = GetSize();
+    if (m_bitPosition + aCount > cSize * 8)
     {
         return false;
     }
 
-    uint64_t endBits = 0;
-
-    auto* pLocation = m_pBuffer->GetData() + GetBytePosition();
-
-    if (bitIndex != 0)
-    {
-        bitsToRead = 8 - bitIndex;
+    const size_t cBytePosition = m_bitPosition >> 3;
+    const size_t cBitIndex = m_bitPosition & 0x7;
+    const uint8_t* pLocation = GetSourceData() + cBytePosition;
 
-        // If we are requesting less bits that what is available
-        bitsToRead = bitsToRead > aCount ? aCount : bitsToRead;
+    // Load the whole word the bits live in, only the tail of the buffer needs a partial load
+    uint64_t word = 0;
+    if (cBytePosition + sizeof(word) <= cSize)
+        std::memcpy(&word, pLocation, sizeof(word));
+    else
+        std::memcpy(&word, pLocation, cSize - cBytePosition);
 
-        endBits = ((*pLocation) >> bitIndex) & ((1 << bitsToRead) - 1);
+    uint64_t value = word >> cBitIndex;
 
-        pLocation++;
-        bytesToRead--;
-    }
-    else
-        bitIndex = 0;
+    // A misaligned 64 bit read spills on a ninth byte, the bound check above guarantees it exists
+    if (cBitIndex + aCount > 64)
+        value |= uint64_t(pLocation[sizeof(word)]) << (64 - cBitIndex);
 
-    std::copy(pLocation, pLocation + bytesToRead, (uint8_t*)& aDestination);
-    aDestination <<= bitsToRead;
-    aDestination |= endBits;
-    aDestination &= ((uint64_t(1) << aCount) - 1);
+    aDestination = aCount < 64 ? value & ((uint64_t(1) << aCount) - 1) : value;
 
     m_bitPosition += aCount;
 
@@ -187,9 +400,10 @@ bool Buffer::Reader::ReadBytes(uint8_t* apDestination, size_t aCount)
     // Fix m_bitPosition to be at the start of the next full byte
     m_bitPosition = (m_bitPosition & ~0x7) + ((m_bitPosition & 0x7) != 0 ? 8 : 0);
 
-    if (aCount + GetBytePosition() <= m_pBuffer->GetSize())
+    if (aCount + GetBytePosition() <= GetSize())
     {
-        std::copy(m_pBuffer->GetData() + GetBytePosition(), m_pBuffer->GetData() + GetBytePosition() + aCount, apDestination);
+        const uint8_t* pLocation = GetSourceData() + GetBytePosition();
+        std::copy(pLocation, pLocation + aCount, apDestination);
 
         Advance(aCount);
 
@@ -199,71 +413,290 @@ bool Buffer::Reader::ReadBytes(uint8_t* apDestination, size_t aCount)
     return false;
 }
 
-Buffer::Writer::Writer(Buffer* apBuffer)
+bool Buffer::Reader::ReadVarint(uint64_t& aDestination)
+{
+    aDestination = 0;
+
+    const size_t cStart = m_bitPosition;
+    for (size_t shift = 0; shift < 64; shift += 7)
+    {
+        uint64_t group = 0;
+        if (!ReadBits(group, 8))
+            break;
+
+        // The tenth byte may only carry the last bit of a 64 bit value
+        if (shift == 63 && group > 1)
+            break;
+
+        aDestination |= (group & 0x7F) << shift;
+
+        if ((group & 0x80) == 0)
+            return true;
+    }
+
+    aDestination = 0;
+    m_bitPosition = cStart;
+
+    return false;
+}
+
+bool Buffer::Reader::ReadSignedVarint(int64_t& aDestination)
+{
+    uint64_t value = 0;
+    const bool cResult = ReadVarint(value);
+
+    aDestination = int64_t(value >> 1) ^ -int64_t(value & 1);
+
+    return cResult;
+}
+
+bool Buffer::Reader::ReadRange(int64_t& aDestination, int64_t aMin, int64_t aMax)
+{
+    uint64_t value = 0;
+    const bool cResult = ReadBits(value, BitCountFor(uint64_t(aMax) - uint64_t(aMin)));
+
+    aDestination = int64_t(uint64_t(aMin) + value);
+
+    return cResult;
+}
+
+bool Buffer::Reader::ReadQuantized(float& aDestination, float aMin, float aMax, size_t aBitCount)
+{
+    uint64_t value = 0;
+    const bool cResult = ReadBits(value, aBitCount);
+
+    aDestination = Dequantize(value, aMin, aMax, aBitCount);
+
+    return cResult;
+}
+
+bool Buffer::Reader::ReadVector(float (&aDestination)[3], float aMin, float aMax, size_t aBitCount)
+{
+    if (m_bitPosition + 3 * aBitCount > GetSize() * 8)
+        return false;
+
+    for (float& component : aDestination)
+        ReadQuantized(component, aMin, aMax, aBitCount);
+
+    return true;
+}
+
+bool Buffer::Reader::ReadQuaternion(float (&aDestination)[4], size_t aBitCount)
+{
+    if (m_bitPosition + 2 + 3 * aBitCount > GetSize() * 8)
+        return false;
+
+    uint64_t largest = 0;
+    ReadBits(largest, 2);
+
+    float sum = 0.f;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+
+        ReadQuantized(aDestination[i], -s_quaternionBound, s_quaternionBound, aBitCount);
+        sum += aDestination[i] * aDestination[i];
+    }
+
+    // The sender made the largest component positive
+    aDestination[largest] = std::sqrt(std::max(0.f, 1.f - sum));
+
+    return true;
+}
+
+bool Buffer::Reader::ReadBitsArray(uint32_t* apDestination, size_t aCount, size_t aBitCount)
+{
+    if (aBitCount == 0 || aBitCount > 32 || m_bitPosition + aCount * aBitCount > GetSize() * 8)
+        return false;
+
+    const uint8_t* pSource = GetSourceData();
+    const size_t cSize = GetSize();
+
+    const size_t cDone = details::GetUnpackKernel()(pSource, cSize, m_bitPosition, aCount, aBitCount, apDestination);
+    details::UnpackScalar(pSource, cSize, m_bitPosition + cDone * aBitCount, aCount - cDone, aBitCount, apDestination + cDone);
+
+    m_bitPosition += aCount * aBitCount;
+
+    return true;
+}
+
+Buffer::Writer::Writer(Buffer* apBuffer, bool aGrowable, Mode aMode)
     : Buffer::Cursor(apBuffer)
+    , m_scratch(0)
+    , m_scratchBits(0)
+    , m_growable(aGrowable)
+    , m_mode(aMode)
 {
 
 }
 
 Buffer::Writer::~Writer()
 {
+    Flush();
 }
 
-bool Buffer::Writer::WriteBits(uint64_t aData, size_t aCount)
+void Buffer::Writer::Reset()
+{
+    Flush();
+    Cursor::Reset();
+}
+
+void Buffer::Writer::Advance(size_t aByteCount)
+{
+    Flush();
+    Cursor::Advance(aByteCount);
+}
+
+void Buffer::Writer::Reverse(size_t aByteCount)
 {
-    // Number of bits to write in the current byte
-    auto bitIndex = m_bitPosition & 0x7;
-    size_t bitsToWrite = 0;
+    Flush();
+    Cursor::Reverse(aByteCount);
+}
+
+void Buffer::Writer::Flush()
+{
+    if (m_scratchBits == 0)
+        return;
+
+    // The scratch register always starts on a byte boundary, the last partial byte is written with its high bits cleared
+    const size_t cBytePosition = (m_bitPosition - m_scratchBits) >> 3;
+    std::memcpy(m_pBuffer->GetWriteData() + cBytePosition, &m_scratch, (m_scratchBits + 7) >> 3);
+
+    m_scratch = 0;
+    m_scratchBits = 0;
+}
+
+void Buffer::Writer::Sync()
+{
+    if (m_mode != kWriteThrough || m_scratchBits == 0)
+        return;
+
+    // Same store as Flush, the register is kept so the next call doesn't read the partial byte back
+    const size_t cBytePosition = (m_bitPosition - m_scratchBits) >> 3;
+    std::memcpy(m_pBuffer->GetWriteData() + cBytePosition, &m_scratch, (m_scratchBits + 7) >> 3);
+}
+
+bool Buffer::Writer::Reserve(size_t aByteCount)
+{
+    const size_t cRequiredSize = ((m_bitPosition + 7) >> 3) + aByteCount;
+    if (cRequiredSize <= m_pBuffer->GetSize())
+        return true;
+
+    return m_growable && m_pBuffer->Resize(cRequiredSize);
+}
+
+bool Buffer::Writer::IsGrowable() const
+{
+    return m_growable;
+}
+
+bool Buffer::Writer::Grow(size_t aRequiredSize)
+{
+    if (!m_growable)
+        return false;
+
+    // Doubling keeps the number of copies logarithmic in the final size
+    constexpr size_t cMinimumSize = InlineCapacity;
+    size_t size = std::max(m_pBuffer->GetSize() * 2, cMinimumSize);
+    if (size < aRequiredSize)
+        size = aRequiredSize;
+
+    return m_pBuffer->Resize(size);
+}
 
-    auto countOffset = aCount + bitIndex;
-    // Compute how many bytes we will end up writing
-    auto bytesToWrite = ((countOffset & ~0x7) + ((countOffset & 0x7) != 0 ? 8 : 0)) >> 3;
+bool Buffer::Writer::Ensure(size_t aBitCount)
+{
+    return m_bitPosition + aBitCount <= m_pBuffer->GetSize() * 8 || Grow((m_bitPosition + aBitCount + 7) >> 3);
+}
 
-    if (bytesToWrite + GetBytePosition() > m_pBuffer->GetSize())
+bool Buffer::Writer::WriteBits(uint64_t aData, size_t aCount)
+{
+    if (!Ensure(aCount))
     {
         return false;
     }
 
-    auto* pLocation = m_pBuffer->GetWriteData() + GetBytePosition();
+    if (aCount < 64)
+        aData &= (uint64_t(1) << aCount) - 1;
 
-    if (bitIndex != 0)
-    {
-        bitsToWrite = 8 - bitIndex;
+    Append(aData, aCount);
+    Sync();
 
-        // If we are requesting less bits that what is available
-        bitsToWrite = bitsToWrite > aCount ? aCount : bitsToWrite;
+    return true;
+}
 
-        // Select the data we want to keep
-        auto workByte = *pLocation;
-        auto workByteMask = ((1 << bitIndex) - 1);
-        workByte &= workByteMask;
+void Buffer::Writer::Append(uint64_t aData, size_t aCount)
+{
+    // Resuming in the middle of a byte, keep the bits that were already written
+    if (m_scratchBits == 0 && (m_bitPosition & 0x7) != 0)
+    {
+        m_scratchBits = m_bitPosition & 0x7;
+        m_scratch = m_pBuffer->GetData()[m_bitPosition >> 3] & ((1 << m_scratchBits) - 1);
+    }
 
-        // Write the part we want
-        *pLocation = ((uint8_t)(aData & 0xFF) & ((1 << bitsToWrite) - 1)) << bitIndex;
-        *pLocation |= workByte;
+    m_scratch |= aData << m_scratchBits;
 
-        pLocation++;
-        bytesToWrite--;
+    const size_t cFreeBits = 64 - m_scratchBits;
+    if (aCount >= cFreeBits)
+    {
+        // The register is full, the whole word is in bounds as it only holds bits that were written
+        const size_t cBytePosition = (m_bitPosition - m_scratchBits) >> 3;
+        std::memcpy(m_pBuffer->GetWriteData() + cBytePosition, &m_scratch, sizeof(m_scratch));
 
-        aData >>= bitsToWrite;
+        m_scratch = cFreeBits < 64 ? aData >> cFreeBits : 0;
+        m_scratchBits = aCount - cFreeBits;
     }
     else
-        bitIndex = 0;
-
-    uint8_t* pDirectAccess = (uint8_t*)&aData;
-    std::copy(pDirectAccess, pDirectAccess + bytesToWrite, pLocation);
+    {
+        m_scratchBits += aCount;
+    }
 
     m_bitPosition += aCount;
+}
+
+bool Buffer::Writer::WriteBitsArray(const uint32_t* apData, size_t aCount, size_t aBitCount)
+{
+    if (aBitCount == 0 || aBitCount > 32 || !Ensure(aCount * aBitCount))
+        return false;
+
+    const details::PackKernel cKernel = details::GetPackKernel();
+
+    // Pairs are produced a block at a time to stay in cache
+    constexpr size_t cBlockSize = 64;
+    uint64_t pairs[cBlockSize / 2];
+
+    size_t i = 0;
+    while (i < aCount)
+    {
+        const size_t cCount = std::min(cBlockSize, aCount - i);
+
+        size_t done = cKernel(apData + i, cCount, aBitCount, pairs);
+        done += details::PackScalar(apData + i + done, cCount - done, aBitCount, pairs + done / 2);
+
+        for (size_t j = 0; j < done / 2; ++j)
+            Append(pairs[j], 2 * aBitCount);
+
+        // Odd value left at the end
+        if (done < cCount)
+            Append(apData[i + done] & ((uint64_t(1) << aBitCount) - 1), aBitCount);
+
+        i += cCount;
+    }
+
+    Sync();
 
     return true;
 }
 
 bool Buffer::Writer::WriteBytes(const uint8_t* apSource, size_t aCount)
 {
+    Flush();
+
     // Fix m_bitPosition to be at the start of the next full byte
     m_bitPosition = (m_bitPosition & ~0x7) + ((m_bitPosition & 0x7) != 0 ? 8 : 0);
 
-    if (aCount + GetBytePosition() <= m_pBuffer->GetSize())
+    if (aCount + GetBytePosition() <= m_pBuffer->GetSize() || Grow(aCount + GetBytePosition()))
     {
         std::copy(apSource, apSource + aCount, m_pBuffer->GetWriteData() + GetBytePosition());
 
@@ -273,4 +706,97 @@ bool Buffer::Writer::WriteBytes(const uint8_t* apSource, size_t aCount)
     }
 
     return false;
-}
\ No newline at end of file
+}
+
+bool Buffer::Writer::WriteVarint(uint64_t aData)
+{
+    const size_t cByteCount = std::max<size_t>(1, (BitCountFor(aData) + 6) / 7);
+    if (!Ensure(cByteCount * 8))
+    {
+        return false;
+    }
+
+    // Groups are gathered in a word, all but the longest values are written with a single call
+    uint64_t word = 0;
+    size_t wordBits = 0;
+
+    for (size_t i = 0; i < cByteCount; ++i)
+    {
+        uint64_t group = aData & 0x7F;
+        aData >>= 7;
+
+        if (i + 1 < cByteCount)
+            group |= 0x80;
+
+        word |= group << wordBits;
+        wordBits += 8;
+
+        if (wordBits == 64)
+        {
+            WriteBits(word, wordBits);
+            word = 0;
+            wordBits = 0;
+        }
+    }
+
+    return wordBits == 0 || WriteBits(word, wordBits);
+}
+
+bool Buffer::Writer::WriteSignedVarint(int64_t aData)
+{
+    return WriteVarint((uint64_t(aData) << 1) ^ uint64_t(aData >> 63));
+}
+
+bool Buffer::Writer::WriteRange(int64_t aData, int64_t aMin, int64_t aMax)
+{
+    const int64_t cValue = std::min(std::max(aData, aMin), aMax);
+
+    return WriteBits(uint64_t(cValue) - uint64_t(aMin), BitCountFor(uint64_t(aMax) - uint64_t(aMin)));
+}
+
+bool Buffer::Writer::WriteQuantized(float aData, float aMin, float aMax, size_t aBitCount)
+{
+    return WriteBits(Quantize(aData, aMin, aMax, aBitCount), aBitCount);
+}
+
+bool Buffer::Writer::WriteVector(const float (&acData)[3], float aMin, float aMax, size_t aBitCount)
+{
+    if (!Ensure(3 * aBitCount))
+        return false;
+
+    const uint64_t cX = Quantize(acData[0], aMin, aMax, aBitCount);
+    const uint64_t cY = Quantize(acData[1], aMin, aMax, aBitCount);
+    const uint64_t cZ = Quantize(acData[2], aMin, aMax, aBitCount);
+
+    if (3 * aBitCount <= 64)
+        return WriteBits(cX | cY << aBitCount | cZ << (2 * aBitCount), 3 * aBitCount);
+
+    return WriteBits(cX | cY << aBitCount, 2 * aBitCount) && WriteBits(cZ, aBitCount);
+}
+
+bool Buffer::Writer::WriteQuaternion(const float (&acData)[4], size_t aBitCount)
+{
+    size_t largest = 0;
+    for (size_t i = 1; i < 4; ++i)
+    {
+        if (std::abs(acData[i]) > std::abs(acData[largest]))
+            largest = i;
+    }
+
+    // q and -q are the same rotation, flip it so the dropped component is positive
+    const float cSign = acData[largest] < 0.f ? -1.f : 1.f;
+
+    // Everything fits in a single word, aBitCount is at most 20
+    uint64_t word = largest;
+    size_t wordBits = 2;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+
+        word |= Quantize(cSign * acData[i], -s_quaternionBound, s_quaternionBound, aBitCount) << wordBits;
+        wordBits += aBitCount;
+    }
+
+    return WriteBits(word, wordBits);
+}
@@ -0,0 +1,72 @@
+#include "BufferChain.h"
+#include <algorithm>
+
+
+BufferChain::BufferChain() noexcept
+    : m_count(0)
+    , m_size(0)
+{
+}
+
+bool BufferChain::Append(const BufferView& acSegment) noexcept
+{
+    if (acSegment.IsEmpty())
+        return true;
+
+    if (m_count == MaxSegments)
+        return false;
+
+    m_segments[m_count++] = acSegment;
+    m_size += acSegment.GetSize();
+
+    return true;
+}
+
+bool BufferChain::Prepend(const BufferView& acSegment) noexcept
+{
+    if (acSegment.IsEmpty())
+        return true;
+
+    if (m_count == MaxSegments)
+        return false;
+
+    // Moving views leaves their reference counts alone
+    std::move_backward(m_segments, m_segments + m_count, m_segments + m_count + 1);
+    m_segments[0] = acSegment;
+
+    ++m_count;
+    m_size += acSegment.GetSize();
+
+    return true;
+}
+
+void BufferChain::Clear() noexcept
+{
+    for (size_t i = 0; i < m_count; ++i)
+        m_segments[i] = BufferView();
+
+    m_count = 0;
+    m_size = 0;
+}
+
+BufferView BufferChain::Flatten() const noexcept
+{
+    if (m_count == 0)
+        return BufferView();
+
+    if (m_count == 1)
+        return m_segments[0];
+
+    Buffer buffer(m_size);
+    if (buffer.GetData() == nullptr)
+        return BufferView();
+
+    size_t offset = 0;
+    for (size_t i = 0; i < m_count; ++i)
+    {
+        std::copy(m_segments[i].GetData(), m_segments[i].GetData() + m_segments[i].GetSize(), buffer.GetWriteData() + offset);
+        offset += m_segments[i].GetSize();
+    }
+
+    return BufferView(std::move(buffer));
+}
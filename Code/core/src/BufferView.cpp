@@ -0,0 +1,133 @@
+#include "BufferView.h"
+#include <algorithm>
+
+
+BufferView::Storage::Storage(Buffer aBuffer) noexcept
+    : RefCount{ 1 }
+    , Data{ std::move(aBuffer) }
+{
+}
+
+BufferView::BufferView() noexcept
+    : m_pStorage(nullptr)
+    , m_pData(nullptr)
+    , m_size(0)
+{
+}
+
+BufferView::BufferView(Buffer aBuffer) noexcept
+    : BufferView()
+{
+    Adopt(std::move(aBuffer));
+}
+
+BufferView::BufferView(const uint8_t* apData, size_t aSize) noexcept
+    : BufferView()
+{
+    if (aSize == 0)
+        return;
+
+    Buffer buffer(aSize);
+    if (buffer.GetData() == nullptr)
+        return;
+
+    std::copy(apData, apData + aSize, buffer.GetWriteData());
+
+    Adopt(std::move(buffer));
+}
+
+BufferView::BufferView(const BufferView& acRhs) noexcept
+    : m_pStorage(acRhs.m_pStorage)
+    , m_pData(acRhs.m_pData)
+    , m_size(acRhs.m_size)
+{
+    if (m_pStorage)
+        m_pStorage->RefCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+BufferView::BufferView(BufferView&& aRhs) noexcept
+    : m_pStorage(aRhs.m_pStorage)
+    , m_pData(aRhs.m_pData)
+    , m_size(aRhs.m_size)
+{
+    aRhs.m_pStorage = nullptr;
+    aRhs.m_pData = nullptr;
+    aRhs.m_size = 0;
+}
+
+BufferView::~BufferView() noexcept
+{
+    Release();
+}
+
+BufferView& BufferView::operator=(const BufferView& acRhs) noexcept
+{
+    if (this != &acRhs)
+    {
+        if (acRhs.m_pStorage)
+            acRhs.m_pStorage->RefCount.fetch_add(1, std::memory_order_relaxed);
+
+        Release();
+
+        m_pStorage = acRhs.m_pStorage;
+        m_pData = acRhs.m_pData;
+        m_size = acRhs.m_size;
+    }
+
+    return *this;
+}
+
+BufferView& BufferView::operator=(BufferView&& aRhs) noexcept
+{
+    std::swap(m_pStorage, aRhs.m_pStorage);
+    std::swap(m_pData, aRhs.m_pData);
+    std::swap(m_size, aRhs.m_size);
+
+    return *this;
+}
+
+BufferView BufferView::Slice(size_t aOffset, size_t aSize) const noexcept
+{
+    BufferView view(*this);
+
+    aOffset = std::min(aOffset, m_size);
+    view.m_pData = m_pData + aOffset;
+    view.m_size = std::min(aSize, m_size - aOffset);
+
+    return view;
+}
+
+uint32_t BufferView::GetUseCount() const noexcept
+{
+    return m_pStorage ? m_pStorage->RefCount.load(std::memory_order_relaxed) : 0;
+}
+
+Buffer::Reader BufferView::GetReader() const noexcept
+{
+    return Buffer::Reader(m_pData, m_size);
+}
+
+void BufferView::Adopt(Buffer aBuffer) noexcept
+{
+    if (aBuffer.GetSize() == 0)
+        return;
+
+    // The buffer is moved into the shared storage, its bytes are not copied unless they were stored inline
+    m_pStorage = New<Storage>(std::move(aBuffer));
+    if (m_pStorage)
+    {
+        m_pData = m_pStorage->Data.GetData();
+        m_size = m_pStorage->Data.GetSize();
+    }
+}
+
+void BufferView::Release() noexcept
+{
+    // The last owner needs to see every write made through other views before destroying the storage
+    if (m_pStorage && m_pStorage->RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        Delete(m_pStorage);
+
+    m_pStorage = nullptr;
+    m_pData = nullptr;
+    m_size = 0;
+}
@@ -0,0 +1,134 @@
+#include "FrameArena.h"
+#include <algorithm>
+
+static constexpr size_t cAlignment = alignof(details::default_align_t);
+static constexpr size_t cChunkHeaderSize = (sizeof(void*) + sizeof(size_t) + cAlignment - 1) & ~(cAlignment - 1);
+
+FrameArena::FrameArena(size_t aChunkSize, Allocator* apParentAllocator)
+    : m_chunkSize(aChunkSize)
+    , m_offset(0)
+    , m_pFirstChunk(nullptr)
+    , m_pCurrentChunk(nullptr)
+    , m_pParentAllocator(apParentAllocator)
+{
+    static_assert(sizeof(Chunk) <= cChunkHeaderSize);
+}
+
+FrameArena::~FrameArena()
+{
+    auto pChunk = m_pFirstChunk;
+    while (pChunk)
+    {
+        auto pNext = pChunk->pNext;
+        m_pParentAllocator->Free(pChunk);
+        pChunk = pNext;
+    }
+}
+
+void* FrameArena::Allocate(size_t aSize)
+{
+    return Allocate(aSize, cAlignment);
+}
+
+void* FrameArena::Allocate(size_t aSize, size_t aAlignment)
+{
+    if (m_pCurrentChunk)
+    {
+        auto pData = TryAllocate(m_pCurrentChunk, m_offset, aSize, aAlignment);
+        if (pData)
+            return pData;
+    }
+
+    // Move on to the next chunk, chunks from previous frames are reused when they are large enough
+    Chunk* pPrevious = m_pCurrentChunk;
+    Chunk* pNext = pPrevious ? pPrevious->pNext : m_pFirstChunk;
+
+    // Chunk data is only aligned on cAlignment, keep room to align the start of over aligned requests
+    size_t requiredSize = aSize + (aAlignment > cAlignment ? aAlignment - cAlignment : 0);
+
+    if (pNext == nullptr || pNext->Size < requiredSize)
+    {
+        auto pChunk = AllocateChunk(std::max(m_chunkSize, requiredSize));
+        if (pChunk == nullptr)
+            return nullptr;
+
+        pChunk->pNext = pNext;
+
+        if (pPrevious)
+            pPrevious->pNext = pChunk;
+        else
+            m_pFirstChunk = pChunk;
+
+        pNext = pChunk;
+    }
+
+    m_pCurrentChunk = pNext;
+
+    return TryAllocate(m_pCurrentChunk, 0, aSize, aAlignment);
+}
+
+void FrameArena::Free(void* apData)
+{
+    // memory is released by RewindTo and Reset
+    (void)apData;
+}
+
+size_t FrameArena::Size(void* apData)
+{
+    (void)apData;
+    return m_pCurrentChunk ? m_pCurrentChunk->Size - m_offset : 0;
+}
+
+FrameArena::Marker FrameArena::GetMarker() const
+{
+    return Marker{ m_pCurrentChunk, m_offset };
+}
+
+void FrameArena::RewindTo(const Marker& acMarker)
+{
+    m_pCurrentChunk = acMarker.pChunk;
+    m_offset = acMarker.Offset;
+}
+
+void FrameArena::Reset()
+{
+    // Chunks are kept for the next frame
+    m_pCurrentChunk = nullptr;
+    m_offset = 0;
+}
+
+size_t FrameArena::GetCapacity() const
+{
+    size_t capacity = 0;
+    for (auto pChunk = m_pFirstChunk; pChunk; pChunk = pChunk->pNext)
+    {
+        capacity += pChunk->Size;
+    }
+
+    return capacity;
+}
+
+void* FrameArena::TryAllocate(Chunk* apChunk, size_t aOffset, size_t aSize, size_t aAlignment)
+{
+    auto pBase = (char*)apChunk + cChunkHeaderSize;
+    auto address = (uintptr_t)(pBase + aOffset);
+    size_t offset = aOffset + (((address + aAlignment - 1) & ~(uintptr_t)(aAlignment - 1)) - address);
+
+    if (offset + aSize > apChunk->Size)
+        return nullptr;
+
+    m_offset = offset + aSize;
+    return pBase + offset;
+}
+
+FrameArena::Chunk* FrameArena::AllocateChunk(size_t aSize)
+{
+    auto pChunk = (Chunk*)m_pParentAllocator->Allocate(cChunkHeaderSize + aSize);
+    if (pChunk)
+    {
+        pChunk->pNext = nullptr;
+        pChunk->Size = aSize;
+    }
+
+    return pChunk;
+}
@@ -0,0 +1,92 @@
+#include "MemoryBudget.h"
+
+
+MemoryBudget::MemoryBudget(size_t aLimit, MemoryBudget* apParent) noexcept
+    : m_limit{ aLimit }
+    , m_pParent{ apParent }
+    , m_used{ 0 }
+    , m_peak{ 0 }
+    , m_deniedCount{ 0 }
+{
+}
+
+MemoryBudget::~MemoryBudget() noexcept
+{
+    // Whatever is still reserved here is also held by the parents, give it back
+    if (m_pParent)
+        m_pParent->Release(m_used.load(std::memory_order_relaxed));
+}
+
+bool MemoryBudget::Reserve(size_t aSize) noexcept
+{
+    size_t used = m_used.load(std::memory_order_relaxed);
+    do
+    {
+        if (aSize > m_limit - used)
+        {
+            m_deniedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    } while (!m_used.compare_exchange_weak(used, used + aSize, std::memory_order_relaxed));
+
+    if (m_pParent && !m_pParent->Reserve(aSize))
+    {
+        m_used.fetch_sub(aSize, std::memory_order_relaxed);
+        m_deniedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    const size_t cUsed = used + aSize;
+    size_t peak = m_peak.load(std::memory_order_relaxed);
+    while (peak < cUsed && !m_peak.compare_exchange_weak(peak, cUsed, std::memory_order_relaxed));
+
+    return true;
+}
+
+void MemoryBudget::Release(size_t aSize) noexcept
+{
+    m_used.fetch_sub(aSize, std::memory_order_relaxed);
+
+    if (m_pParent)
+        m_pParent->Release(aSize);
+}
+
+size_t MemoryBudget::GetLimit() const noexcept
+{
+    return m_limit;
+}
+
+size_t MemoryBudget::GetUsed() const noexcept
+{
+    return m_used.load(std::memory_order_relaxed);
+}
+
+size_t MemoryBudget::GetAvailable() const noexcept
+{
+    const size_t cUsed = GetUsed();
+    size_t available = cUsed < m_limit ? m_limit - cUsed : 0;
+
+    if (m_pParent)
+    {
+        const size_t cParentAvailable = m_pParent->GetAvailable();
+        if (cParentAvailable < available)
+            available = cParentAvailable;
+    }
+
+    return available;
+}
+
+size_t MemoryBudget::GetPeak() const noexcept
+{
+    return m_peak.load(std::memory_order_relaxed);
+}
+
+size_t MemoryBudget::GetDeniedCount() const noexcept
+{
+    return m_deniedCount.load(std::memory_order_relaxed);
+}
+
+MemoryBudget* MemoryBudget::GetParent() const noexcept
+{
+    return m_pParent;
+}
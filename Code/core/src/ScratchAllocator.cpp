@@ -20,7 +20,12 @@ ScratchAllocator::~ScratchAllocator()
 
 void* ScratchAllocator::Allocate(size_t aSize)
 {
-    if (std::align(alignof(std::max_align_t), aSize, m_pData, m_size))
+    return Allocate(aSize, alignof(std::max_align_t));
+}
+
+void* ScratchAllocator::Allocate(size_t aSize, size_t aAlignment)
+{
+    if (std::align(aAlignment, aSize, m_pData, m_size))
     {
         void* pResult = m_pData;
         m_pData = (char*)m_pData + aSize;
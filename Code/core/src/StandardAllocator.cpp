@@ -1,16 +1,62 @@
 #include "StandardAllocator.h"
 
+#include <cstdint>
 #include <cstdlib>
 #include <malloc.h>
 
+#ifdef _WIN32
+// On windows memory obtained from _aligned_malloc must be released with _aligned_free, so everything goes through it
+// _aligned_msize must be given the alignment the block was made with, every block starts with a header holding it
+static constexpr size_t s_headerSize = alignof(details::default_align_t);
+
+static void* AllocateAligned(size_t aSize, size_t aAlignment)
+{
+    if (aSize > SIZE_MAX - s_headerSize)
+        return nullptr;
+
+    // The offset makes the data after the header aligned, not the block itself
+    auto pBlock = (char*)_aligned_offset_malloc(aSize + s_headerSize, aAlignment, s_headerSize);
+    if (pBlock == nullptr)
+        return nullptr;
+
+    *(size_t*)pBlock = aAlignment;
+    return pBlock + s_headerSize;
+}
+#endif
+
 void* StandardAllocator::Allocate(size_t aSize)
 {
+#ifdef _WIN32
+    return AllocateAligned(aSize, alignof(details::default_align_t));
+#else
     return malloc(aSize);
+#endif
+}
+
+void* StandardAllocator::Allocate(size_t aSize, size_t aAlignment)
+{
+    if (aAlignment <= alignof(details::default_align_t))
+        return StandardAllocator::Allocate(aSize);
+
+#ifdef _WIN32
+    return AllocateAligned(aSize, aAlignment);
+#else
+    void* pData = nullptr;
+    if (posix_memalign(&pData, aAlignment, aSize) != 0)
+        return nullptr;
+
+    return pData;
+#endif
 }
 
 void StandardAllocator::Free(void* apData)
 {
+#ifdef _WIN32
+    if (apData != nullptr)
+        _aligned_free((char*)apData - s_headerSize);
+#else
     free(apData);
+#endif
 }
 
 size_t StandardAllocator::Size(void* apData)
@@ -18,11 +64,12 @@ size_t StandardAllocator::Size(void* apData)
     if (apData == nullptr) return 0;
 
 #ifdef _WIN32
-    return _msize(apData);
+    char* pBlock = (char*)apData - s_headerSize;
+    return _aligned_msize(pBlock, *(size_t*)pBlock, s_headerSize) - s_headerSize;
 #elif __linux__
     return malloc_usable_size(apData);
 #else
     static_assert(false, "Not implemented");
     return 0;
 #endif
-}
\ No newline at end of file
+}
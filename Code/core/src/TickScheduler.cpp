@@ -0,0 +1,106 @@
+#include "TickScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+TickScheduler::TickScheduler(uint32_t aTicksPerSecond, uint32_t aMaxCatchUpTicks) noexcept
+    : m_start(Now())
+    , m_tick(0)
+    , m_ticksPerSecond(std::max<uint32_t>(aTicksPerSecond, 1))
+    , m_maxCatchUpTicks(std::max<uint32_t>(aMaxCatchUpTicks, 1))
+{
+    ResetStats();
+}
+
+uint64_t TickScheduler::Now() noexcept
+{
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void TickScheduler::Reset(uint64_t aNow) noexcept
+{
+    m_start = aNow;
+    m_tick = 0;
+}
+
+uint32_t TickScheduler::GetTicksPerSecond() const noexcept
+{
+    return m_ticksPerSecond;
+}
+
+uint64_t TickScheduler::GetNextDeadline() const noexcept
+{
+    return GetDeadline(m_tick + 1);
+}
+
+uint64_t TickScheduler::GetTimeUntilNextTick(uint64_t aNow) const noexcept
+{
+    const uint64_t cDeadline = GetNextDeadline();
+    return aNow < cDeadline ? cDeadline - aNow : 0;
+}
+
+const TickScheduler::Stats& TickScheduler::GetStats() const noexcept
+{
+    return m_stats;
+}
+
+uint64_t TickScheduler::GetMeanNanoseconds() const noexcept
+{
+    return m_stats.TickCount ? m_stats.TotalNanoseconds / m_stats.TickCount : 0;
+}
+
+void TickScheduler::ResetStats() noexcept
+{
+    m_stats = Stats{};
+    m_stats.MinNanoseconds = UINT64_MAX;
+}
+
+uint64_t TickScheduler::GetDeadline(uint64_t aTick) const noexcept
+{
+    // Whole seconds first, the products can't overflow however long the schedule runs
+    const uint64_t cFraction = (aTick % m_ticksPerSecond) * 1000000000;
+    return m_start + (aTick / m_ticksPerSecond) * 1000000000 + (cFraction + m_ticksPerSecond - 1) / m_ticksPerSecond;
+}
+
+uint64_t TickScheduler::GetTickMilliseconds(uint64_t aTick) const noexcept
+{
+    return (aTick / m_ticksPerSecond) * 1000 + (aTick % m_ticksPerSecond) * 1000 / m_ticksPerSecond;
+}
+
+uint32_t TickScheduler::CollectDue(uint64_t aNow) noexcept
+{
+    if (aNow < m_start)
+        return 0;
+
+    const uint64_t cElapsed = aNow - m_start;
+    const uint64_t cTicks = (cElapsed / 1000000000) * m_ticksPerSecond + (cElapsed % 1000000000) * m_ticksPerSecond / 1000000000;
+
+    if (cTicks <= m_tick)
+        return 0;
+
+    uint64_t due = cTicks - m_tick;
+    if (due > m_maxCatchUpTicks)
+    {
+        m_stats.SkippedCount += due - m_maxCatchUpTicks;
+        m_tick += due - m_maxCatchUpTicks;
+        due = m_maxCatchUpTicks;
+    }
+
+    return uint32_t(due);
+}
+
+void TickScheduler::Record(uint64_t aDeadline, uint64_t aStart, uint64_t aEnd) noexcept
+{
+    const uint64_t cDuration = aEnd - aStart;
+
+    ++m_stats.TickCount;
+    m_stats.TotalNanoseconds += cDuration;
+    m_stats.MinNanoseconds = std::min(m_stats.MinNanoseconds, cDuration);
+    m_stats.MaxNanoseconds = std::max(m_stats.MaxNanoseconds, cDuration);
+
+    if (cDuration > 1000000000 / m_ticksPerSecond)
+        ++m_stats.OverrunCount;
+
+    if (aStart > aDeadline)
+        m_stats.MaxLatenessNanoseconds = std::max(m_stats.MaxLatenessNanoseconds, aStart - aDeadline);
+}
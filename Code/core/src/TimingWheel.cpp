@@ -0,0 +1,223 @@
+#include "TimingWheel.h"
+
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static size_t CountTrailingZeros(uint64_t aValue)
+{
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward64(&index, aValue);
+    return index;
+#else
+    return size_t(__builtin_ctzll(aValue));
+#endif
+}
+
+static size_t HighestBit(uint64_t aValue)
+{
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanReverse64(&index, aValue);
+    return index;
+#else
+    return size_t(63 - __builtin_clzll(aValue));
+#endif
+}
+
+TimingWheel::TimingWheel(size_t aCapacity)
+    : m_timers(aCapacity, Timer{ 0, 0, cNone, cNone, cFree }, StlAllocator<Timer>(GetAllocator()))
+    , m_occupied{}
+    , m_freeHead(aCapacity > 0 ? 0 : cNone)
+    , m_time(0)
+    , m_count(0)
+{
+    std::fill(std::begin(m_heads), std::end(m_heads), cNone);
+
+    for (size_t i = 0; i + 1 < aCapacity; ++i)
+        m_timers[i].Next = uint32_t(i + 1);
+}
+
+TimingWheel::TimerId TimingWheel::Schedule(uint64_t aDelay, uint64_t aUserData)
+{
+    if (m_freeHead == cNone)
+        return cInvalidTimer;
+
+    const uint32_t cIndex = m_freeHead;
+    m_freeHead = m_timers[cIndex].Next;
+
+    Timer& timer = m_timers[cIndex];
+    timer.Deadline = m_time + std::max<uint64_t>(aDelay, 1);
+    timer.UserData = aUserData;
+
+    Link(cIndex);
+    ++m_count;
+
+    return cIndex;
+}
+
+bool TimingWheel::Cancel(TimerId aTimer)
+{
+    if (!IsScheduled(aTimer))
+        return false;
+
+    Unlink(aTimer);
+
+    m_timers[aTimer].Bucket = cFree;
+    m_timers[aTimer].Next = m_freeHead;
+    m_freeHead = aTimer;
+    --m_count;
+
+    return true;
+}
+
+bool TimingWheel::IsScheduled(TimerId aTimer) const
+{
+    return aTimer < m_timers.size() && m_timers[aTimer].Bucket != cFree;
+}
+
+size_t TimingWheel::Advance(uint64_t aTicks, const std::function<void(uint64_t aUserData)>& acCallback)
+{
+    const uint64_t cTarget = m_time + aTicks;
+    size_t fired = 0;
+
+    while (m_time < cTarget)
+    {
+        if (m_count == 0)
+        {
+            m_time = cTarget;
+            break;
+        }
+
+        // Jump straight to the next occupied slot of level 0, or to the next cascade if there is none left in this rotation
+        const size_t cSlot = size_t(m_time & (SlotCount - 1));
+        const uint64_t cAhead = cSlot + 1 < SlotCount ? m_occupied[0] & (~uint64_t(0) << (cSlot + 1)) : 0;
+        const uint64_t cNext = cAhead ? (m_time & ~uint64_t(SlotCount - 1)) + CountTrailingZeros(cAhead) : (m_time | (SlotCount - 1)) + 1;
+
+        m_time = std::min(cNext, cTarget);
+
+        if ((m_time & (SlotCount - 1)) == 0)
+        {
+            // Higher levels first, their timers may land in the level below which is then cascaded as well
+            size_t level = 1;
+            while (level < LevelCount && (m_time & ((uint64_t(1) << (SlotBits * level)) - 1)) == 0)
+                ++level;
+
+            if (level == LevelCount && (m_time & ((uint64_t(1) << (SlotBits * LevelCount)) - 1)) == 0)
+                Cascade(cOverflow);
+
+            for (size_t i = level - 1; i > 0; --i)
+                Cascade(uint16_t(i * SlotCount + ((m_time >> (SlotBits * i)) & (SlotCount - 1))));
+        }
+
+        fired += Expire(uint16_t(m_time & (SlotCount - 1)), acCallback);
+    }
+
+    return fired;
+}
+
+uint64_t TimingWheel::GetTime() const
+{
+    return m_time;
+}
+
+size_t TimingWheel::GetCount() const
+{
+    return m_count;
+}
+
+size_t TimingWheel::GetCapacity() const
+{
+    return m_timers.size();
+}
+
+void TimingWheel::Link(uint32_t aIndex)
+{
+    Timer& timer = m_timers[aIndex];
+
+    // The level is picked from the highest bit that differs from the current time
+    // so the slot is always reached by a cascade before the deadline and after now
+    // A cascaded timer can be due right now, it goes to level 0 and expires in the same step
+    const uint64_t cDifference = timer.Deadline ^ m_time;
+    const size_t cLevel = cDifference ? HighestBit(cDifference) / SlotBits : 0;
+
+    if (cLevel >= LevelCount)
+    {
+        timer.Bucket = cOverflow;
+    }
+    else
+    {
+        const size_t cSlot = size_t(timer.Deadline >> (SlotBits * cLevel)) & (SlotCount - 1);
+        timer.Bucket = uint16_t(cLevel * SlotCount + cSlot);
+        m_occupied[cLevel] |= uint64_t(1) << cSlot;
+    }
+
+    timer.Previous = cNone;
+    timer.Next = m_heads[timer.Bucket];
+    if (timer.Next != cNone)
+        m_timers[timer.Next].Previous = aIndex;
+
+    m_heads[timer.Bucket] = aIndex;
+}
+
+void TimingWheel::Unlink(uint32_t aIndex)
+{
+    Timer& timer = m_timers[aIndex];
+
+    if (timer.Previous != cNone)
+        m_timers[timer.Previous].Next = timer.Next;
+    else
+        m_heads[timer.Bucket] = timer.Next;
+
+    if (timer.Next != cNone)
+        m_timers[timer.Next].Previous = timer.Previous;
+
+    if (m_heads[timer.Bucket] == cNone && timer.Bucket != cOverflow)
+        m_occupied[timer.Bucket / SlotCount] &= ~(uint64_t(1) << (timer.Bucket % SlotCount));
+}
+
+void TimingWheel::Cascade(uint16_t aBucket)
+{
+    uint32_t index = m_heads[aBucket];
+
+    m_heads[aBucket] = cNone;
+    if (aBucket != cOverflow)
+        m_occupied[aBucket / SlotCount] &= ~(uint64_t(1) << (aBucket % SlotCount));
+
+    while (index != cNone)
+    {
+        const uint32_t cNext = m_timers[index].Next;
+        Link(index);
+        index = cNext;
+    }
+}
+
+size_t TimingWheel::Expire(uint16_t aBucket, const std::function<void(uint64_t aUserData)>& acCallback)
+{
+    size_t fired = 0;
+
+    // One timer at a time, the callback may cancel the others still in the bucket
+    while (m_heads[aBucket] != cNone)
+    {
+        const uint32_t cIndex = m_heads[aBucket];
+        Unlink(cIndex);
+
+        Timer& timer = m_timers[cIndex];
+        const uint64_t cUserData = timer.UserData;
+
+        timer.Bucket = cFree;
+        timer.Next = m_freeHead;
+        m_freeHead = cIndex;
+        --m_count;
+
+        if (acCallback)
+            acCallback(cUserData);
+
+        ++fired;
+    }
+
+    return fired;
+}
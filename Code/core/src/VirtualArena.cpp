@@ -0,0 +1,196 @@
+#include "VirtualArena.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static constexpr size_t cHugePageSize = 2 << 20;
+
+static size_t AlignUp(size_t aValue, size_t aAlignment)
+{
+    return (aValue + aAlignment - 1) & ~(aAlignment - 1);
+}
+
+VirtualArena::VirtualArena(size_t aReservedSize, PageMode aPageMode)
+    : m_pBase(nullptr)
+    , m_reservedSize(0)
+    , m_committedSize(0)
+    , m_offset(0)
+    , m_pageSize(0)
+    , m_hugePages(false)
+{
+#ifdef _WIN32
+    // Large pages need SeLockMemoryPrivilege and can't be committed lazily, stick to regular pages
+    (void)aPageMode;
+
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    m_pageSize = systemInfo.dwPageSize;
+
+    const size_t cSize = AlignUp(aReservedSize, systemInfo.dwAllocationGranularity);
+    m_pBase = (char*)VirtualAlloc(nullptr, cSize, MEM_RESERVE, PAGE_NOACCESS);
+    if (m_pBase)
+        m_reservedSize = cSize;
+#else
+    m_pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+#ifdef MAP_HUGETLB
+    // Explicit huge pages are only used when the pool can back the whole range, faulting on an empty pool kills the process
+    if (aPageMode == kHugePages)
+    {
+        const size_t cSize = AlignUp(aReservedSize, cHugePageSize);
+        void* pData = mmap(nullptr, cSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (pData != MAP_FAILED)
+        {
+            m_pBase = (char*)pData;
+            m_reservedSize = cSize;
+            m_pageSize = cHugePageSize;
+            m_hugePages = true;
+            return;
+        }
+    }
+#endif
+
+    const bool cUseHugePages = aPageMode != kRegularPages;
+
+    // Reserve a little more to start on a huge page boundary, transparent huge pages can only back aligned ranges
+    const size_t cSize = AlignUp(aReservedSize, cUseHugePages ? cHugePageSize : m_pageSize);
+    const size_t cSlack = cUseHugePages ? cHugePageSize : 0;
+
+    void* pData = mmap(nullptr, cSize + cSlack, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (pData == MAP_FAILED)
+        return;
+
+    auto pBase = (char*)AlignUp((size_t)pData, cUseHugePages ? cHugePageSize : m_pageSize);
+    const size_t cHead = pBase - (char*)pData;
+    if (cHead > 0)
+        munmap(pData, cHead);
+    if (cSlack - cHead > 0)
+        munmap(pBase + cSize, cSlack - cHead);
+
+    m_pBase = pBase;
+    m_reservedSize = cSize;
+
+#ifdef MADV_HUGEPAGE
+    if (cUseHugePages && madvise(m_pBase, m_reservedSize, MADV_HUGEPAGE) == 0)
+    {
+        // Commit whole huge pages at once so the kernel can back them with a single entry
+        m_pageSize = cHugePageSize;
+        m_hugePages = true;
+    }
+#endif
+#endif
+}
+
+VirtualArena::~VirtualArena()
+{
+    if (m_pBase == nullptr)
+        return;
+
+#ifdef _WIN32
+    VirtualFree(m_pBase, 0, MEM_RELEASE);
+#else
+    munmap(m_pBase, m_reservedSize);
+#endif
+}
+
+void* VirtualArena::Allocate(size_t aSize)
+{
+    return Allocate(aSize, alignof(details::default_align_t));
+}
+
+void* VirtualArena::Allocate(size_t aSize, size_t aAlignment)
+{
+    if (m_pBase == nullptr)
+        return nullptr;
+
+    const size_t cOffset = AlignUp(m_offset, aAlignment);
+    if (cOffset > m_reservedSize || aSize > m_reservedSize - cOffset)
+        return nullptr;
+
+    if (!Commit(cOffset + aSize))
+        return nullptr;
+
+    m_offset = cOffset + aSize;
+    return m_pBase + cOffset;
+}
+
+void VirtualArena::Free(void* apData)
+{
+    // memory is released by Reset
+    (void)apData;
+}
+
+size_t VirtualArena::Size(void* apData)
+{
+    (void)apData;
+    return m_reservedSize - m_offset;
+}
+
+bool VirtualArena::Prefault(size_t aSize)
+{
+    if (aSize > m_reservedSize || !Commit(aSize))
+        return false;
+
+    for (size_t offset = 0; offset < aSize; offset += m_pageSize)
+    {
+        ((volatile char*)m_pBase)[offset] = 0;
+    }
+
+    return true;
+}
+
+void VirtualArena::Reset()
+{
+    // Committed pages are kept, they are already mapped for the next round
+    m_offset = 0;
+}
+
+bool VirtualArena::IsValid() const
+{
+    return m_pBase != nullptr;
+}
+
+bool VirtualArena::UsesHugePages() const
+{
+    return m_hugePages;
+}
+
+size_t VirtualArena::GetReservedSize() const
+{
+    return m_reservedSize;
+}
+
+size_t VirtualArena::GetCommittedSize() const
+{
+    return m_committedSize;
+}
+
+size_t VirtualArena::GetPageSize() const
+{
+    return m_pageSize;
+}
+
+bool VirtualArena::Commit(size_t aSize)
+{
+    if (aSize <= m_committedSize)
+        return true;
+
+    size_t committedSize = AlignUp(aSize, m_pageSize);
+    if (committedSize > m_reservedSize)
+        committedSize = m_reservedSize;
+
+#ifdef _WIN32
+    if (VirtualAlloc(m_pBase + m_committedSize, committedSize - m_committedSize, MEM_COMMIT, PAGE_READWRITE) == nullptr)
+        return false;
+#else
+    if (mprotect(m_pBase + m_committedSize, committedSize - m_committedSize, PROT_READ | PROT_WRITE) != 0)
+        return false;
+#endif
+
+    m_committedSize = committedSize;
+    return true;
+}
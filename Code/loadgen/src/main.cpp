@@ -0,0 +1,364 @@
+#include "Server.h"
+#include "Client.h"
+#include "Resolver.h"
+#include "TickScheduler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Headless swarm of bots stressing a server over loopback, every bot is a Client updated from a single loop
+// Bots send timestamped messages, the server echoes them back and the bots measure the round trip
+// Without --server an echo server runs in the same process in threaded mode, so the bots and the server don't share a thread
+
+namespace
+{
+    struct Settings
+    {
+        size_t Clients = 100;
+        size_t MessageSize = 64;
+        double MessageRate = 10.0;
+        // Fraction of the bots replaced every second
+        double Churn = 0.0;
+        uint64_t Duration = 10;
+        uint32_t TickRate = 100;
+        std::string Server;
+    };
+
+    struct Stats
+    {
+        uint64_t Handshakes = 0;
+        uint64_t HandshakeNanoseconds = 0;
+        uint64_t MessagesSent = 0;
+        uint64_t MessagesReceived = 0;
+        // Bots replaced by the churn, they tell the server they leave
+        uint64_t Departures = 0;
+        // Bots dropped by the server or timed out
+        uint64_t Disconnections = 0;
+        std::vector<uint64_t> Latencies;
+    };
+
+    class EchoServer : public Server
+    {
+    public:
+
+        static constexpr uint32_t MaxAdmissionRate = 1000000;
+
+        EchoServer(size_t aMaxConnections)
+            : Server(aMaxConnections)
+        {
+            // Every bot comes from the same address, connection storms are what we are measuring
+            GetAdmissionControl().SetSourceRate(MaxAdmissionRate, MaxAdmissionRate);
+            GetAdmissionControl().SetGlobalRate(MaxAdmissionRate, MaxAdmissionRate);
+        }
+
+        uint64_t m_messages = 0;
+        uint64_t m_bytes = 0;
+        uint64_t m_connections = 0;
+        // Also counts the handshakes that never completed, there is no live client count to derive from it
+        uint64_t m_disconnections = 0;
+
+    protected:
+
+        bool OnMessageReceived(const Endpoint& acRemoteEndpoint, const Message& acMessage) noexcept override
+        {
+            ++m_messages;
+            m_bytes += acMessage.GetLen();
+
+            return SendPayload(acRemoteEndpoint, acMessage.GetView());
+        }
+
+        bool OnClientConnected(const Endpoint&) noexcept override
+        {
+            ++m_connections;
+            return true;
+        }
+
+        bool OnClientDisconnected(const Endpoint&) noexcept override
+        {
+            ++m_disconnections;
+            return true;
+        }
+    };
+
+    class Bot : public Client
+    {
+    public:
+
+        Bot(const Endpoint& acServer, Stats& aStats)
+            : Client(acServer)
+            , m_stats(aStats)
+            , m_connectStart(TickScheduler::Now())
+            , m_credit(0.0)
+            , m_connected(false)
+        {}
+
+        bool IsConnected() const
+        {
+            return m_connected;
+        }
+
+        void Tick(uint64_t aElapsedMilliseconds, const Settings& acSettings, std::vector<uint8_t>& aScratch)
+        {
+            Update(aElapsedMilliseconds);
+
+            if (!m_connected)
+                return;
+
+            m_credit += acSettings.MessageRate * double(aElapsedMilliseconds) / 1000.0;
+            while (m_credit >= 1.0)
+            {
+                m_credit -= 1.0;
+
+                const uint64_t cNow = TickScheduler::Now();
+                std::memcpy(aScratch.data(), &cNow, sizeof(cNow));
+
+                if (SendPayload(aScratch.data(), aScratch.size()))
+                    ++m_stats.MessagesSent;
+            }
+        }
+
+    protected:
+
+        bool OnMessageReceived(const Endpoint&, const Message& acMessage) noexcept override
+        {
+            uint64_t sent = 0;
+            if (!acMessage.GetData().ReadBytes((uint8_t*)&sent, sizeof(sent)))
+                return false;
+
+            ++m_stats.MessagesReceived;
+            m_stats.Latencies.push_back(TickScheduler::Now() - sent);
+
+            return true;
+        }
+
+        bool OnConnected(const Endpoint&) noexcept override
+        {
+            m_connected = true;
+
+            ++m_stats.Handshakes;
+            m_stats.HandshakeNanoseconds += TickScheduler::Now() - m_connectStart;
+
+            return true;
+        }
+
+        bool OnDisconnected(const Endpoint&) noexcept override
+        {
+            m_connected = false;
+            ++m_stats.Disconnections;
+
+            return true;
+        }
+
+    private:
+
+        Stats& m_stats;
+        uint64_t m_connectStart;
+        double m_credit;
+        bool m_connected;
+    };
+
+    bool ParseArguments(int aArgc, char** apArgv, Settings& aSettings)
+    {
+        for (int i = 1; i < aArgc; ++i)
+        {
+            const char* pArgument = apArgv[i];
+            const char* pValue = std::strchr(pArgument, '=');
+            if (pValue == nullptr)
+                return false;
+
+            const std::string cName(pArgument, pValue++);
+
+            if (cName == "--clients")
+                aSettings.Clients = std::strtoull(pValue, nullptr, 10);
+            else if (cName == "--size")
+                aSettings.MessageSize = std::max<size_t>(std::strtoull(pValue, nullptr, 10), sizeof(uint64_t));
+            else if (cName == "--rate")
+                aSettings.MessageRate = std::strtod(pValue, nullptr);
+            else if (cName == "--churn")
+                aSettings.Churn = std::strtod(pValue, nullptr);
+            else if (cName == "--duration")
+                aSettings.Duration = std::strtoull(pValue, nullptr, 10);
+            else if (cName == "--tick-rate")
+                aSettings.TickRate = uint32_t(std::strtoul(pValue, nullptr, 10));
+            else if (cName == "--server")
+                aSettings.Server = pValue;
+            else
+                return false;
+        }
+
+        return aSettings.Clients > 0 && aSettings.MessageSize <= Message::MaxMessageSize;
+    }
+
+    double ToMilliseconds(uint64_t aNanoseconds)
+    {
+        return double(aNanoseconds) / 1e6;
+    }
+
+    void ReportLatencies(std::vector<uint64_t>& aLatencies)
+    {
+        if (aLatencies.empty())
+        {
+            std::printf("latency: no echo received\n");
+            return;
+        }
+
+        std::sort(aLatencies.begin(), aLatencies.end());
+
+        auto percentile = [&aLatencies](double aFraction)
+        {
+            return ToMilliseconds(aLatencies[std::min(aLatencies.size() - 1, size_t(aFraction * aLatencies.size()))]);
+        };
+
+        std::printf("latency ms: p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f\n",
+            percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999), ToMilliseconds(aLatencies.back()));
+    }
+}
+
+int main(int aArgc, char** apArgv)
+{
+    Settings settings;
+    if (!ParseArguments(aArgc, apArgv, settings))
+    {
+        std::printf("usage: LoadGenerator [--clients=N] [--size=BYTES] [--rate=MESSAGES_PER_SECOND] [--churn=FRACTION_PER_SECOND]\n"
+                    "                     [--duration=SECONDS] [--tick-rate=HZ] [--server=HOST:PORT]\n"
+                    "An external server has to echo every message back, each bot needs its own socket so raise the open file limit for large swarms\n");
+        return 1;
+    }
+
+    InitializeNetwork();
+
+    std::unique_ptr<EchoServer> pServer;
+    Endpoint serverEndpoint;
+
+    if (settings.Server.empty())
+    {
+        // Room for the bots being replaced in case their disconnection is lost
+        pServer.reset(new EchoServer(settings.Clients * 2));
+        if (!pServer->Start(0, Server::kThreaded))
+        {
+            std::printf("could not start the server\n");
+            return 1;
+        }
+
+        Resolver resolver("127.0.0.1");
+        serverEndpoint = resolver[0];
+        serverEndpoint.SetPort(pServer->GetPort());
+    }
+    else
+    {
+        Resolver resolver(settings.Server);
+        if (resolver.begin() == resolver.end())
+        {
+            std::printf("could not resolve %s\n", settings.Server.c_str());
+            return 1;
+        }
+
+        serverEndpoint = resolver[0];
+    }
+
+    Stats stats;
+    std::vector<uint8_t> scratch(settings.MessageSize, 0x2A);
+    std::mt19937 rng(std::random_device{}());
+
+    // Everyone connects at once
+    std::vector<std::unique_ptr<Bot>> bots;
+    for (size_t i = 0; i < settings.Clients; ++i)
+        bots.emplace_back(new Bot(serverEndpoint, stats));
+
+    TickScheduler scheduler(settings.TickRate);
+    const uint64_t cStart = TickScheduler::Now();
+    const uint64_t cEnd = cStart + settings.Duration * 1000000000;
+    uint64_t nextReport = cStart + 1000000000;
+    double churnCredit = 0.0;
+
+    Stats lastReport;
+    uint64_t lastServerMessages = 0;
+
+    while (TickScheduler::Now() < cEnd)
+    {
+        // Bots are polled every tick rather than waited on, the loop sleeps until the next tick
+        std::this_thread::sleep_for(std::chrono::nanoseconds(scheduler.GetTimeUntilNextTick(TickScheduler::Now())));
+
+        scheduler.RunDue(TickScheduler::Now(), [&](uint64_t aElapsedMilliseconds)
+        {
+            if (pServer)
+                pServer->Update(aElapsedMilliseconds);
+
+            for (auto& pBot : bots)
+                pBot->Tick(aElapsedMilliseconds, settings, scratch);
+
+            // Connect and disconnect storms, a replaced bot sends its disconnection before a new one starts a handshake
+            churnCredit += settings.Churn * double(bots.size()) * double(aElapsedMilliseconds) / 1000.0;
+            while (churnCredit >= 1.0)
+            {
+                churnCredit -= 1.0;
+
+                auto& pBot = bots[rng() % bots.size()];
+                pBot->Disconnect();
+                ++stats.Departures;
+                pBot.reset(new Bot(serverEndpoint, stats));
+            }
+        });
+
+        const uint64_t cNow = TickScheduler::Now();
+        if (cNow >= nextReport)
+        {
+            nextReport += 1000000000;
+
+            const size_t cConnected = size_t(std::count_if(bots.begin(), bots.end(), [](const std::unique_ptr<Bot>& acpBot) { return acpBot->IsConnected(); }));
+
+            std::printf("%3.0fs  connected %zu/%zu  handshakes/s %llu  sent/s %llu  echoed/s %llu",
+                double(cNow - cStart) / 1e9, cConnected, bots.size(),
+                (unsigned long long)(stats.Handshakes - lastReport.Handshakes),
+                (unsigned long long)(stats.MessagesSent - lastReport.MessagesSent),
+                (unsigned long long)(stats.MessagesReceived - lastReport.MessagesReceived));
+
+            if (pServer)
+            {
+                std::printf("  server messages/s %llu  disconnections %llu", (unsigned long long)(pServer->m_messages - lastServerMessages), (unsigned long long)pServer->m_disconnections);
+                lastServerMessages = pServer->m_messages;
+            }
+
+            std::printf("\n");
+
+            lastReport.Handshakes = stats.Handshakes;
+            lastReport.MessagesSent = stats.MessagesSent;
+            lastReport.MessagesReceived = stats.MessagesReceived;
+        }
+    }
+
+    const double cSeconds = double(TickScheduler::Now() - cStart) / 1e9;
+    const TickScheduler::Stats& cTickStats = scheduler.GetStats();
+
+    std::printf("\n%zu bots, %zu byte messages at %.1f/s each, churn %.2f/s, %.1fs\n", settings.Clients, settings.MessageSize, settings.MessageRate, settings.Churn, cSeconds);
+    std::printf("handshakes: %llu, %.1f/s, mean %.3f ms\n", (unsigned long long)stats.Handshakes, double(stats.Handshakes) / cSeconds,
+        stats.Handshakes ? ToMilliseconds(stats.HandshakeNanoseconds / stats.Handshakes) : 0.0);
+    std::printf("messages: %llu sent, %llu echoed\n", (unsigned long long)stats.MessagesSent, (unsigned long long)stats.MessagesReceived);
+    std::printf("bots: %llu replaced, %llu dropped\n", (unsigned long long)stats.Departures, (unsigned long long)stats.Disconnections);
+
+    if (pServer)
+    {
+        std::printf("server: %.0f messages/s, %.3f MB/s, %llu connections, %llu disconnections\n", double(pServer->m_messages) / cSeconds,
+            double(pServer->m_bytes) / cSeconds / (1 << 20), (unsigned long long)pServer->m_connections, (unsigned long long)pServer->m_disconnections);
+    }
+
+    std::printf("ticks: %llu, %llu skipped, mean %.3f ms, max %.3f ms\n", (unsigned long long)cTickStats.TickCount, (unsigned long long)cTickStats.SkippedCount,
+        ToMilliseconds(scheduler.GetMeanNanoseconds()), ToMilliseconds(cTickStats.MaxNanoseconds));
+
+    ReportLatencies(stats.Latencies);
+
+    // Bots go before the server, their disconnections are still sent
+    bots.clear();
+    pServer.reset();
+
+    ShutdownNetwork();
+
+    return 0;
+}
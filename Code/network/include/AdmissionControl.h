@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Endpoint.h"
+#include "StlAllocator.h"
+
+#include <vector>
+
+// Rate limits new connections before anything is allocated or computed for them
+// A source is an IPv4 address or an IPv6 /64, it draws from token buckets laid out as a count-min sketch:
+// each row hashes it to one bucket and it is admitted only when all of them have a token
+// Colliding sources share buckets so they can only be limited more, never less, and memory doesn't grow with the number of sources
+// A global bucket caps new connections from every source together, spoofed addresses don't get around it
+class AdmissionControl : public AllocatorCompatible
+{
+public:
+
+    static constexpr size_t RowCount = 4;
+    static constexpr size_t ColumnBits = 10;
+    static constexpr size_t ColumnCount = 1 << ColumnBits;
+
+    static constexpr uint32_t DefaultSourceRate = 4;
+    static constexpr uint32_t DefaultSourceBurst = 8;
+    static constexpr uint32_t DefaultGlobalRate = 1000;
+    static constexpr uint32_t DefaultGlobalBurst = 1000;
+
+    AdmissionControl() noexcept;
+    AdmissionControl(const AdmissionControl&) = delete;
+
+    AdmissionControl& operator=(const AdmissionControl&) = delete;
+
+    // Rates are in connections per second, a burst is how many can be taken at once after being idle
+    void SetSourceRate(uint32_t aRate, uint32_t aBurst) noexcept;
+    void SetGlobalRate(uint32_t aRate, uint32_t aBurst) noexcept;
+
+    // Takes a token for the source when it has one, denied sources don't take anything
+    bool Admit(const Endpoint& acSource) noexcept;
+    void Advance(uint64_t aElapsedMilliseconds) noexcept;
+
+    size_t GetAdmittedCount() const noexcept;
+    size_t GetDeniedCount() const noexcept;
+
+private:
+
+    // Tokens are counted in thousandths, a rate of one per second adds one thousandth per millisecond
+    static constexpr uint32_t TokenScale = 1000;
+
+    struct Bucket
+    {
+        uint32_t Tokens;
+        uint32_t LastRefill;
+    };
+
+    static uint64_t GetSourceKey(const Endpoint& acSource) noexcept;
+    // Bursts too large for a bucket are capped to the most it can hold
+    static uint32_t GetCapacity(uint32_t aBurst) noexcept;
+    void Refill(Bucket& aBucket, uint32_t aRate, uint32_t aBurst) const noexcept;
+
+    std::vector<Bucket, StlAllocator<Bucket>> m_buckets;
+    uint64_t m_seeds[RowCount];
+    Bucket m_global;
+    uint64_t m_now;
+    uint32_t m_sourceRate;
+    uint32_t m_sourceBurst;
+    uint32_t m_globalRate;
+    uint32_t m_globalBurst;
+    size_t m_admittedCount;
+    size_t m_deniedCount;
+};
@@ -2,6 +2,9 @@
 
 #include "Socket.h"
 #include "ConnectionManager.h"
+#include "FrameArena.h"
+#include "ReceivedMessage.h"
+#include "TickScheduler.h"
 
 class Client : public AllocatorCompatible
     , public Connection::ICommunication
@@ -10,20 +13,57 @@ public:
     Client(const Endpoint& acRemoteEndpoint);
 
     void Disconnect() noexcept;
-    bool Send(const Endpoint& acRemoteEndpoint, Buffer aBuffer) noexcept override;
+    bool Send(const Endpoint& acRemoteEndpoint, const BufferView& acBuffer) noexcept override;
+    bool Send(const Endpoint& acRemoteEndpoint, const BufferChain& acChain) noexcept override;
     bool SendPayload(uint8_t *apData, size_t aLength) noexcept;
+    bool SendPayload(const BufferView& acPayload) noexcept;
+
+    Allocator* GetFrameAllocator() noexcept override;
 
     uint32_t Update(uint64_t aElapsedMilliSeconds) noexcept;
+    // Sleeps until the scheduler's next tick, then calls Update and aOnTick(aElapsedMilliseconds) for each tick due, returns how many ran
+    // Packets arriving before the deadline are processed right away, batched messages wait for the next Update
+    // Without batched delivery OnMessageReceived and OnConnected are called from Run between ticks
+    template<class T>
+    uint32_t Run(TickScheduler& aScheduler, T&& aOnTick) noexcept;
+
+    // Messages are collected during Update instead of going through OnMessageReceived one at a time
+    void SetBatchedDelivery(bool aBatched) noexcept;
+    // Messages received by the last Update, in arrival order, they can be reordered in place
+    ReceivedMessage* GetReceivedMessages() noexcept;
+    size_t GetReceivedMessageCount() const noexcept;
 
 protected:
     bool ProcessPacket(Socket::Packet& aPacket) noexcept;
 
+    // Not called with batched delivery, batched users still override it so a missing override can't drop messages silently
     virtual bool OnMessageReceived(const Endpoint& acRemoteEndpoint, const Message& acMessage) noexcept = 0;
     virtual bool OnConnected(const Endpoint& acRemoteEndpoint) noexcept = 0;
     virtual bool OnDisconnected(const Endpoint& acRemoteEndpoint) noexcept = 0;
     
 private:
 
+    void WaitForTick(const TickScheduler& acScheduler) noexcept;
+    // The batch is only cleared once it was handed out, packets processed between ticks add to it
+    void BeginBatch() noexcept;
+    uint32_t Work() noexcept;
+
     Connection m_connection;
     Socket m_socket;
-};
\ No newline at end of file
+    FrameArena m_frameArena;
+    std::vector<ReceivedMessage, StlAllocator<ReceivedMessage>> m_receivedMessages;
+    bool m_batched;
+    bool m_batchDelivered;
+};
+
+template<class T>
+uint32_t Client::Run(TickScheduler& aScheduler, T&& aOnTick) noexcept
+{
+    WaitForTick(aScheduler);
+
+    return aScheduler.RunDue(TickScheduler::Now(), [this, &aOnTick](uint64_t aElapsedMilliseconds)
+    {
+        Update(aElapsedMilliseconds);
+        aOnTick(aElapsedMilliseconds);
+    });
+}
\ No newline at end of file
@@ -13,6 +13,10 @@ class Connection: public MessageReceiver
 public:
 
     typedef uint64_t HeaderType;
+    // Given by the server, the client puts it in its packets so they are routed without looking up its endpoint
+    typedef uint32_t Id;
+
+    static constexpr Id cInvalidId = 0;
 
     struct Header
     {
@@ -22,6 +26,7 @@ public:
             kConnection,
             kDisconnect,
             kPayload,
+            kRebind,
             kCount
         };
 
@@ -29,6 +34,10 @@ public:
         uint64_t Version;
         HeaderType Type;
         uint64_t Length;
+        // Only for the types that HasId
+        uint64_t ConnectionId;
+
+        static bool HasId(HeaderType aType);
     };
 
     enum State
@@ -52,9 +61,25 @@ public:
 
     struct ICommunication
     {
-        virtual bool Send(const Endpoint& acRemote, Buffer aBuffer) = 0;
+        virtual bool Send(const Endpoint& acRemote, const BufferView& acBuffer) = 0;
+        // Transports that can gather override this, by default the chain is copied in a single view
+        virtual bool Send(const Endpoint& acRemote, const BufferChain& acChain) { return Send(acRemote, acChain.Flatten()); }
+
+        // Allocator for buffers that are only needed until the end of the current tick
+        virtual Allocator* GetFrameAllocator() { return Allocator::Get(); }
+
+        // Budget the memory of each connection is charged to, null when unbounded
+        virtual MemoryBudget* GetMemoryBudget() { return nullptr; }
     };
 
+    // Memory a single connection may hold for messages waiting to be reassembled
+    static constexpr size_t MaxReassemblyMemory = 1 << 20;
+
+    // Timers in milliseconds, a connection is dropped when nothing was received for Timeout
+    static constexpr uint64_t Timeout = 15 * 1000;
+    static constexpr uint64_t NegotiationResendInterval = 100;
+    static constexpr uint64_t KeepAliveInterval = 5 * 1000;
+
     Connection(ICommunication& aCommunicationInterface, const Endpoint& acRemoteEndpoint, bool aIsServer=false);
     Connection(const Connection& acRhs) = delete;
     Connection(Connection&& aRhs) noexcept;
@@ -64,14 +89,34 @@ public:
     Connection& operator=(Connection&& aRhs) noexcept;
     Connection& operator=(const Connection& aRhs) = delete;
 
+    // Reads the header of any packet, to route it before knowing which connection it belongs to
+    static Outcome<Header, HeaderErrors> ReadHeader(Buffer::Reader& aReader);
+
     Outcome<HeaderType, Connection::HeaderErrors> ProcessPacket(Buffer::Reader & aReader);
     bool IsNegotiating() const;
     bool IsConnected() const;
 
     State GetState() const;
     const Endpoint& GetRemoteEndpoint() const;
+    // Also drops any pending rebind
+    void SetRemoteEndpoint(const Endpoint& acRemoteEndpoint);
+
+    Id GetId() const;
+    void SetId(Id aId);
+
+    // Server side, a packet with our id came from another address, probably after a NAT rebinding
+    // The address gets an encrypted challenge, only a peer holding the session key can answer it
+    // At most one challenge goes out per NegotiationResendInterval, returns false when it wasn't sent
+    bool RequestRebind(const Endpoint& acEndpoint);
+    bool CanRequestRebind() const;
+    // Address the last challenge was sent to, the connection may move there once a kRebind was processed
+    const Endpoint& GetRebindEndpoint() const;
 
     State Update(uint64_t aElapsedMilliseconds);
+    // Time accounting only, for connections that are not updated every tick
+    void AddElapsedTime(uint64_t aElapsedMilliseconds);
+    // Time until the next timeout, negotiation resend or keepalive, Update has nothing to do before that
+    uint64_t GetTimeUntilNextEvent() const;
     void Disconnect();
 
     void WriteHeader(Buffer::Writer& aWriter, HeaderType aHeaderType);
@@ -84,9 +129,12 @@ protected:
     Outcome<HeaderType, Connection::HeaderErrors> ProcessDisconnection(Buffer::Reader & aReader);
     Outcome<HeaderType, Connection::HeaderErrors> ProcessNegociation(Buffer::Reader & aReader);
     Outcome<HeaderType, Connection::HeaderErrors> ProcessConfirmation(Buffer::Reader & aReader);
+    Outcome<HeaderType, Connection::HeaderErrors> ProcessRebind(Buffer::Reader & aReader);
 
     void SendNegotiation();
     void SendConfirmation();
+    void SendKeepAlive();
+    void SendRebind(const Endpoint& acRemote, uint32_t aCode, uint32_t aSequence);
 
     bool WriteChallenge(Buffer::Writer& aWriter, uint32_t aCode);
     bool ReadChallenge(Buffer::Reader& aReader, uint32_t &aCode);
@@ -96,13 +144,25 @@ private:
     static constexpr size_t MaxNegotiationSize = 200;
     static constexpr size_t ClientPadding = Socket::MaxPacketSize - MaxNegotiationSize;
 
-    ICommunication& m_communication;
+    // Sequence numbers the challenge codes are encrypted with, away from the ones used by messages
+    static constexpr uint32_t RebindChallengeSequence = UINT32_MAX - 1;
+    static constexpr uint32_t RebindResponseSequence = UINT32_MAX - 2;
+
+    // Read on every packet and timer, kept together
     State m_state;
+    bool m_isServer;
+    uint32_t m_messageSeq;
     uint64_t m_timeSinceLastEvent;
+    uint64_t m_timeSinceLastSend;
     Endpoint m_remoteEndpoint;
+    Id m_id;
+
+    // Only needed to negotiate, send and disconnect, the filter keeps its state out of line
+    ICommunication& m_communication;
     DHChachaFilter m_filter;
     uint32_t m_challengeCode;
     uint32_t m_remoteCode;
-    uint32_t m_messageSeq;
-    bool m_isServer;
+    uint32_t m_rebindCode;
+    Endpoint m_rebindEndpoint;
+    uint64_t m_timeSinceRebindRequest;
 };
\ No newline at end of file
@@ -2,25 +2,75 @@
 
 #include "Socket.h"
 #include "Connection.h"
-#include <unordered_map>
+#include "StlAllocator.h"
+#include "TimingWheel.h"
+#include <vector>
 
+// Connections live in a slab that never moves, they are found through an open addressing table of slab indices
+// The table is kept at most half full and probed linearly, removals shift entries back so there are no tombstones
+// Each connection has a single timer in a timing wheel set to its next event, Update only touches connections whose timer fired
+// Connection ids are the slab index with a generation in the high bits, the id of a removed connection stops working
 class ConnectionManager : public AllocatorCompatible
 {
 public:
 
+    static constexpr size_t IdIndexBits = 20;
+    static constexpr size_t MaxConnections = size_t(1) << IdIndexBits;
+
+    // Capped to MaxConnections
     ConnectionManager(size_t aMaxConnections);
+    ConnectionManager(const ConnectionManager&) = delete;
+    ~ConnectionManager();
+
+    ConnectionManager& operator=(const ConnectionManager&) = delete;
 
     Connection* Find(const Endpoint& acEndpoint);
     const Connection* Find(const Endpoint& acEndpoint) const;
+    // Only a lookup, the packet's endpoint still has to be checked against the connection's
+    Connection* Get(Connection::Id aId);
 
-    void Add(Connection aConnection);
+    // Fails when full or when the endpoint already has a connection
+    bool Add(Connection aConnection);
+    // Moves a connection to another endpoint, fails when the endpoint already has a connection
+    bool Rebind(Connection& aConnection, const Endpoint& acEndpoint);
 
     bool IsFull() const;
+    size_t GetCount() const;
 
     void Update(uint64_t aElapsedMilliSeconds, std::function<bool(const Endpoint&)> aDisconnectedCallback = nullptr);
 
+    // Brings the connection's clock up to date, call it before the connection receives or sends anything
+    void Touch(Connection& aConnection);
+    // Updates the connection on the next tick, for state changes that can't wait for its timer such as a disconnection
+    void Wake(Connection& aConnection);
+
 private:
 
-    std::unordered_map<Endpoint, Connection> m_connections;
+    static constexpr uint32_t cEmptySlot = UINT32_MAX;
+    static constexpr uint32_t IdIndexMask = uint32_t(MaxConnections - 1);
+    static constexpr uint32_t GenerationCount = uint32_t(1) << (32 - IdIndexBits);
+
+    struct Slot
+    {
+        // Low bits of the hash, most mismatches are rejected without touching the connection
+        uint32_t Hash;
+        uint32_t Index;
+    };
+
+    size_t FindSlot(const Endpoint& acEndpoint, uint64_t aHash) const;
+    void Remove(uint32_t aIndex);
+    void RemoveSlot(size_t aSlot);
+    void OnTimer(uint32_t aIndex, const std::function<bool(const Endpoint&)>& acDisconnectedCallback);
+
+    std::vector<Slot, StlAllocator<Slot>> m_slots;
+    std::vector<uint32_t, StlAllocator<uint32_t>> m_freeIndices;
+    std::vector<bool, StlAllocator<bool>> m_used;
+    std::vector<uint16_t, StlAllocator<uint16_t>> m_generations;
+    std::vector<TimingWheel::TimerId, StlAllocator<TimingWheel::TimerId>> m_timerIds;
+    std::vector<uint64_t, StlAllocator<uint64_t>> m_lastUpdates;
+    TimingWheel m_timers;
+    Connection* m_pConnections;
+    size_t m_slotMask;
+    size_t m_count;
     size_t m_maxConnections;
-};
\ No newline at end of file
+};
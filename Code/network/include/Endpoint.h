@@ -33,6 +33,9 @@ public:
     const uint16_t* GetIPv6() const noexcept;
     uint16_t* GetIPv6() noexcept;
 
+    // Hashes the whole address as two words, equal endpoints always have the same hash
+    uint64_t Hash() const noexcept;
+
     bool ToNetIPv4(uint32_t& aDestination) const noexcept;
     bool ToNetIPv6(in6_addr& aDestination) const noexcept;
 
@@ -49,8 +52,6 @@ private:
         uint16_t m_ipv6[8];
     };
 
-    friend struct std::hash<Endpoint>;
-    
     Type m_type;
     uint16_t m_port;
 };
@@ -65,28 +66,7 @@ namespace std
 
         result_type operator()(argument_type const& s) const noexcept
         {
-            result_type result = 0;
-            hash_combine(result, (uint8_t)s.m_type);
-            hash_combine(result, s.m_port);
-
-            result_type tmp = 0;
-            if (s.IsIPv6())
-            {
-                for (auto c : s.m_ipv6)
-                {
-                    tmp = tmp * 31 + std::hash<uint16_t>()(c);
-                }
-            }
-            else if (s.IsIPv4())
-            {
-                for (auto c : s.m_ipv4)
-                {
-                    tmp = tmp * 31 + std::hash<uint8_t>()(c);
-                }
-            }
-            hash_combine(result, tmp);
-
-            return result;
+            return result_type(s.Hash());
         }
     };
 }
\ No newline at end of file
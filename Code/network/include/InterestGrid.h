@@ -0,0 +1,165 @@
+#pragma once
+
+#include "Endpoint.h"
+#include "BufferView.h"
+#include "StlAllocator.h"
+
+#include <unordered_map>
+#include <vector>
+
+class Server;
+
+// Spatial hash of entity positions deciding which connections each entity update is sent to
+// Space is cut in square cells, an observer sees every entity in the cells within its radius and each cell keeps the observers seeing it
+// Updates only touch the cells an entity or observer moves between, the enter and leave events say how each relevant set changed
+class InterestGrid : public AllocatorCompatible
+{
+public:
+
+    using EntityId = uint32_t;
+    using ObserverId = uint32_t;
+
+    static constexpr uint32_t cInvalidId = UINT32_MAX;
+
+    struct Event
+    {
+        enum
+        {
+            kEnter,
+            kLeave
+        };
+
+        uint32_t Type;
+        ObserverId Observer;
+        EntityId Entity;
+    };
+
+    InterestGrid(float aCellSize);
+    InterestGrid(const InterestGrid&) = delete;
+
+    InterestGrid& operator=(const InterestGrid&) = delete;
+
+    EntityId AddEntity(float aX, float aY);
+    void RemoveEntity(EntityId aEntity);
+    void MoveEntity(EntityId aEntity, float aX, float aY);
+
+    // Sees every entity in a square of 2 * aRadius + 1 cells centered on its own
+    // Observers don't get leave events when they are removed, their connection is expected to be gone
+    ObserverId AddObserver(const Endpoint& acRemote, float aX, float aY, uint32_t aRadius);
+    void RemoveObserver(ObserverId aObserver);
+    void MoveObserver(ObserverId aObserver, float aX, float aY);
+    const Endpoint& GetRemote(ObserverId aObserver) const;
+
+    // aFunc(ObserverId, const Endpoint&) for every observer seeing the entity
+    template<class T>
+    void ForEachObserver(EntityId aEntity, T&& aFunc) const;
+    // aFunc(EntityId) for every entity the observer sees
+    template<class T>
+    void ForEachRelevant(ObserverId aObserver, T&& aFunc) const;
+
+    // Sends the same payload to every observer seeing the entity, it is serialized once and shared, returns how many were sent
+    size_t Broadcast(Server& aServer, EntityId aEntity, const BufferView& acPayload) const;
+
+    // Relevant set changes since the last ClearEvents, in the order they happened
+    const Event* GetEvents() const;
+    size_t GetEventCount() const;
+    void ClearEvents();
+
+private:
+
+    struct Cell
+    {
+        Cell(Allocator* apAllocator);
+
+        std::vector<EntityId, StlAllocator<EntityId>> Entities;
+        std::vector<ObserverId, StlAllocator<ObserverId>> Observers;
+    };
+
+    struct Entity
+    {
+        int32_t X, Y;
+        bool Active;
+    };
+
+    struct Observer
+    {
+        Endpoint Remote;
+        int32_t X, Y;
+        int32_t Radius;
+        bool Active;
+    };
+
+    using CellMap = std::unordered_map<uint64_t, Cell, std::hash<uint64_t>, std::equal_to<uint64_t>, StlAllocator<std::pair<const uint64_t, Cell>>>;
+
+    static uint64_t GetKey(int32_t aX, int32_t aY);
+    static bool Sees(const Observer& acObserver, int32_t aX, int32_t aY);
+    int32_t ToCell(float aPosition) const;
+
+    Cell& GetCell(int32_t aX, int32_t aY);
+    const Cell* FindCell(int32_t aX, int32_t aY) const;
+
+    void AddToCell(EntityId aEntity, int32_t aX, int32_t aY);
+    void RemoveFromCell(EntityId aEntity, int32_t aX, int32_t aY);
+    void Watch(ObserverId aObserver, int32_t aX, int32_t aY);
+    void Unwatch(ObserverId aObserver, int32_t aX, int32_t aY);
+
+    template<class T>
+    static void Erase(std::vector<T, StlAllocator<T>>& aVector, T aValue);
+
+    float m_inverseCellSize;
+    CellMap m_cells;
+    std::vector<Entity, StlAllocator<Entity>> m_entities;
+    std::vector<Observer, StlAllocator<Observer>> m_observers;
+    std::vector<EntityId, StlAllocator<EntityId>> m_freeEntities;
+    std::vector<ObserverId, StlAllocator<ObserverId>> m_freeObservers;
+    std::vector<Event, StlAllocator<Event>> m_events;
+};
+
+template<class T>
+void InterestGrid::ForEachObserver(EntityId aEntity, T&& aFunc) const
+{
+    if (aEntity >= m_entities.size() || !m_entities[aEntity].Active)
+        return;
+
+    const Entity& cEntity = m_entities[aEntity];
+    if (const Cell* pCell = FindCell(cEntity.X, cEntity.Y))
+    {
+        for (ObserverId observer : pCell->Observers)
+            aFunc(observer, m_observers[observer].Remote);
+    }
+}
+
+template<class T>
+void InterestGrid::ForEachRelevant(ObserverId aObserver, T&& aFunc) const
+{
+    if (aObserver >= m_observers.size() || !m_observers[aObserver].Active)
+        return;
+
+    const Observer& cObserver = m_observers[aObserver];
+    for (int32_t y = cObserver.Y - cObserver.Radius; y <= cObserver.Y + cObserver.Radius; ++y)
+    {
+        for (int32_t x = cObserver.X - cObserver.Radius; x <= cObserver.X + cObserver.Radius; ++x)
+        {
+            if (const Cell* pCell = FindCell(x, y))
+            {
+                for (EntityId entity : pCell->Entities)
+                    aFunc(entity);
+            }
+        }
+    }
+}
+
+template<class T>
+void InterestGrid::Erase(std::vector<T, StlAllocator<T>>& aVector, T aValue)
+{
+    // Order doesn't matter, the last one takes its place
+    for (auto& value : aVector)
+    {
+        if (value == aValue)
+        {
+            value = aVector.back();
+            aVector.pop_back();
+            return;
+        }
+    }
+}
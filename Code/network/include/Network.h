@@ -9,7 +9,9 @@
 #include <unistd.h> 
 #include <sys/types.h> 
 #include <sys/socket.h> 
+#include <sys/uio.h>
 #include <sys/select.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 #include <arpa/inet.h>
 #include <netdb.h>
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Endpoint.h"
+#include "Connection.h"
+#include "BufferView.h"
+
+// A complete message as delivered in batches, the data is shared with the receiver and stays valid as long as the view
+struct ReceivedMessage
+{
+    Endpoint Remote;
+    Connection::Id ConnectionId;
+    uint32_t Seq;
+    BufferView Data;
+};
@@ -7,10 +7,19 @@ class Selector
 public:
     
     Selector(Socket& aSocket);
+    // Both sockets are watched at once, for a thread that serves several of them
+    Selector(Socket& aFirst, Socket& aSecond);
 
     bool IsReady() const;
+    // Blocks until one of the sockets can be read or the timeout expired
+    bool Wait(uint64_t aTimeoutMilliseconds) const;
+    // Same with a finer timeout, for waits that end on a deadline
+    bool WaitMicroseconds(uint64_t aTimeoutMicroseconds) const;
 
 private:
 
-    Socket_t m_sock;
-};
\ No newline at end of file
+    static constexpr size_t MaxSockets = 2;
+
+    Socket_t m_socks[MaxSockets];
+    size_t m_count;
+};
@@ -2,24 +2,67 @@
 
 #include "Socket.h"
 #include "ConnectionManager.h"
+#include "FrameArena.h"
+#include "VirtualArena.h"
+#include "SpscRing.h"
+#include "ReceivedMessage.h"
+#include "AdmissionControl.h"
+#include "TickScheduler.h"
+
+#include <atomic>
+#include <thread>
 
 class Server : public AllocatorCompatible
              , public Connection::ICommunication
 {
 public:
 
-    Server();
+    enum Mode
+    {
+        // Everything happens in Update, on the caller's thread
+        kInline,
+        // An I/O thread receives, decrypts, reassembles and sends, Update only delivers what it received
+        kThreaded
+    };
+
+    static constexpr size_t DefaultMaxConnections = 64;
+    static constexpr size_t DefaultMemoryLimit = 64 << 20;
+
+    // Connection storage is allocated up front for aMaxConnections, new connections are refused past that
+    Server(size_t aMaxConnections = DefaultMaxConnections, size_t aMemoryLimit = DefaultMemoryLimit, MemoryBudget* apParentBudget = nullptr);
     ~Server();
 
-    bool Start(uint16_t aPort) noexcept;
+    bool Start(uint16_t aPort, Mode aMode = kInline) noexcept;
+    // In threaded mode this returns the number of events delivered, the I/O thread keeps its own time
     uint32_t Update(uint64_t aElapsedMilliSeconds) noexcept;
+    // Sleeps until the scheduler's next tick, then calls Update and aOnTick(aElapsedMilliseconds) for each tick due, returns how many ran
+    // In inline mode packets arriving before the deadline are processed right away, batched messages wait for the next Update
+    // Without batched delivery OnMessageReceived and OnClientConnected are called from Run between ticks
+    template<class T>
+    uint32_t Run(TickScheduler& aScheduler, T&& aOnTick) noexcept;
     uint16_t GetPort() const noexcept;
 
+    // Messages are collected during Update instead of going through OnMessageReceived one at a time
+    void SetBatchedDelivery(bool aBatched) noexcept;
+    // Messages received by the last Update, in arrival order, they can be reordered in place
+    ReceivedMessage* GetReceivedMessages() noexcept;
+    size_t GetReceivedMessageCount() const noexcept;
+
+    // In threaded mode these are queued for the I/O thread, they fail when its queue is full
     void Disconnect(const Endpoint& acRemoteEndpoint) noexcept;
-    bool Send(const Endpoint& acRemoteEndpoint, Buffer aBuffer) noexcept override;
+    bool Send(const Endpoint& acRemoteEndpoint, const BufferView& acBuffer) noexcept override;
+    bool Send(const Endpoint& acRemoteEndpoint, const BufferChain& acChain) noexcept override;
     bool SendPayload(const Endpoint& acRemoteEndpoint, uint8_t *apData, size_t aLength) noexcept;
+    // The payload is shared, not copied, it can be sent to any number of clients
+    bool SendPayload(const Endpoint& acRemoteEndpoint, const BufferView& acPayload) noexcept;
+
+    Allocator* GetFrameAllocator() noexcept override;
+    MemoryBudget* GetMemoryBudget() noexcept override;
+    // Limits how fast new connections are accepted, configure it before Start in threaded mode
+    AdmissionControl& GetAdmissionControl() noexcept;
 
 protected:
+    // Not called with batched delivery, batched users still override it so a missing override can't drop messages silently
     virtual bool OnMessageReceived(const Endpoint& acRemoteEndpoint, const Message& acMessage) noexcept = 0;
     virtual bool OnClientConnected(const Endpoint& acRemoteEndpoint) noexcept = 0;
     virtual bool OnClientDisconnected(const Endpoint& acRemoteEndpoint) noexcept = 0;
@@ -27,8 +70,94 @@ protected:
 
 private:
 
+    // The packet arena is sized from the connection limit, a tick's traffic grows with the number of clients
+    static constexpr size_t PacketMemoryPerConnection = 64 * Socket::MaxPacketSize;
+    static constexpr size_t MaxPacketMemoryReserve = 256 << 20;
+    static constexpr size_t FrameChunkSize = 1 << 20;
+    static constexpr size_t QueueCapacity = 4096;
+    // Longest time a queued send waits for the I/O thread when no packet wakes it up
+    static constexpr uint64_t IOWaitMilliseconds = 1;
+
+    // From the I/O thread to Update
+    struct Event
+    {
+        enum
+        {
+            kConnected,
+            kDisconnected,
+            kMessage
+        };
+
+        uint32_t Type;
+        Endpoint Remote;
+        Connection::Id ConnectionId;
+        uint32_t Seq;
+        BufferView Data;
+    };
+
+    // From the game thread to the I/O thread
+    struct Command
+    {
+        enum
+        {
+            kSend,
+            kDisconnect
+        };
+
+        uint32_t Type;
+        Endpoint Remote;
+        BufferView Payload;
+    };
+
+    bool Transmit(const Endpoint& acRemoteEndpoint, const BufferView& acPayload) noexcept;
+    void Close(const Endpoint& acRemoteEndpoint) noexcept;
+
+    // Call the handlers or queue the event for Update depending on the mode
+    bool NotifyMessage(const Connection& acConnection, const Message& acMessage) noexcept;
+    bool NotifyConnected(const Endpoint& acRemoteEndpoint) noexcept;
+    bool NotifyDisconnected(const Endpoint& acRemoteEndpoint) noexcept;
+    bool PushEvent(Event aEvent) noexcept;
+    uint32_t DeliverEvents() noexcept;
+
+    void RunIO() noexcept;
+    void WaitForTick(const TickScheduler& acScheduler) noexcept;
+    // The batch is only cleared once it was handed out, packets processed between ticks add to it
+    void BeginBatch() noexcept;
+
+    bool ProcessPacket(Connection& aConnection, Socket::Packet& aPacket) noexcept;
+    bool ProcessRebind(Connection& aConnection, Socket::Packet& aPacket, Connection::HeaderType aHeaderType) noexcept;
+    bool Dispatch(Connection& aConnection, Socket::Packet& aPacket) noexcept;
     uint32_t Work() noexcept;
+    uint32_t Work(Socket& aListener) noexcept;
 
+    // Declared first, connections release their memory into it when they are destroyed
+    MemoryBudget m_memoryBudget;
     Socket m_v4Listener, m_v6Listener;
     ConnectionManager m_connectionManager;
-};
\ No newline at end of file
+    AdmissionControl m_admissionControl;
+    VirtualArena m_packetMemory;
+    FrameArena m_frameArena;
+
+    // Only created in threaded mode
+    SpscRing<Event>* m_pEvents;
+    SpscRing<Command>* m_pCommands;
+    std::atomic<bool> m_running;
+    std::thread m_ioThread;
+    bool m_threaded;
+
+    std::vector<ReceivedMessage, StlAllocator<ReceivedMessage>> m_receivedMessages;
+    bool m_batched;
+    bool m_batchDelivered;
+};
+
+template<class T>
+uint32_t Server::Run(TickScheduler& aScheduler, T&& aOnTick) noexcept
+{
+    WaitForTick(aScheduler);
+
+    return aScheduler.RunDue(TickScheduler::Now(), [this, &aOnTick](uint64_t aElapsedMilliseconds)
+    {
+        Update(aElapsedMilliseconds);
+        aOnTick(aElapsedMilliseconds);
+    });
+}
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "Network.h"
 #include "Outcome.h"
 #include "Buffer.h"
+#include "BufferView.h"
+#include "BufferChain.h"
 #include "Endpoint.h"
 
 class Socket
@@ -15,13 +17,15 @@ public:
     {
         kInvalidSocket,
         kDiscardError,
-        kCallFailure
+        kCallFailure,
+        // No buffer for the datagram, it is left in the socket
+        kOutOfMemory
     };
 
     struct Packet
     {
         Endpoint Remote;
-        Buffer Payload;
+        BufferView Payload;
     };
 
     Socket(Endpoint::Type aEndpointType = Endpoint::kIPv6, bool aBlocking = true);
@@ -29,6 +33,8 @@ public:
 
     Outcome<Packet, Error> Receive();
     bool Send(const Packet& aBuffer);
+    // Gathers the segments in a single datagram, the kernel reads them in place
+    bool Send(const Endpoint& acRemote, const BufferChain& acChain);
     bool Bind(uint16_t aPort = 0);
 
     uint16_t GetPort() const;
@@ -38,6 +44,9 @@ protected:
     bool Bindv6(uint16_t aPort);
     bool Bindv4(uint16_t aPort);
 
+    // Returns the size of the address, 0 if the endpoint doesn't match the socket type
+    int ToAddress(const Endpoint& acRemote, sockaddr_storage& aAddress) const;
+
 private:
 
     friend class Selector;
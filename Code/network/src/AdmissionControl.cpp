@@ -0,0 +1,121 @@
+#include "AdmissionControl.h"
+
+#include "osrng.h"
+
+#include <algorithm>
+#include <limits>
+
+AdmissionControl::AdmissionControl() noexcept
+    : m_buckets(RowCount * ColumnCount, Bucket{ DefaultSourceBurst * TokenScale, 0 }, StlAllocator<Bucket>(GetAllocator()))
+    , m_global{ DefaultGlobalBurst * TokenScale, 0 }
+    , m_now(0)
+    , m_sourceRate(DefaultSourceRate)
+    , m_sourceBurst(DefaultSourceBurst)
+    , m_globalRate(DefaultGlobalRate)
+    , m_globalBurst(DefaultGlobalBurst)
+    , m_admittedCount(0)
+    , m_deniedCount(0)
+{
+    // Secret seeds, sources can't be picked to collide with someone else's buckets
+    CryptoPP::AutoSeededRandomPool rng;
+    for (auto& seed : m_seeds)
+        seed = (uint64_t(rng.GenerateWord32()) << 32) | rng.GenerateWord32() | 1;
+}
+
+void AdmissionControl::SetSourceRate(uint32_t aRate, uint32_t aBurst) noexcept
+{
+    m_sourceRate = aRate;
+    m_sourceBurst = aBurst;
+
+    for (auto& bucket : m_buckets)
+        bucket.Tokens = std::min(bucket.Tokens, GetCapacity(aBurst));
+}
+
+void AdmissionControl::SetGlobalRate(uint32_t aRate, uint32_t aBurst) noexcept
+{
+    m_globalRate = aRate;
+    m_globalBurst = aBurst;
+    m_global.Tokens = std::min(m_global.Tokens, GetCapacity(aBurst));
+}
+
+bool AdmissionControl::Admit(const Endpoint& acSource) noexcept
+{
+    const uint64_t cKey = GetSourceKey(acSource);
+
+    Bucket* pBuckets[RowCount];
+    bool admitted = true;
+
+    for (size_t row = 0; row < RowCount; ++row)
+    {
+        const size_t cColumn = size_t(hash_mix(cKey, m_seeds[row])) & (ColumnCount - 1);
+        Bucket& bucket = m_buckets[row * ColumnCount + cColumn];
+
+        Refill(bucket, m_sourceRate, m_sourceBurst);
+        admitted = admitted && bucket.Tokens >= TokenScale;
+
+        pBuckets[row] = &bucket;
+    }
+
+    if (admitted)
+    {
+        Refill(m_global, m_globalRate, m_globalBurst);
+        admitted = m_global.Tokens >= TokenScale;
+    }
+
+    if (!admitted)
+    {
+        ++m_deniedCount;
+        return false;
+    }
+
+    for (Bucket* pBucket : pBuckets)
+        pBucket->Tokens -= TokenScale;
+
+    m_global.Tokens -= TokenScale;
+    ++m_admittedCount;
+
+    return true;
+}
+
+void AdmissionControl::Advance(uint64_t aElapsedMilliseconds) noexcept
+{
+    m_now += aElapsedMilliseconds;
+}
+
+size_t AdmissionControl::GetAdmittedCount() const noexcept
+{
+    return m_admittedCount;
+}
+
+size_t AdmissionControl::GetDeniedCount() const noexcept
+{
+    return m_deniedCount;
+}
+
+uint64_t AdmissionControl::GetSourceKey(const Endpoint& acSource) noexcept
+{
+    // Ports are ignored, a host can pick any of them, and an IPv6 host usually owns a whole /64
+    if (acSource.IsIPv4())
+    {
+        const uint8_t* pAddress = acSource.GetIPv4();
+        return (uint64_t(pAddress[0]) << 24) | (uint64_t(pAddress[1]) << 16) | (uint64_t(pAddress[2]) << 8) | pAddress[3];
+    }
+
+    const uint16_t* pAddress = acSource.GetIPv6();
+    return ((uint64_t(pAddress[0]) << 48) | (uint64_t(pAddress[1]) << 32) | (uint64_t(pAddress[2]) << 16) | pAddress[3]) ^ (uint64_t(1) << 63);
+}
+
+uint32_t AdmissionControl::GetCapacity(uint32_t aBurst) noexcept
+{
+    return uint32_t(std::min<uint64_t>(uint64_t(aBurst) * TokenScale, std::numeric_limits<uint32_t>::max()));
+}
+
+void AdmissionControl::Refill(Bucket& aBucket, uint32_t aRate, uint32_t aBurst) const noexcept
+{
+    // Buckets are only refilled when a source hashes to them, the clock is kept in 32 bits and only differences are used
+    const uint32_t cNow = uint32_t(m_now);
+    const uint64_t cElapsed = uint32_t(cNow - aBucket.LastRefill);
+
+    aBucket.Tokens = uint32_t(std::min<uint64_t>(aBucket.Tokens + cElapsed * aRate, GetCapacity(aBurst)));
+    aBucket.LastRefill = cNow;
+}
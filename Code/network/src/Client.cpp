@@ -1,77 +1,187 @@
 #include "Client.h"
+#include "Selector.h"
 
 Client::Client(const Endpoint& acRemoteEndpoint)
     : m_connection(*this, acRemoteEndpoint)
     , m_socket(acRemoteEndpoint.GetType(), false)
+    , m_receivedMessages(StlAllocator<ReceivedMessage>(GetAllocator()))
+    , m_batched(false)
+    , m_batchDelivered(false)
 {
     m_socket.Bind();
 }
 
 void Client::Disconnect() noexcept
 {
-    if (!m_connection.GetState() == Connection::kNone)
+    if (m_connection.GetState() != Connection::kNone)
     {
         m_connection.Disconnect();
     }
 }
 
-bool Client::Send(const Endpoint& acRemoteEndpoint, Buffer aBuffer) noexcept
+bool Client::Send(const Endpoint& acRemoteEndpoint, const BufferView& acBuffer) noexcept
 {
-    Socket::Packet packet{ acRemoteEndpoint, std::move(aBuffer) };
+    Socket::Packet packet{ acRemoteEndpoint, acBuffer };
     return m_socket.Send(packet);
 }
 
+bool Client::Send(const Endpoint& acRemoteEndpoint, const BufferChain& acChain) noexcept
+{
+    return m_socket.Send(acRemoteEndpoint, acChain);
+}
+
 bool Client::SendPayload(uint8_t *apData, size_t aLength) noexcept
+{
+    ScopedAllocator _(&m_frameArena);
+
+    return SendPayload(BufferView(apData, aLength));
+}
+
+bool Client::SendPayload(const BufferView& acPayload) noexcept
 {
     if (!m_connection.IsConnected())
     {
         return false;
     }
 
-    // FIXME memory is allocated (and freed) for every packet sent
-    Buffer buffer(Socket::MaxPacketSize);
+    ScopedAllocator _(&m_frameArena);
+
     uint32_t seq = m_connection.GetNextMessageSeq();
-    Message message(seq, apData, aLength);
-    Buffer::Writer writer(&buffer);
+    Message message(seq, acPayload);
     size_t bytesWritten = 0;
 
-    while (bytesWritten < aLength)
+    while (bytesWritten < acPayload.GetSize())
     {
-        writer.Reset();
-        m_connection.WriteHeader(writer, Connection::Header::kPayload);
-        bytesWritten += message.Write(writer, bytesWritten);
-        Send(m_connection.GetRemoteEndpoint(), buffer);
+        // Headers are written in a small block in front of the payload, which is sent from where it is
+        Buffer header(Buffer::InlineCapacity);
+        BufferChain chain;
+        size_t headerSize = 0;
+        size_t fragmentSize = 0;
+        {
+            Buffer::Writer writer(&header);
+            m_connection.WriteHeader(writer, Connection::Header::kPayload);
+
+            const size_t cAvailableBytes = Socket::MaxPacketSize - (writer.GetBitPosition() + 7) / 8;
+            fragmentSize = message.Write(writer, chain, cAvailableBytes, bytesWritten);
+            headerSize = (writer.GetBitPosition() + 7) / 8;
+        }
+
+        if (fragmentSize == 0)
+            return false;
+
+        chain.Prepend(BufferView(std::move(header)).Slice(0, headerSize));
+        Send(m_connection.GetRemoteEndpoint(), chain);
+
+        bytesWritten += fragmentSize;
     }
 
     return true;
 }
 
-uint32_t Client::Update(uint64_t aElapsedMilliSeconds) noexcept
+Allocator* Client::GetFrameAllocator() noexcept
 {
-    uint32_t processedPackets = 0;
-    Outcome<Socket::Packet, Socket::Error> result = m_socket.Receive();
+    return &m_frameArena;
+}
 
-    while (!result.HasError())
-    {
-        // Route packet to a connection
-        if (ProcessPacket(result.GetResult()))
-            ++processedPackets;
+void Client::SetBatchedDelivery(bool aBatched) noexcept
+{
+    m_batched = aBatched;
+}
 
-        result = m_socket.Receive();
-    }
+ReceivedMessage* Client::GetReceivedMessages() noexcept
+{
+    return m_receivedMessages.data();
+}
+
+size_t Client::GetReceivedMessageCount() const noexcept
+{
+    return m_receivedMessages.size();
+}
+
+uint32_t Client::Update(uint64_t aElapsedMilliSeconds) noexcept
+{
+    // Whatever is in the batch when this returns is handed out
+    BeginBatch();
+    m_batchDelivered = true;
+
+    uint32_t processedPackets = Work();
 
     if (m_connection.Update(aElapsedMilliSeconds) == Connection::kNone)
     {
         OnDisconnected(m_connection.GetRemoteEndpoint());
     }
 
+    m_frameArena.Reset();
+
     // TODO error handling
     return processedPackets;
 }
 
+void Client::WaitForTick(const TickScheduler& acScheduler) noexcept
+{
+    Selector selector(m_socket);
+
+    while (const uint64_t cRemaining = acScheduler.GetTimeUntilNextTick(TickScheduler::Now()))
+    {
+        // Rounded up, waking a little late is better than spinning until the deadline
+        if (selector.WaitMicroseconds((cRemaining + 999) / 1000))
+        {
+            BeginBatch();
+            Work();
+        }
+    }
+}
+
+void Client::BeginBatch() noexcept
+{
+    if (!m_batchDelivered)
+        return;
+
+    // Capacity is kept, a batch only allocates when it is the largest so far
+    m_receivedMessages.clear();
+    m_batchDelivered = false;
+}
+
+uint32_t Client::Work() noexcept
+{
+    uint32_t processedPackets = 0;
+
+    while (true)
+    {
+        // Packets are only needed while they are processed, give the memory back right after
+        auto marker = m_frameArena.GetMarker();
+        bool received = false;
+
+        // The packet must be gone before rewinding, its storage lives in the arena
+        {
+            Outcome<Socket::Packet, Socket::Error> result;
+            {
+                ScopedAllocator _(&m_frameArena);
+                result = m_socket.Receive();
+            }
+
+            if (!result.HasError())
+            {
+                received = true;
+
+                // Route packet to a connection
+                if (ProcessPacket(result.GetResult()))
+                    ++processedPackets;
+            }
+        }
+
+        m_frameArena.RewindTo(marker);
+
+        if (!received)
+            break;
+    }
+
+    return processedPackets;
+}
+
 bool Client::ProcessPacket(Socket::Packet& aPacket) noexcept
 {
-    Buffer::Reader reader(&aPacket.Payload);
+    Buffer::Reader reader = aPacket.Payload.GetReader();
 
     switch (m_connection.GetState())
     {
@@ -106,7 +216,12 @@ bool Client::ProcessPacket(Socket::Packet& aPacket) noexcept
                 const Message &message = messageOutcome.GetResult();
 
                 if (message.IsComplete())
-                    OnMessageReceived(aPacket.Remote, message);
+                {
+                    if (m_batched)
+                        m_receivedMessages.push_back(ReceivedMessage{ aPacket.Remote, m_connection.GetId(), message.GetSeq(), message.GetView() });
+                    else
+                        OnMessageReceived(aPacket.Remote, message);
+                }
 
                 messageOutcome = m_connection.ReadMessage(reader);
             }
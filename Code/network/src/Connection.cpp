@@ -1,14 +1,14 @@
 #include "Connection.h"
-#include "StackAllocator.h"
+#include "Serialization.h"
 
 #include "osrng.h"
 
 struct NullCommunicationInterface : public Connection::ICommunication
 {
-    bool Send(const Endpoint& acRemote, Buffer aBuffer) override
+    bool Send(const Endpoint& acRemote, const BufferView& acBuffer) override
     {
         (void)acRemote;
-        (void)aBuffer;
+        (void)acBuffer;
 
         return false;
     }
@@ -18,15 +18,36 @@ static NullCommunicationInterface s_dummyInterface;
 
 static const char* s_headerSignature = "MG";
 
+using HeaderSchema = Serialization::Schema<
+    Serialization::Field<&Connection::Header::Signature, Serialization::Bytes<2>>,
+    Serialization::Field<&Connection::Header::Version, Serialization::Bits<6>>,
+    Serialization::Field<&Connection::Header::Type, Serialization::Bits<3>>,
+    Serialization::Field<&Connection::Header::Length, Serialization::Bits<11>>>;
+
+// Headers are packed in a single word, keep it that way
+static_assert(HeaderSchema::BitCount == 36);
+
+using ConnectionIdSchema = Serialization::Schema<
+    Serialization::Field<&Connection::Header::ConnectionId, Serialization::Bits<32>>>;
+
+bool Connection::Header::HasId(HeaderType aType)
+{
+    return aType == kPayload || aType == kRebind;
+}
+
 Connection::Connection(ICommunication& aCommunicationInterface, const Endpoint& acRemoteEndpoint, bool aIsServer)
-    : MessageReceiver()
-    , m_communication{ aCommunicationInterface }
+    : MessageReceiver(MaxReassemblyMemory, aCommunicationInterface.GetMemoryBudget())
     , m_state{kNegociating}
+    , m_isServer{aIsServer}
+    , m_messageSeq{ 0 }
     , m_timeSinceLastEvent{0}
+    , m_timeSinceLastSend{KeepAliveInterval}
     , m_remoteEndpoint{acRemoteEndpoint}
-    , m_isServer{aIsServer}
+    , m_id{cInvalidId}
+    , m_communication{ aCommunicationInterface }
     , m_remoteCode{ 0 }
-    , m_messageSeq{ 0 }
+    , m_rebindCode{ 0 }
+    , m_timeSinceRebindRequest{ NegotiationResendInterval }
 {
     CryptoPP::AutoSeededRandomPool rng;
     m_challengeCode = rng.GenerateWord32();
@@ -34,15 +55,21 @@ Connection::Connection(ICommunication& aCommunicationInterface, const Endpoint&
 }
 
 Connection::Connection(Connection&& aRhs) noexcept
-    : MessageReceiver()
-    , m_communication{aRhs.m_communication}
+    : MessageReceiver(MaxReassemblyMemory, aRhs.m_communication.GetMemoryBudget())
     , m_state{std::move(aRhs.m_state)}
+    , m_isServer{aRhs.m_isServer}
+    , m_messageSeq{ 0 }
     , m_timeSinceLastEvent{std::move(aRhs.m_timeSinceLastEvent)}
+    , m_timeSinceLastSend{aRhs.m_timeSinceLastSend}
     , m_remoteEndpoint{std::move(aRhs.m_remoteEndpoint)}
-    , m_isServer{aRhs.m_isServer}
+    , m_id{aRhs.m_id}
+    , m_communication{aRhs.m_communication}
+    , m_filter{std::move(aRhs.m_filter)}
     , m_challengeCode{aRhs.m_challengeCode}
     , m_remoteCode{aRhs.m_remoteCode}
-    , m_messageSeq{ 0 }
+    , m_rebindCode{aRhs.m_rebindCode}
+    , m_rebindEndpoint{aRhs.m_rebindEndpoint}
+    , m_timeSinceRebindRequest{aRhs.m_timeSinceRebindRequest}
 {
     aRhs.m_communication = s_dummyInterface;
     aRhs.m_state = kNone;
@@ -60,10 +87,16 @@ Connection& Connection::operator=(Connection&& aRhs) noexcept
     m_communication = aRhs.m_communication;
     m_state = aRhs.m_state;
     m_timeSinceLastEvent = aRhs.m_timeSinceLastEvent;
+    m_timeSinceLastSend = aRhs.m_timeSinceLastSend;
     m_remoteEndpoint = std::move(aRhs.m_remoteEndpoint);
+    m_id = aRhs.m_id;
+    m_filter = std::move(aRhs.m_filter);
     m_isServer = aRhs.m_isServer;
     m_challengeCode = aRhs.m_challengeCode;
     m_remoteCode = aRhs.m_remoteCode;
+    m_rebindCode = aRhs.m_rebindCode;
+    m_rebindEndpoint = aRhs.m_rebindEndpoint;
+    m_timeSinceRebindRequest = aRhs.m_timeSinceRebindRequest;
 
     aRhs.m_communication = s_dummyInterface;
     aRhs.m_state = kNone;
@@ -102,6 +135,11 @@ Outcome<Connection::HeaderType, Connection::HeaderErrors> Connection::ProcessPac
         break;
     case Header::kPayload:
         m_timeSinceLastEvent = 0;
+        break;
+    case Header::kRebind:
+        if (IsConnected())
+            return ProcessRebind(aReader);
+
         break;
     default:
         return kBadPacketType;
@@ -149,7 +187,7 @@ Outcome<Connection::HeaderType, Connection::HeaderErrors> Connection::ProcessNeg
             return kBadChallenge;
         }
     }
-    else if (ReadChallenge(aReader, m_remoteCode))
+    else if (ReadChallenge(aReader, m_remoteCode) && aReader.ReadBytes((uint8_t *)&m_id, sizeof(m_id)))
     {
         // We (client) assume to be connected and send back the challenge code
         m_state = kConnected;
@@ -172,8 +210,9 @@ Outcome<Connection::HeaderType, Connection::HeaderErrors> Connection::ProcessCon
 
         if (confirmationCode == (m_challengeCode ^ m_remoteCode))
         {
-            // We got a correct challenge code back
+            // We got a correct challenge code back, the client won't negotiate again
             m_state = kConnected;
+            m_filter.EndHandshake();
             return Header::kConnection;
         }
     }
@@ -183,6 +222,32 @@ Outcome<Connection::HeaderType, Connection::HeaderErrors> Connection::ProcessCon
     return kBadChallenge;
 }
 
+Outcome<Connection::HeaderType, Connection::HeaderErrors> Connection::ProcessRebind(Buffer::Reader& aReader)
+{
+    uint32_t code = 0;
+
+    if (!ReadChallenge(aReader, code))
+        return kBadChallenge;
+
+    if (!m_isServer)
+    {
+        // Answer from wherever our packets come from now, only we can decrypt the challenge
+        m_filter.PreReceive((uint8_t *)&code, sizeof(code), RebindChallengeSequence);
+        SendRebind(m_remoteEndpoint, code ^ m_challengeCode, RebindResponseSequence);
+
+        return Header::kRebind;
+    }
+
+    m_filter.PreReceive((uint8_t *)&code, sizeof(code), RebindResponseSequence);
+
+    // Anyone can send a wrong answer, the connection is left as it is
+    if (!m_rebindEndpoint.IsValid() || code != (m_rebindCode ^ m_remoteCode))
+        return kBadChallenge;
+
+    m_timeSinceLastEvent = 0;
+    return Header::kRebind;
+}
+
 bool Connection::IsNegotiating() const
 {
     return m_state == kNegociating;
@@ -203,12 +268,59 @@ const Endpoint& Connection::GetRemoteEndpoint() const
     return m_remoteEndpoint;
 }
 
+void Connection::SetRemoteEndpoint(const Endpoint& acRemoteEndpoint)
+{
+    m_remoteEndpoint = acRemoteEndpoint;
+    m_rebindEndpoint = Endpoint();
+    m_rebindCode = 0;
+}
+
+Connection::Id Connection::GetId() const
+{
+    return m_id;
+}
+
+void Connection::SetId(Id aId)
+{
+    m_id = aId;
+}
+
+bool Connection::RequestRebind(const Endpoint& acEndpoint)
+{
+    // Anyone can send a packet with our id from any address, the challenges must not be a way to flood a third party
+    if (!CanRequestRebind())
+        return false;
+
+    // The challenge stays the same while the address does, any answer to it is accepted
+    if (acEndpoint != m_rebindEndpoint)
+    {
+        CryptoPP::AutoSeededRandomPool rng;
+        m_rebindCode = rng.GenerateWord32();
+        m_rebindEndpoint = acEndpoint;
+    }
+
+    SendRebind(acEndpoint, m_rebindCode, RebindChallengeSequence);
+    m_timeSinceRebindRequest = 0;
+
+    return true;
+}
+
+bool Connection::CanRequestRebind() const
+{
+    return m_timeSinceRebindRequest >= NegotiationResendInterval;
+}
+
+const Endpoint& Connection::GetRebindEndpoint() const
+{
+    return m_rebindEndpoint;
+}
+
 Connection::State Connection::Update(uint64_t aElapsedMilliseconds)
 {
-    m_timeSinceLastEvent += aElapsedMilliseconds;
+    AddElapsedTime(aElapsedMilliseconds);
 
     // Connection is considered timed out if no data is received in 15s (TODO: make this configurable)
-    if (m_timeSinceLastEvent > 15 * 1000)
+    if (m_timeSinceLastEvent > Timeout)
     {
         m_state = kNone;
         return m_state;
@@ -219,9 +331,12 @@ Connection::State Connection::Update(uint64_t aElapsedMilliseconds)
     case Connection::kNone:
         break;
     case Connection::kNegociating:
-        SendNegotiation();
+        if (m_timeSinceLastSend >= NegotiationResendInterval)
+            SendNegotiation();
         break;
     case Connection::kConnected:
+        if (m_timeSinceLastSend >= KeepAliveInterval)
+            SendKeepAlive();
         break;
     default:
         break;
@@ -230,6 +345,27 @@ Connection::State Connection::Update(uint64_t aElapsedMilliseconds)
     return m_state;
 }
 
+void Connection::AddElapsedTime(uint64_t aElapsedMilliseconds)
+{
+    m_timeSinceLastEvent += aElapsedMilliseconds;
+    m_timeSinceLastSend += aElapsedMilliseconds;
+    m_timeSinceRebindRequest += aElapsedMilliseconds;
+}
+
+uint64_t Connection::GetTimeUntilNextEvent() const
+{
+    if (m_state == kNone)
+        return 0;
+
+    // The timeout triggers once strictly past the limit
+    const uint64_t cTimeout = Timeout + 1 - std::min(m_timeSinceLastEvent, Timeout + 1);
+
+    const uint64_t cInterval = m_state == kNegociating ? NegotiationResendInterval : KeepAliveInterval;
+    const uint64_t cSend = cInterval - std::min(m_timeSinceLastSend, cInterval);
+
+    return std::min(cTimeout, cSend);
+}
+
 void Connection::WriteHeader(Buffer::Writer& aWriter, Connection::HeaderType aHeaderType)
 {
     Header header;
@@ -238,19 +374,23 @@ void Connection::WriteHeader(Buffer::Writer& aWriter, Connection::HeaderType aHe
     header.Version = 1;
     header.Type = aHeaderType;
     header.Length = 0;
+    header.ConnectionId = m_id;
 
-    aWriter.WriteBytes((const uint8_t*)header.Signature, 2);
-    aWriter.WriteBits(header.Version, 6);
-    aWriter.WriteBits(header.Type, 3);
-    aWriter.WriteBits(header.Length, 11);
+    HeaderSchema::Write(aWriter, header);
+
+    if (Header::HasId(aHeaderType))
+        ConnectionIdSchema::Write(aWriter, header);
+
+    // Every packet goes through here, any of them counts as a keepalive
+    m_timeSinceLastSend = 0;
 }
 
 void Connection::Disconnect()
 {
-    StackAllocator<256> allocator;
-    auto* pBuffer = allocator.New<Buffer>(16);
+    ScopedAllocator _(m_communication.GetFrameAllocator());
+    Buffer buffer(16);
 
-    Buffer::Writer writer(pBuffer);
+    Buffer::Writer writer(&buffer);
     WriteHeader(writer, Header::kDisconnect);
 
     // we don't take remote code into account here as the negotiation may now have been successful yet
@@ -258,22 +398,23 @@ void Connection::Disconnect()
     m_filter.PostSend((uint8_t *)&codeToSend, sizeof(codeToSend), UINT32_MAX);
     WriteChallenge(writer, codeToSend);
 
+    const BufferView packet(std::move(buffer));
+
     for (uint8_t i = 0; i < 10; i++)
     {
         // send a bunch of them so they have more chances of reaching the remote
-        m_communication.Send(m_remoteEndpoint, *pBuffer);
+        m_communication.Send(m_remoteEndpoint, packet);
     }
 
     m_state = kNone;
-    allocator.Delete(pBuffer);
 }
 
 void Connection::SendNegotiation()
 {
-    StackAllocator<1 << 13> allocator;
-    auto* pBuffer = allocator.New<Buffer>(m_isServer ? MaxNegotiationSize : Socket::MaxPacketSize);
+    ScopedAllocator _(m_communication.GetFrameAllocator());
+    Buffer buffer(m_isServer ? MaxNegotiationSize : Socket::MaxPacketSize);
 
-    Buffer::Writer writer(pBuffer);
+    Buffer::Writer writer(&buffer);
     WriteHeader(writer, Header::kNegotiation);
 
     if (!m_isServer)
@@ -283,17 +424,19 @@ void Connection::SendNegotiation()
 
     WriteChallenge(writer, m_challengeCode);
 
-    m_communication.Send(m_remoteEndpoint, *pBuffer);
+    // The client learns its id along with our challenge
+    if (m_isServer)
+        writer.WriteBytes((uint8_t *)&m_id, sizeof(m_id));
 
-    allocator.Delete(pBuffer);
+    m_communication.Send(m_remoteEndpoint, BufferView(std::move(buffer)));
 }
 
 void Connection::SendConfirmation()
 {
-    StackAllocator<1 << 13> allocator;
-    auto* pBuffer = allocator.New<Buffer>(Socket::MaxPacketSize);
+    ScopedAllocator _(m_communication.GetFrameAllocator());
+    Buffer buffer(Socket::MaxPacketSize);
 
-    Buffer::Writer writer(pBuffer);
+    Buffer::Writer writer(&buffer);
     WriteHeader(writer, Header::kConnection);
     writer.Advance(ClientPadding);
 
@@ -301,35 +444,71 @@ void Connection::SendConfirmation()
     m_filter.PostSend((uint8_t *)&codeToSend, sizeof(codeToSend), 0);
     WriteChallenge(writer, codeToSend);
 
-    m_communication.Send(m_remoteEndpoint, *pBuffer);
+    m_communication.Send(m_remoteEndpoint, BufferView(std::move(buffer)));
+}
+
+void Connection::SendKeepAlive()
+{
+    ScopedAllocator _(m_communication.GetFrameAllocator());
+    Buffer buffer(Buffer::InlineCapacity);
+    size_t size = 0;
+
+    // A payload header without any message
+    {
+        Buffer::Writer writer(&buffer);
+        WriteHeader(writer, Header::kPayload);
+        size = (writer.GetBitPosition() + 7) / 8;
+    }
+
+    m_communication.Send(m_remoteEndpoint, BufferView(std::move(buffer)).Slice(0, size));
+}
+
+void Connection::SendRebind(const Endpoint& acRemote, uint32_t aCode, uint32_t aSequence)
+{
+    ScopedAllocator _(m_communication.GetFrameAllocator());
+    Buffer buffer(16);
+
+    Buffer::Writer writer(&buffer);
+    WriteHeader(writer, Header::kRebind);
 
-    allocator.Delete(pBuffer);
+    m_filter.PostSend((uint8_t *)&aCode, sizeof(aCode), aSequence);
+    WriteChallenge(writer, aCode);
+
+    m_communication.Send(acRemote, BufferView(std::move(buffer)));
 }
 
 Outcome<Connection::Header, Connection::HeaderErrors> Connection::ProcessHeader(Buffer::Reader& aReader)
 {
-    Header header;
+    auto header = ReadHeader(aReader);
 
-    aReader.ReadBytes((uint8_t*)&header.Signature, 2);
+    // Ids are checked even for packets that were found by endpoint
+    if (!header.HasError() && Header::HasId(header.GetResult().Type) && header.GetResult().ConnectionId != m_id)
+        return kUnknownChannel;
 
-    if (header.Signature[0] != 'M' || header.Signature[1] != 'G')
-        return kBadSignature;
+    return header;
+}
+
+Outcome<Connection::Header, Connection::HeaderErrors> Connection::ReadHeader(Buffer::Reader& aReader)
+{
+    Header header;
+    header.ConnectionId = cInvalidId;
 
-    aReader.ReadBits(header.Version, 6);
+    // A truncated header can't carry a valid signature
+    if (!HeaderSchema::Read(aReader, header) || header.Signature[0] != 'M' || header.Signature[1] != 'G')
+        return kBadSignature;
 
     if (header.Version != 1)
         return kBadVersion;
 
-    aReader.ReadBits(header.Type, 3);
-
     if (header.Type >= Header::kCount)
         return kBadPacketType;
 
-    aReader.ReadBits(header.Length, 11);
-
     if (header.Length > Socket::MaxPacketSize)
         return kTooLarge;
 
+    if (Header::HasId(header.Type) && !ConnectionIdSchema::Read(aReader, header))
+        return kUnknownChannel;
+
     return header;
 }
 
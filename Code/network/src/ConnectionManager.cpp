@@ -1,65 +1,242 @@
 #include "ConnectionManager.h"
 
+#include <algorithm>
 
 
-ConnectionManager::ConnectionManager(size_t aMaxConnections)
-    : m_maxConnections(aMaxConnections)
+
+static size_t GetCapacity(size_t aMaxConnections)
+{
+    return std::min(aMaxConnections, ConnectionManager::MaxConnections);
+}
+
+static size_t GetTableSize(size_t aMaxConnections)
 {
+    // At most half full, probe sequences stay short
+    size_t size = 16;
+    while (size < aMaxConnections * 2)
+        size <<= 1;
 
+    return size;
 }
 
-Connection* ConnectionManager::Find(const Endpoint& acEndpoint)
+ConnectionManager::ConnectionManager(size_t aMaxConnections)
+    : m_slots(GetTableSize(GetCapacity(aMaxConnections)), Slot{ 0, cEmptySlot }, StlAllocator<Slot>(GetAllocator()))
+    , m_freeIndices(StlAllocator<uint32_t>(GetAllocator()))
+    , m_used(GetCapacity(aMaxConnections), false, StlAllocator<bool>(GetAllocator()))
+    , m_generations(GetCapacity(aMaxConnections), 1, StlAllocator<uint16_t>(GetAllocator()))
+    , m_timerIds(GetCapacity(aMaxConnections), TimingWheel::cInvalidTimer, StlAllocator<TimingWheel::TimerId>(GetAllocator()))
+    , m_lastUpdates(GetCapacity(aMaxConnections), 0, StlAllocator<uint64_t>(GetAllocator()))
+    , m_timers(GetCapacity(aMaxConnections))
+    , m_pConnections((Connection*)GetAllocator()->Allocate(sizeof(Connection) * GetCapacity(aMaxConnections), alignof(Connection)))
+    , m_slotMask(m_slots.size() - 1)
+    , m_count(0)
+    , m_maxConnections(GetCapacity(aMaxConnections))
 {
-    auto itor = m_connections.find(acEndpoint);
-    if (itor != std::end(m_connections))
+    // Lowest indices are handed out first so live connections stay packed at the start of the slab
+    m_freeIndices.reserve(m_maxConnections);
+    for (size_t i = m_maxConnections; i > 0; --i)
+        m_freeIndices.push_back(uint32_t(i - 1));
+}
+
+ConnectionManager::~ConnectionManager()
+{
+    for (size_t i = 0; i < m_maxConnections; ++i)
     {
-        return &itor->second;
+        if (m_used[i])
+            m_pConnections[i].~Connection();
     }
 
-    return nullptr;
+    GetAllocator()->Free(m_pConnections);
+}
+
+Connection* ConnectionManager::Find(const Endpoint& acEndpoint)
+{
+    const size_t cSlot = FindSlot(acEndpoint, acEndpoint.Hash());
+    if (m_slots[cSlot].Index == cEmptySlot)
+        return nullptr;
+
+    return &m_pConnections[m_slots[cSlot].Index];
 }
 
 const Connection* ConnectionManager::Find(const Endpoint& acEndpoint) const
 {
-    auto itor = m_connections.find(acEndpoint);
-    if (itor != std::end(m_connections))
-    {
-        return &itor->second;
-    }
+    const size_t cSlot = FindSlot(acEndpoint, acEndpoint.Hash());
+    if (m_slots[cSlot].Index == cEmptySlot)
+        return nullptr;
+
+    return &m_pConnections[m_slots[cSlot].Index];
+}
+
+Connection* ConnectionManager::Get(Connection::Id aId)
+{
+    const uint32_t cIndex = aId & IdIndexMask;
+    if (cIndex >= m_maxConnections || !m_used[cIndex] || m_generations[cIndex] != (aId >> IdIndexBits))
+        return nullptr;
 
-    return nullptr;
+    return &m_pConnections[cIndex];
 }
 
 bool ConnectionManager::IsFull() const
 {
-    return m_connections.size() >= m_maxConnections;
+    return m_count >= m_maxConnections;
 }
 
-void ConnectionManager::Update(uint64_t aElapsedMilliSeconds, std::function<bool(const Endpoint&)> aDisconnectedCallback)
+size_t ConnectionManager::GetCount() const
 {
-    auto it = m_connections.begin();
+    return m_count;
+}
 
-    while (it != m_connections.end())
+void ConnectionManager::Update(uint64_t aElapsedMilliSeconds, std::function<bool(const Endpoint&)> aDisconnectedCallback)
+{
+    m_timers.Advance(aElapsedMilliSeconds, [this, &aDisconnectedCallback](uint64_t aIndex)
     {
-        Connection& connection = (*it).second;
+        OnTimer(uint32_t(aIndex), aDisconnectedCallback);
+    });
+}
 
-        if (connection.Update(aElapsedMilliSeconds) == Connection::kNone)
-        {
-            if (aDisconnectedCallback)
-            {
-                aDisconnectedCallback((*it).first);
-            }
+void ConnectionManager::Touch(Connection& aConnection)
+{
+    const uint32_t cIndex = uint32_t(&aConnection - m_pConnections);
+    const uint64_t cNow = m_timers.GetTime();
 
-            it = m_connections.erase(it);
-        }
-        else
+    aConnection.AddElapsedTime(cNow - m_lastUpdates[cIndex]);
+    m_lastUpdates[cIndex] = cNow;
+}
+
+void ConnectionManager::Wake(Connection& aConnection)
+{
+    const uint32_t cIndex = uint32_t(&aConnection - m_pConnections);
+
+    m_timers.Cancel(m_timerIds[cIndex]);
+    m_timerIds[cIndex] = m_timers.Schedule(0, cIndex);
+}
+
+void ConnectionManager::OnTimer(uint32_t aIndex, const std::function<bool(const Endpoint&)>& acDisconnectedCallback)
+{
+    Connection& connection = m_pConnections[aIndex];
+    const uint64_t cNow = m_timers.GetTime();
+
+    m_timerIds[aIndex] = TimingWheel::cInvalidTimer;
+
+    const uint64_t cElapsed = cNow - m_lastUpdates[aIndex];
+    m_lastUpdates[aIndex] = cNow;
+
+    if (connection.Update(cElapsed) == Connection::kNone)
+    {
+        if (acDisconnectedCallback)
         {
-            it++;
+            acDisconnectedCallback(connection.GetRemoteEndpoint());
         }
+
+        Remove(aIndex);
+        return;
     }
+
+    m_timerIds[aIndex] = m_timers.Schedule(connection.GetTimeUntilNextEvent(), aIndex);
 }
 
-void ConnectionManager::Add(Connection aConnection)
+bool ConnectionManager::Add(Connection aConnection)
 {
-    m_connections.emplace(aConnection.GetRemoteEndpoint(), std::move(aConnection));
-}
\ No newline at end of file
+    const uint64_t cHash = aConnection.GetRemoteEndpoint().Hash();
+    const size_t cSlot = FindSlot(aConnection.GetRemoteEndpoint(), cHash);
+
+    if (IsFull() || m_slots[cSlot].Index != cEmptySlot)
+        return false;
+
+    const uint32_t cIndex = m_freeIndices.back();
+    m_freeIndices.pop_back();
+
+    new (&m_pConnections[cIndex]) Connection(std::move(aConnection));
+    m_pConnections[cIndex].SetId((uint32_t(m_generations[cIndex]) << IdIndexBits) | cIndex);
+    m_used[cIndex] = true;
+
+    // First update on the next tick, a server connection answers the negotiation from there
+    m_lastUpdates[cIndex] = m_timers.GetTime();
+    m_timerIds[cIndex] = m_timers.Schedule(0, cIndex);
+
+    m_slots[cSlot] = Slot{ uint32_t(cHash), cIndex };
+    ++m_count;
+
+    return true;
+}
+
+bool ConnectionManager::Rebind(Connection& aConnection, const Endpoint& acEndpoint)
+{
+    const uint32_t cIndex = uint32_t(&aConnection - m_pConnections);
+    const uint64_t cHash = acEndpoint.Hash();
+
+    if (m_slots[FindSlot(acEndpoint, cHash)].Index != cEmptySlot)
+        return false;
+
+    const Endpoint& cOldEndpoint = aConnection.GetRemoteEndpoint();
+    RemoveSlot(FindSlot(cOldEndpoint, cOldEndpoint.Hash()));
+
+    aConnection.SetRemoteEndpoint(acEndpoint);
+
+    // The removal may have shifted entries, look again for where the new endpoint goes
+    m_slots[FindSlot(acEndpoint, cHash)] = Slot{ uint32_t(cHash), cIndex };
+
+    return true;
+}
+
+size_t ConnectionManager::FindSlot(const Endpoint& acEndpoint, uint64_t aHash) const
+{
+    // Returns the slot holding the endpoint, or the empty slot where it would go
+    size_t slot = size_t(aHash) & m_slotMask;
+    while (true)
+    {
+        const Slot& entry = m_slots[slot];
+        if (entry.Index == cEmptySlot)
+            return slot;
+
+        if (entry.Hash == uint32_t(aHash) && m_pConnections[entry.Index].GetRemoteEndpoint() == acEndpoint)
+            return slot;
+
+        slot = (slot + 1) & m_slotMask;
+    }
+}
+
+void ConnectionManager::Remove(uint32_t aIndex)
+{
+    const Endpoint& cEndpoint = m_pConnections[aIndex].GetRemoteEndpoint();
+    const size_t cSlot = FindSlot(cEndpoint, cEndpoint.Hash());
+
+    m_timers.Cancel(m_timerIds[aIndex]);
+    m_timerIds[aIndex] = TimingWheel::cInvalidTimer;
+
+    m_pConnections[aIndex].~Connection();
+    m_used[aIndex] = false;
+    m_freeIndices.push_back(aIndex);
+    --m_count;
+
+    // Old ids must not reach whichever connection takes the index next, generation 0 is never used so no id is 0
+    m_generations[aIndex] = uint16_t(m_generations[aIndex] % (GenerationCount - 1) + 1);
+
+    RemoveSlot(cSlot);
+}
+
+void ConnectionManager::RemoveSlot(size_t aSlot)
+{
+    size_t hole = aSlot;
+
+    // Backward shift deletion, move up every following entry that would be unreachable past the hole
+    size_t slot = hole;
+    while (true)
+    {
+        slot = (slot + 1) & m_slotMask;
+
+        const Slot& entry = m_slots[slot];
+        if (entry.Index == cEmptySlot)
+            break;
+
+        const size_t cHome = size_t(entry.Hash) & m_slotMask;
+        const bool cMovable = ((slot - cHome) & m_slotMask) >= ((slot - hole) & m_slotMask);
+        if (cMovable)
+        {
+            m_slots[hole] = entry;
+            hole = slot;
+        }
+    }
+
+    m_slots[hole] = Slot{ 0, cEmptySlot };
+}
@@ -95,6 +95,28 @@ uint16_t* Endpoint::GetIPv6() noexcept
     return m_ipv6;
 }
 
+uint64_t Endpoint::Hash() const noexcept
+{
+    // Only the bytes of the address are meaningful, the rest of the union is left as is for IPv4
+    uint64_t low = 0;
+    uint64_t high = 0;
+    if (IsIPv6())
+    {
+        std::memcpy(&low, m_ipv6, sizeof(low));
+        std::memcpy(&high, m_ipv6 + 4, sizeof(high));
+    }
+    else if (IsIPv4())
+    {
+        std::memcpy(&low, m_ipv4, sizeof(m_ipv4));
+    }
+
+    const uint64_t cTail = (uint64_t(m_port) << 8) | m_type;
+
+    // Two rounds of multiply and fold, the constants are arbitrary odd numbers with well spread bits
+    const uint64_t cMixed = hash_mix(low ^ 0xA0761D6478BD642F, high ^ 0xE7037ED1A0B428DB);
+    return hash_mix(cMixed ^ 0x8EBC6AF09C88C6E3, cTail ^ 0x589965CC75374CC3);
+}
+
 bool Endpoint::ToNetIPv4(uint32_t& aDestination) const noexcept
 {
     if (IsIPv4() == false) return false;
@@ -0,0 +1,292 @@
+#include "InterestGrid.h"
+#include "Server.h"
+
+#include <cmath>
+
+InterestGrid::Cell::Cell(Allocator* apAllocator)
+    : Entities(StlAllocator<EntityId>(apAllocator))
+    , Observers(StlAllocator<ObserverId>(apAllocator))
+{
+}
+
+InterestGrid::InterestGrid(float aCellSize)
+    : m_inverseCellSize(1.f / aCellSize)
+    , m_cells(StlAllocator<std::pair<const uint64_t, Cell>>(GetAllocator()))
+    , m_entities(StlAllocator<Entity>(GetAllocator()))
+    , m_observers(StlAllocator<Observer>(GetAllocator()))
+    , m_freeEntities(StlAllocator<EntityId>(GetAllocator()))
+    , m_freeObservers(StlAllocator<ObserverId>(GetAllocator()))
+    , m_events(StlAllocator<Event>(GetAllocator()))
+{
+}
+
+InterestGrid::EntityId InterestGrid::AddEntity(float aX, float aY)
+{
+    EntityId entity;
+    if (m_freeEntities.empty())
+    {
+        entity = EntityId(m_entities.size());
+        m_entities.push_back(Entity{});
+    }
+    else
+    {
+        entity = m_freeEntities.back();
+        m_freeEntities.pop_back();
+    }
+
+    Entity& newEntity = m_entities[entity];
+    newEntity.X = ToCell(aX);
+    newEntity.Y = ToCell(aY);
+    newEntity.Active = true;
+
+    Cell& cell = GetCell(newEntity.X, newEntity.Y);
+    for (ObserverId observer : cell.Observers)
+        m_events.push_back(Event{ Event::kEnter, observer, entity });
+
+    cell.Entities.push_back(entity);
+
+    return entity;
+}
+
+void InterestGrid::RemoveEntity(EntityId aEntity)
+{
+    if (aEntity >= m_entities.size() || !m_entities[aEntity].Active)
+        return;
+
+    Entity& entity = m_entities[aEntity];
+    if (const Cell* pCell = FindCell(entity.X, entity.Y))
+    {
+        for (ObserverId observer : pCell->Observers)
+            m_events.push_back(Event{ Event::kLeave, observer, aEntity });
+    }
+
+    RemoveFromCell(aEntity, entity.X, entity.Y);
+
+    entity.Active = false;
+    m_freeEntities.push_back(aEntity);
+}
+
+void InterestGrid::MoveEntity(EntityId aEntity, float aX, float aY)
+{
+    if (aEntity >= m_entities.size() || !m_entities[aEntity].Active)
+        return;
+
+    Entity& entity = m_entities[aEntity];
+    const int32_t cX = ToCell(aX);
+    const int32_t cY = ToCell(aY);
+
+    // Moving inside a cell changes nothing
+    if (cX == entity.X && cY == entity.Y)
+        return;
+
+    // Observers of both cells keep seeing it
+    if (const Cell* pCell = FindCell(entity.X, entity.Y))
+    {
+        for (ObserverId observer : pCell->Observers)
+        {
+            if (!Sees(m_observers[observer], cX, cY))
+                m_events.push_back(Event{ Event::kLeave, observer, aEntity });
+        }
+    }
+
+    Cell& cell = GetCell(cX, cY);
+    for (ObserverId observer : cell.Observers)
+    {
+        if (!Sees(m_observers[observer], entity.X, entity.Y))
+            m_events.push_back(Event{ Event::kEnter, observer, aEntity });
+    }
+
+    cell.Entities.push_back(aEntity);
+    RemoveFromCell(aEntity, entity.X, entity.Y);
+
+    entity.X = cX;
+    entity.Y = cY;
+}
+
+InterestGrid::ObserverId InterestGrid::AddObserver(const Endpoint& acRemote, float aX, float aY, uint32_t aRadius)
+{
+    ObserverId observer;
+    if (m_freeObservers.empty())
+    {
+        observer = ObserverId(m_observers.size());
+        m_observers.push_back(Observer{});
+    }
+    else
+    {
+        observer = m_freeObservers.back();
+        m_freeObservers.pop_back();
+    }
+
+    Observer& newObserver = m_observers[observer];
+    newObserver.Remote = acRemote;
+    newObserver.X = ToCell(aX);
+    newObserver.Y = ToCell(aY);
+    newObserver.Radius = int32_t(aRadius);
+    newObserver.Active = true;
+
+    for (int32_t y = newObserver.Y - newObserver.Radius; y <= newObserver.Y + newObserver.Radius; ++y)
+    {
+        for (int32_t x = newObserver.X - newObserver.Radius; x <= newObserver.X + newObserver.Radius; ++x)
+            Watch(observer, x, y);
+    }
+
+    return observer;
+}
+
+void InterestGrid::RemoveObserver(ObserverId aObserver)
+{
+    if (aObserver >= m_observers.size() || !m_observers[aObserver].Active)
+        return;
+
+    Observer& observer = m_observers[aObserver];
+    for (int32_t y = observer.Y - observer.Radius; y <= observer.Y + observer.Radius; ++y)
+    {
+        for (int32_t x = observer.X - observer.Radius; x <= observer.X + observer.Radius; ++x)
+        {
+            auto itor = m_cells.find(GetKey(x, y));
+            if (itor == m_cells.end())
+                continue;
+
+            Erase(itor->second.Observers, aObserver);
+            if (itor->second.Entities.empty() && itor->second.Observers.empty())
+                m_cells.erase(itor);
+        }
+    }
+
+    observer.Active = false;
+    m_freeObservers.push_back(aObserver);
+}
+
+void InterestGrid::MoveObserver(ObserverId aObserver, float aX, float aY)
+{
+    if (aObserver >= m_observers.size() || !m_observers[aObserver].Active)
+        return;
+
+    const Observer cOld = m_observers[aObserver];
+
+    Observer& observer = m_observers[aObserver];
+    observer.X = ToCell(aX);
+    observer.Y = ToCell(aY);
+
+    if (observer.X == cOld.X && observer.Y == cOld.Y)
+        return;
+
+    // Only the cells on the edges of the two squares change
+    for (int32_t y = cOld.Y - cOld.Radius; y <= cOld.Y + cOld.Radius; ++y)
+    {
+        for (int32_t x = cOld.X - cOld.Radius; x <= cOld.X + cOld.Radius; ++x)
+        {
+            if (!Sees(observer, x, y))
+                Unwatch(aObserver, x, y);
+        }
+    }
+
+    for (int32_t y = observer.Y - observer.Radius; y <= observer.Y + observer.Radius; ++y)
+    {
+        for (int32_t x = observer.X - observer.Radius; x <= observer.X + observer.Radius; ++x)
+        {
+            if (!Sees(cOld, x, y))
+                Watch(aObserver, x, y);
+        }
+    }
+}
+
+const Endpoint& InterestGrid::GetRemote(ObserverId aObserver) const
+{
+    return m_observers[aObserver].Remote;
+}
+
+size_t InterestGrid::Broadcast(Server& aServer, EntityId aEntity, const BufferView& acPayload) const
+{
+    size_t sent = 0;
+
+    ForEachObserver(aEntity, [&](ObserverId, const Endpoint& acRemote)
+    {
+        if (aServer.SendPayload(acRemote, acPayload))
+            ++sent;
+    });
+
+    return sent;
+}
+
+const InterestGrid::Event* InterestGrid::GetEvents() const
+{
+    return m_events.data();
+}
+
+size_t InterestGrid::GetEventCount() const
+{
+    return m_events.size();
+}
+
+void InterestGrid::ClearEvents()
+{
+    m_events.clear();
+}
+
+uint64_t InterestGrid::GetKey(int32_t aX, int32_t aY)
+{
+    return (uint64_t(uint32_t(aX)) << 32) | uint32_t(aY);
+}
+
+bool InterestGrid::Sees(const Observer& acObserver, int32_t aX, int32_t aY)
+{
+    return std::abs(aX - acObserver.X) <= acObserver.Radius && std::abs(aY - acObserver.Y) <= acObserver.Radius;
+}
+
+int32_t InterestGrid::ToCell(float aPosition) const
+{
+    return int32_t(std::floor(aPosition * m_inverseCellSize));
+}
+
+InterestGrid::Cell& InterestGrid::GetCell(int32_t aX, int32_t aY)
+{
+    const uint64_t cKey = GetKey(aX, aY);
+
+    auto itor = m_cells.find(cKey);
+    if (itor == m_cells.end())
+        itor = m_cells.emplace(cKey, Cell(GetAllocator())).first;
+
+    return itor->second;
+}
+
+const InterestGrid::Cell* InterestGrid::FindCell(int32_t aX, int32_t aY) const
+{
+    auto itor = m_cells.find(GetKey(aX, aY));
+    return itor != m_cells.end() ? &itor->second : nullptr;
+}
+
+void InterestGrid::RemoveFromCell(EntityId aEntity, int32_t aX, int32_t aY)
+{
+    auto itor = m_cells.find(GetKey(aX, aY));
+    if (itor == m_cells.end())
+        return;
+
+    // Empty cells are dropped, the map only holds cells someone is in or looking at
+    Erase(itor->second.Entities, aEntity);
+    if (itor->second.Entities.empty() && itor->second.Observers.empty())
+        m_cells.erase(itor);
+}
+
+void InterestGrid::Watch(ObserverId aObserver, int32_t aX, int32_t aY)
+{
+    Cell& cell = GetCell(aX, aY);
+    cell.Observers.push_back(aObserver);
+
+    for (EntityId entity : cell.Entities)
+        m_events.push_back(Event{ Event::kEnter, aObserver, entity });
+}
+
+void InterestGrid::Unwatch(ObserverId aObserver, int32_t aX, int32_t aY)
+{
+    auto itor = m_cells.find(GetKey(aX, aY));
+    if (itor == m_cells.end())
+        return;
+
+    for (EntityId entity : itor->second.Entities)
+        m_events.push_back(Event{ Event::kLeave, aObserver, entity });
+
+    Erase(itor->second.Observers, aObserver);
+    if (itor->second.Entities.empty() && itor->second.Observers.empty())
+        m_cells.erase(itor);
+}
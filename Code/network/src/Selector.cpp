@@ -1,28 +1,61 @@
 #include "Selector.h"
 
+#include <algorithm>
+#include <limits>
+
 Selector::Selector(Socket& aSocket)
-    : m_sock{aSocket.m_sock}
+    : m_socks{aSocket.m_sock}
+    , m_count{1}
+{
+}
+
+Selector::Selector(Socket& aFirst, Socket& aSecond)
+    : m_socks{aFirst.m_sock, aSecond.m_sock}
+    , m_count{2}
 {
 }
 
 bool Selector::IsReady() const
 {
-    fd_set set;
+    return Wait(0);
+}
+
+bool Selector::Wait(uint64_t aTimeoutMilliseconds) const
+{
+    return WaitMicroseconds(aTimeoutMilliseconds * 1000);
+}
+
+bool Selector::WaitMicroseconds(uint64_t aTimeoutMicroseconds) const
+{
 #ifdef _WIN32
-    set.fd_count = 1;
-    set.fd_array[0] = m_sock;
-#else
-    FD_ZERO(&set);
-    FD_SET(m_sock, &set);
-#endif
+    fd_set set;
+    set.fd_count = u_int(m_count);
+    for (size_t i = 0; i < m_count; ++i)
+        set.fd_array[i] = m_socks[i];
 
     timeval tm;
-    tm.tv_sec = 0;
-    tm.tv_usec = 0;
+    tm.tv_sec = long(aTimeoutMicroseconds / 1000000);
+    tm.tv_usec = long(aTimeoutMicroseconds % 1000000);
 
-#ifdef _WIN32
-    return select(set.fd_count, &set, nullptr, nullptr, &tm) == 1;
+    return select(set.fd_count, &set, nullptr, nullptr, &tm) > 0;
+#else
+    // poll has no limit on the descriptor's value, FD_SET past FD_SETSIZE writes out of the set
+    pollfd fds[MaxSockets];
+    for (size_t i = 0; i < m_count; ++i)
+        fds[i] = pollfd{ m_socks[i], POLLIN, 0 };
+
+#ifdef __linux__
+    // ppoll keeps the microseconds, tick deadline waits would oversleep by up to a millisecond with poll
+    timespec tm;
+    tm.tv_sec = time_t(aTimeoutMicroseconds / 1000000);
+    tm.tv_nsec = long(aTimeoutMicroseconds % 1000000) * 1000;
+
+    return ppoll(fds, nfds_t(m_count), &tm, nullptr) > 0;
 #else
-    return select(m_sock + 1, &set, nullptr, nullptr, &tm) == 1;
+    // Rounded up to what poll takes, a zero timeout stays a plain check
+    const uint64_t cTimeoutMilliseconds = std::min<uint64_t>((aTimeoutMicroseconds + 999) / 1000, std::numeric_limits<int>::max());
+
+    return poll(fds, nfds_t(m_count), int(cTimeoutMilliseconds)) > 0;
 #endif
-}
\ No newline at end of file
+#endif
+}
@@ -1,31 +1,90 @@
 #include "Server.h"
 #include "Selector.h"
 
-Server::Server()
-    : m_connectionManager(64)
+#include <algorithm>
+#include <chrono>
+
+static size_t GetPacketMemoryReserve(size_t aMaxConnections, size_t aPerConnection, size_t aMinimum, size_t aMaximum)
+{
+    // Divided first, a huge connection limit must not overflow
+    if (aMaxConnections > aMaximum / aPerConnection)
+        return aMaximum;
+
+    return std::max(aMaxConnections * aPerConnection, aMinimum);
+}
+
+Server::Server(size_t aMaxConnections, size_t aMemoryLimit, MemoryBudget* apParentBudget)
+    : m_memoryBudget(aMemoryLimit, apParentBudget)
     , m_v4Listener(Endpoint::kIPv4)
     , m_v6Listener(Endpoint::kIPv6)
+    , m_connectionManager(aMaxConnections)
+    , m_packetMemory(GetPacketMemoryReserve(aMaxConnections, PacketMemoryPerConnection, 2 * FrameChunkSize, MaxPacketMemoryReserve))
+    , m_frameArena(FrameChunkSize, m_packetMemory.IsValid() ? (Allocator*)&m_packetMemory : Allocator::GetDefault())
+    , m_pEvents(nullptr)
+    , m_pCommands(nullptr)
+    , m_running(false)
+    , m_threaded(false)
+    , m_receivedMessages(StlAllocator<ReceivedMessage>(GetAllocator()))
+    , m_batched(false)
+    , m_batchDelivered(false)
 {
-
+    // Frame chunks are kept from one tick to the next, so the arena only grows up to the busiest tick
+    m_packetMemory.Prefault(FrameChunkSize);
 }
 
 Server::~Server()
 {
+    if (m_threaded)
+    {
+        m_running = false;
+        m_ioThread.join();
+    }
+
+    GetAllocator()->Delete(m_pCommands);
+    GetAllocator()->Delete(m_pEvents);
 }
 
-bool Server::Start(uint16_t aPort) noexcept
+bool Server::Start(uint16_t aPort, Mode aMode) noexcept
 {
     if (m_v4Listener.Bind(aPort) == false)
     {
         return false;
     }
-    return m_v6Listener.Bind(m_v4Listener.GetPort());
+
+    if (!m_v6Listener.Bind(m_v4Listener.GetPort()))
+    {
+        return false;
+    }
+
+    if (aMode == kThreaded && !m_threaded)
+    {
+        m_pEvents = GetAllocator()->New<SpscRing<Event>>(QueueCapacity);
+        m_pCommands = GetAllocator()->New<SpscRing<Command>>(QueueCapacity);
+
+        m_threaded = true;
+        m_running = true;
+        m_ioThread = std::thread(&Server::RunIO, this);
+    }
+
+    return true;
 }
 
 uint32_t Server::Update(uint64_t aElapsedMilliSeconds) noexcept
 {
+    // Whatever is in the batch when this returns is handed out
+    BeginBatch();
+    m_batchDelivered = true;
+
+    if (m_threaded)
+        return DeliverEvents();
+
     uint32_t processedPackets = Work();
-    m_connectionManager.Update(aElapsedMilliSeconds, [this](const Endpoint & acRemoteEndpoint) { return OnClientDisconnected(acRemoteEndpoint); });
+    m_admissionControl.Advance(aElapsedMilliSeconds);
+    m_connectionManager.Update(aElapsedMilliSeconds, [this](const Endpoint & acRemoteEndpoint) { return NotifyDisconnected(acRemoteEndpoint); });
+
+    // Everything allocated from the frame arena during this tick is released at once
+    m_frameArena.Reset();
+
     return processedPackets;
 }
 
@@ -34,18 +93,45 @@ uint16_t Server::GetPort() const noexcept
     return m_v4Listener.GetPort();
 }
 
+void Server::SetBatchedDelivery(bool aBatched) noexcept
+{
+    m_batched = aBatched;
+}
+
+ReceivedMessage* Server::GetReceivedMessages() noexcept
+{
+    return m_receivedMessages.data();
+}
+
+size_t Server::GetReceivedMessageCount() const noexcept
+{
+    return m_receivedMessages.size();
+}
+
 void Server::Disconnect(const Endpoint& acRemoteEndpoint) noexcept
+{
+    if (m_threaded)
+    {
+        m_pCommands->Push(Command{ Command::kDisconnect, acRemoteEndpoint, BufferView() });
+        return;
+    }
+
+    Close(acRemoteEndpoint);
+}
+
+void Server::Close(const Endpoint& acRemoteEndpoint) noexcept
 {
     auto pConnection = m_connectionManager.Find(acRemoteEndpoint);
     if (pConnection && !(pConnection->GetState() == Connection::kNone))
     {
         pConnection->Disconnect();
+        m_connectionManager.Wake(*pConnection);
     }
 }
 
-bool Server::Send(const Endpoint& acRemoteEndpoint, Buffer aBuffer) noexcept
+bool Server::Send(const Endpoint& acRemoteEndpoint, const BufferView& acBuffer) noexcept
 {
-    Socket::Packet packet{ acRemoteEndpoint, std::move(aBuffer) };
+    Socket::Packet packet{ acRemoteEndpoint, acBuffer };
 
     if (acRemoteEndpoint.IsIPv6())
     {
@@ -60,7 +146,41 @@ bool Server::Send(const Endpoint& acRemoteEndpoint, Buffer aBuffer) noexcept
     return false;
 }
 
+bool Server::Send(const Endpoint& acRemoteEndpoint, const BufferChain& acChain) noexcept
+{
+    if (acRemoteEndpoint.IsIPv6())
+    {
+        return m_v6Listener.Send(acRemoteEndpoint, acChain);
+    }
+
+    if (acRemoteEndpoint.IsIPv4())
+    {
+        return m_v4Listener.Send(acRemoteEndpoint, acChain);
+    }
+
+    return false;
+}
+
 bool Server::SendPayload(const Endpoint& acRemoteEndpoint, uint8_t *apData, size_t aLength) noexcept
+{
+    // The copy waits in the queue, the frame arena belongs to the I/O thread
+    if (m_threaded)
+        return SendPayload(acRemoteEndpoint, BufferView(apData, aLength));
+
+    ScopedAllocator _(&m_frameArena);
+
+    return SendPayload(acRemoteEndpoint, BufferView(apData, aLength));
+}
+
+bool Server::SendPayload(const Endpoint& acRemoteEndpoint, const BufferView& acPayload) noexcept
+{
+    if (m_threaded)
+        return m_pCommands->Push(Command{ Command::kSend, acRemoteEndpoint, acPayload });
+
+    return Transmit(acRemoteEndpoint, acPayload);
+}
+
+bool Server::Transmit(const Endpoint& acRemoteEndpoint, const BufferView& acPayload) noexcept
 {
     auto pConnection = m_connectionManager.Find(acRemoteEndpoint);
     if (!pConnection || !pConnection->IsConnected())
@@ -68,56 +188,159 @@ bool Server::SendPayload(const Endpoint& acRemoteEndpoint, uint8_t *apData, size
         return false;
     }
 
-    // FIXME memory is allocated (and freed) for every packet sent
-    Buffer buffer(Socket::MaxPacketSize);
+    ScopedAllocator _(&m_frameArena);
+
+    m_connectionManager.Touch(*pConnection);
+
     uint32_t seq = pConnection->GetNextMessageSeq();
-    Message message(seq, apData, aLength);
-    Buffer::Writer writer(&buffer);
+    Message message(seq, acPayload);
     size_t bytesWritten = 0;
 
-    while (bytesWritten < aLength)
+    while (bytesWritten < acPayload.GetSize())
     {
-        writer.Reset();
-        pConnection->WriteHeader(writer, Connection::Header::kPayload);
-        bytesWritten += message.Write(writer, bytesWritten);
-        Send(acRemoteEndpoint, buffer);
+        // Headers are written in a small block in front of the payload, which is sent from where it is
+        Buffer header(Buffer::InlineCapacity);
+        BufferChain chain;
+        size_t headerSize = 0;
+        size_t fragmentSize = 0;
+        {
+            Buffer::Writer writer(&header);
+            pConnection->WriteHeader(writer, Connection::Header::kPayload);
+
+            const size_t cAvailableBytes = Socket::MaxPacketSize - (writer.GetBitPosition() + 7) / 8;
+            fragmentSize = message.Write(writer, chain, cAvailableBytes, bytesWritten);
+            headerSize = (writer.GetBitPosition() + 7) / 8;
+        }
+
+        if (fragmentSize == 0)
+            return false;
+
+        chain.Prepend(BufferView(std::move(header)).Slice(0, headerSize));
+        Send(acRemoteEndpoint, chain);
+
+        bytesWritten += fragmentSize;
     }
 
     return true;
 }
 
+Allocator* Server::GetFrameAllocator() noexcept
+{
+    return &m_frameArena;
+}
+
+MemoryBudget* Server::GetMemoryBudget() noexcept
+{
+    return &m_memoryBudget;
+}
+
+AdmissionControl& Server::GetAdmissionControl() noexcept
+{
+    return m_admissionControl;
+}
+
 bool Server::ProcessPacket(Socket::Packet& aPacket) noexcept
 {
-    Buffer::Reader reader(&aPacket.Payload);
+    Buffer::Reader reader = aPacket.Payload.GetReader();
+
+    // Established connections put their id in their packets, it indexes the connection directly
+    Buffer::Reader headerReader = reader;
+    auto header = Connection::ReadHeader(headerReader);
+    if (!header.HasError() && Connection::Header::HasId(header.GetResult().Type))
+    {
+        auto pConnection = m_connectionManager.Get(Connection::Id(header.GetResult().ConnectionId));
+        if (!pConnection || !pConnection->IsConnected())
+            return false;
+
+        m_connectionManager.Touch(*pConnection);
+
+        if (pConnection->GetRemoteEndpoint() != aPacket.Remote)
+            return ProcessRebind(*pConnection, aPacket, header.GetResult().Type);
+
+        return ProcessPacket(*pConnection, aPacket);
+    }
+
     auto pConnection = m_connectionManager.Find(aPacket.Remote);
     if (!pConnection)
     {
-        if (!m_connectionManager.IsFull())
-        {
-            Connection connection(*this, aPacket.Remote, true);
-            m_connectionManager.Add(std::move(connection));
-            pConnection = m_connectionManager.Find(aPacket.Remote);
+        // Only a negotiation can open a connection
+        if (header.HasError() || header.GetResult().Type != Connection::Header::kNegotiation)
+            return false;
 
-            if (pConnection)
-            {
-                return !pConnection->ProcessPacket(reader).HasError();
-                // TODO error handling
-            }
+        // Shed new connections before running out of memory, existing ones keep what they have
+        if (m_connectionManager.IsFull() || m_memoryBudget.GetAvailable() < Connection::MaxReassemblyMemory)
+            return false;
+
+        // Sources flooding us are refused, a source is only charged for a connection we could open
+        if (!m_admissionControl.Admit(aPacket.Remote))
+            return false;
+
+        Connection connection(*this, aPacket.Remote, true);
+        m_connectionManager.Add(std::move(connection));
+        pConnection = m_connectionManager.Find(aPacket.Remote);
+
+        if (pConnection)
+        {
+            return !pConnection->ProcessPacket(reader).HasError();
+            // TODO error handling
         }
 
         return false;
     }
-    else switch (pConnection->GetState())
+
+    m_connectionManager.Touch(*pConnection);
+
+    return ProcessPacket(*pConnection, aPacket);
+}
+
+bool Server::ProcessPacket(Connection& aConnection, Socket::Packet& aPacket) noexcept
+{
+    const bool cResult = Dispatch(aConnection, aPacket);
+
+    // Disconnections are handled on the next tick instead of when the connection's timer fires
+    if (aConnection.GetState() == Connection::kNone)
+        m_connectionManager.Wake(aConnection);
+
+    return cResult;
+}
+
+bool Server::ProcessRebind(Connection& aConnection, Socket::Packet& aPacket, Connection::HeaderType aHeaderType) noexcept
+{
+    // Nothing from the new address is processed until it answered the challenge, which only the real peer can do
+    // The challenge goes to an address nobody vouched for yet, like a negotiation it is only sent to sources that aren't flooding us
+    if (aHeaderType != Connection::Header::kRebind)
+    {
+        if (aConnection.CanRequestRebind() && m_admissionControl.Admit(aPacket.Remote))
+            aConnection.RequestRebind(aPacket.Remote);
+
+        return false;
+    }
+
+    if (aConnection.GetRebindEndpoint() != aPacket.Remote)
+        return false;
+
+    Buffer::Reader reader = aPacket.Payload.GetReader();
+    if (aConnection.ProcessPacket(reader).HasError())
+        return false;
+
+    return m_connectionManager.Rebind(aConnection, aPacket.Remote);
+}
+
+bool Server::Dispatch(Connection& aConnection, Socket::Packet& aPacket) noexcept
+{
+    Buffer::Reader reader = aPacket.Payload.GetReader();
+
+    switch (aConnection.GetState())
     {
     case Connection::kNone:
         break;
     case Connection::kNegociating:
     {
-        if (!pConnection->ProcessPacket(reader).HasError())
+        if (!aConnection.ProcessPacket(reader).HasError())
         {
-            if (pConnection->IsConnected())
+            if (aConnection.IsConnected())
             {
-                OnClientConnected(pConnection->GetRemoteEndpoint());
+                NotifyConnected(aConnection.GetRemoteEndpoint());
             }
 
             return true;
@@ -127,22 +350,22 @@ bool Server::ProcessPacket(Socket::Packet& aPacket) noexcept
 
     case Connection::kConnected:
     {
-        auto headerType = pConnection->ProcessPacket(reader);
+        auto headerType = aConnection.ProcessPacket(reader);
 
         // TODO error handling
         if (!headerType.HasError() 
             && (headerType.GetResult() == Connection::Header::kPayload || headerType.GetResult() == Connection::Header::kDisconnect))
         {
-            auto messageOutcome = pConnection->ReadMessage(reader);
+            auto messageOutcome = aConnection.ReadMessage(reader);
 
             while (!messageOutcome.HasError())
             {
                 const Message &message = messageOutcome.GetResult();
 
                 if (message.IsComplete())
-                    OnMessageReceived(aPacket.Remote, message);
+                    NotifyMessage(aConnection, message);
 
-                messageOutcome = pConnection->ReadMessage(reader);
+                messageOutcome = aConnection.ReadMessage(reader);
             }
 
             return true;
@@ -158,42 +381,190 @@ bool Server::ProcessPacket(Socket::Packet& aPacket) noexcept
     return false;
 }
 
-uint32_t Server::Work() noexcept
+bool Server::NotifyMessage(const Connection& acConnection, const Message& acMessage) noexcept
 {
-    uint32_t processedPackets = 0;
+    if (m_threaded)
+        return PushEvent(Event{ Event::kMessage, acConnection.GetRemoteEndpoint(), acConnection.GetId(), acMessage.GetSeq(), acMessage.GetView() });
 
-    Selector selector(m_v4Listener);
-    while (selector.IsReady())
+    if (m_batched)
     {
-        auto result = m_v4Listener.Receive();
-        if (result.HasError())
+        m_receivedMessages.push_back(ReceivedMessage{ acConnection.GetRemoteEndpoint(), acConnection.GetId(), acMessage.GetSeq(), acMessage.GetView() });
+        return true;
+    }
+
+    return OnMessageReceived(acConnection.GetRemoteEndpoint(), acMessage);
+}
+
+
+bool Server::NotifyConnected(const Endpoint& acRemoteEndpoint) noexcept
+{
+    if (!m_threaded)
+        return OnClientConnected(acRemoteEndpoint);
+
+    return PushEvent(Event{ Event::kConnected, acRemoteEndpoint, Connection::cInvalidId, 0, BufferView() });
+}
+
+bool Server::NotifyDisconnected(const Endpoint& acRemoteEndpoint) noexcept
+{
+    if (!m_threaded)
+        return OnClientDisconnected(acRemoteEndpoint);
+
+    return PushEvent(Event{ Event::kDisconnected, acRemoteEndpoint, Connection::cInvalidId, 0, BufferView() });
+}
+
+bool Server::PushEvent(Event aEvent) noexcept
+{
+    // Only the I/O thread waits when the game falls behind, packets pile up in the socket meanwhile
+    while (!m_pEvents->Push(std::move(aEvent)))
+    {
+        if (!m_running)
+            return false;
+
+        std::this_thread::yield();
+    }
+
+    return true;
+}
+
+uint32_t Server::DeliverEvents() noexcept
+{
+    uint32_t deliveredEvents = 0;
+
+    Event event;
+    while (m_pEvents->Pop(event))
+    {
+        switch (event.Type)
         {
-            // do some error handling
-            continue;
+        case Event::kConnected:
+            OnClientConnected(event.Remote);
+            break;
+        case Event::kDisconnected:
+            OnClientDisconnected(event.Remote);
+            break;
+        case Event::kMessage:
+            if (m_batched)
+                m_receivedMessages.push_back(ReceivedMessage{ event.Remote, event.ConnectionId, event.Seq, std::move(event.Data) });
+            else
+                OnMessageReceived(event.Remote, Message(event.Seq, event.Data));
+            break;
+        default:
+            break;
         }
-        else
+
+        ++deliveredEvents;
+    }
+
+    return deliveredEvents;
+}
+
+void Server::RunIO() noexcept
+{
+    using Clock = std::chrono::steady_clock;
+
+    Selector selector(m_v4Listener, m_v6Listener);
+    auto lastTick = Clock::now();
+
+    while (m_running)
+    {
+        Command command;
+        while (m_pCommands->Pop(command))
         {
-            // Route packet to a connection
-            if (ProcessPacket(result.GetResult()))
-                ++processedPackets;
+            if (command.Type == Command::kSend)
+                Transmit(command.Remote, command.Payload);
+            else if (command.Type == Command::kDisconnect)
+                Close(command.Remote);
         }
+
+        Work();
+
+        // Whole milliseconds only, the remainder is carried to the next iteration
+        const auto cElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - lastTick);
+        lastTick += cElapsed;
+
+        m_admissionControl.Advance(uint64_t(cElapsed.count()));
+
+        m_connectionManager.Update(uint64_t(cElapsed.count()), [this](const Endpoint & acRemoteEndpoint) { return NotifyDisconnected(acRemoteEndpoint); });
+        m_frameArena.Reset();
+
+        selector.Wait(IOWaitMilliseconds);
     }
+}
 
-    Selector selectorv6(m_v6Listener);
-    while (selectorv6.IsReady())
+void Server::WaitForTick(const TickScheduler& acScheduler) noexcept
+{
+    Selector selector(m_v4Listener, m_v6Listener);
+
+    while (const uint64_t cRemaining = acScheduler.GetTimeUntilNextTick(TickScheduler::Now()))
     {
-        auto result = m_v6Listener.Receive();
-        if (result.HasError())
+        // The I/O thread owns the sockets
+        if (m_threaded)
         {
-            // do some error handling
+            std::this_thread::sleep_for(std::chrono::nanoseconds(cRemaining));
             continue;
         }
-        else
+
+        // Rounded up, waking a little late is better than spinning until the deadline
+        if (selector.WaitMicroseconds((cRemaining + 999) / 1000))
+        {
+            BeginBatch();
+            Work();
+        }
+    }
+}
+
+void Server::BeginBatch() noexcept
+{
+    if (!m_batchDelivered)
+        return;
+
+    // Capacity is kept, a batch only allocates when it is the largest so far
+    m_receivedMessages.clear();
+    m_batchDelivered = false;
+}
+
+uint32_t Server::Work() noexcept
+{
+    return Work(m_v4Listener) + Work(m_v6Listener);
+}
+
+uint32_t Server::Work(Socket& aListener) noexcept
+{
+    uint32_t processedPackets = 0;
+
+    Selector selector(aListener);
+    while (selector.IsReady())
+    {
+        // Packets are only needed while they are processed, give the memory back right after
+        auto marker = m_frameArena.GetMarker();
+
+        // The packet must be gone before rewinding, its storage lives in the arena
         {
-            // Route packet to a connection
-            if (ProcessPacket(result.GetResult()))
-                ++processedPackets;
+            Outcome<Socket::Packet, Socket::Error> result;
+            {
+                ScopedAllocator _(&m_frameArena);
+                result = aListener.Receive();
+            }
+
+            if (result.HasError())
+            {
+                // The datagram is still queued, it is read again once the arena has room
+                if (result.GetError() == Socket::kOutOfMemory)
+                {
+                    m_frameArena.RewindTo(marker);
+                    break;
+                }
+
+                // do some error handling
+            }
+            else
+            {
+                // Route packet to a connection
+                if (ProcessPacket(result.GetResult()))
+                    ++processedPackets;
+            }
         }
+
+        m_frameArena.RewindTo(marker);
     }
 
     return processedPackets;
@@ -39,7 +39,9 @@ Socket::~Socket()
 
 Outcome<Socket::Packet, Socket::Error> Socket::Receive()
 {
-    Buffer buffer(MaxPacketSize);
+    Buffer buffer(MaxPacketSize, cCacheLineSize);
+    if (buffer.GetData() == nullptr)
+        return kOutOfMemory;
 
     sockaddr_storage from;
 #ifdef _WIN32
@@ -68,7 +70,8 @@ Outcome<Socket::Packet, Socket::Error> Socket::Receive()
     }
 #endif
 
-    Packet packet{ Endpoint{}, std::move(buffer) };
+    // Only the received bytes are visible, the rest of the buffer is garbage
+    Packet packet{ Endpoint{}, BufferView(std::move(buffer)).Slice(0, (size_t)result) };
     if (from.ss_family == AF_INET)
     {
         auto* pAddr = (sockaddr_in*)&from;
@@ -85,33 +88,73 @@ Outcome<Socket::Packet, Socket::Error> Socket::Receive()
 
 bool Socket::Send(const Socket::Packet& acPacket)
 {
-    if (acPacket.Remote.GetType() != m_type)
+    sockaddr_storage address;
+    const int cAddressLength = ToAddress(acPacket.Remote, address);
+    if (cAddressLength == 0)
         return false;
 
-    if (m_type == Endpoint::kIPv6)
+    return sendto(m_sock, (const char*)acPacket.Payload.GetData(), acPacket.Payload.GetSize(), 0, (sockaddr*)&address, cAddressLength) >= 0;
+}
+
+bool Socket::Send(const Endpoint& acRemote, const BufferChain& acChain)
+{
+    sockaddr_storage address;
+    const int cAddressLength = ToAddress(acRemote, address);
+    if (cAddressLength == 0)
+        return false;
+
+#ifdef _WIN32
+    WSABUF buffers[BufferChain::MaxSegments];
+    for (size_t i = 0; i < acChain.GetSegmentCount(); ++i)
     {
-        sockaddr_in6 ipv6;
-        std::memset(&ipv6, 0, sizeof(ipv6));
-        ipv6.sin6_port = htons(acPacket.Remote.GetPort());
-        ipv6.sin6_family = AF_INET6;
-        acPacket.Remote.ToNetIPv6(ipv6.sin6_addr);
-
-        if (sendto(m_sock, (const char*)acPacket.Payload.GetData(), acPacket.Payload.GetSize(), 0, (sockaddr*)& ipv6, sizeof(ipv6)) < 0)
-            return false;
+        buffers[i].buf = (CHAR*)acChain[i].GetData();
+        buffers[i].len = (ULONG)acChain[i].GetSize();
     }
-    else
+
+    DWORD sent = 0;
+    return WSASendTo(m_sock, buffers, (DWORD)acChain.GetSegmentCount(), &sent, 0, (sockaddr*)&address, cAddressLength, nullptr, nullptr) == 0;
+#else
+    iovec buffers[BufferChain::MaxSegments];
+    for (size_t i = 0; i < acChain.GetSegmentCount(); ++i)
     {
-        sockaddr_in ipv4;
-        std::memset(&ipv4, 0, sizeof(ipv4));
-        ipv4.sin_port = htons(acPacket.Remote.GetPort());
-        ipv4.sin_family = AF_INET;
-        acPacket.Remote.ToNetIPv4((uint32_t&)ipv4.sin_addr.s_addr);
-
-        if (sendto(m_sock, (const char*)acPacket.Payload.GetData(), acPacket.Payload.GetSize(), 0, (sockaddr*)&ipv4, sizeof(sockaddr_in)) < 0)
-            return false; 
+        buffers[i].iov_base = (void*)acChain[i].GetData();
+        buffers[i].iov_len = acChain[i].GetSize();
     }
 
-    return true;
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_name = &address;
+    message.msg_namelen = (socklen_t)cAddressLength;
+    message.msg_iov = buffers;
+    message.msg_iovlen = acChain.GetSegmentCount();
+
+    return sendmsg(m_sock, &message, 0) >= 0;
+#endif
+}
+
+int Socket::ToAddress(const Endpoint& acRemote, sockaddr_storage& aAddress) const
+{
+    if (acRemote.GetType() != m_type)
+        return 0;
+
+    std::memset(&aAddress, 0, sizeof(aAddress));
+
+    if (m_type == Endpoint::kIPv6)
+    {
+        auto* pIpv6 = (sockaddr_in6*)&aAddress;
+        pIpv6->sin6_port = htons(acRemote.GetPort());
+        pIpv6->sin6_family = AF_INET6;
+        acRemote.ToNetIPv6(pIpv6->sin6_addr);
+
+        return sizeof(sockaddr_in6);
+    }
+
+    auto* pIpv4 = (sockaddr_in*)&aAddress;
+    pIpv4->sin_port = htons(acRemote.GetPort());
+    pIpv4->sin_family = AF_INET;
+    acRemote.ToNetIPv4((uint32_t&)pIpv4->sin_addr.s_addr);
+
+    return sizeof(sockaddr_in);
 }
 
 bool Socket::Bind(uint16_t aPort)
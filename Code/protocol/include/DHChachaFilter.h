@@ -6,15 +6,24 @@
 
 
 struct DHChachaFilterPimpl;
+struct DHChachaHandshake;
 class DHChachaFilter : public AllocatorCompatible
 {
 public:
 
     DHChachaFilter();
+    DHChachaFilter(const DHChachaFilter&) = delete;
+    DHChachaFilter(DHChachaFilter&& aRhs) noexcept;
     ~DHChachaFilter();
 
+    DHChachaFilter& operator=(const DHChachaFilter&) = delete;
+    DHChachaFilter& operator=(DHChachaFilter&& aRhs) noexcept;
+
     bool PreConnect(Buffer::Writer* apBuffer);
     bool ReceiveConnect(Buffer::Reader* apBuffer);
+    // Frees the key exchange state, only the cipher is kept, PreConnect and ReceiveConnect fail afterwards
+    void EndHandshake();
+    bool IsHandshaking() const;
     
     // Called before the packet gets sent
     bool PreSend(Buffer::Writer* apBuffer, uint32_t aSequenceNumber);
@@ -28,5 +37,5 @@ private:
     void GenerateKeys();
 
     DHChachaFilterPimpl* m_pPimpl;
-    std::array<uint8_t, 20> m_iv;
+    DHChachaHandshake* m_pHandshake;
 };
\ No newline at end of file
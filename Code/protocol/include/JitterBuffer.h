@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Allocator.h"
+#include "StlAllocator.h"
+
+#include <vector>
+
+// Holds snapshots by server tick and plays them back a little in the past, so presentation doesn't see network jitter
+// Arrival times give the offset between the server's ticks and the local clock, the lowest transit time seen is the reference
+// The delay is a tick plus a multiple of the measured jitter, it moves towards that target slowly so playback never jumps
+// Times are in nanoseconds from the local monotonic clock, such as TickScheduler::Now
+class JitterBuffer : public AllocatorCompatible
+{
+public:
+
+    static constexpr size_t DefaultCapacity = 32;
+    static constexpr uint64_t JitterFactor = 3;
+    static constexpr uint64_t DefaultMaximumDelay = 500 * 1000 * 1000;
+
+    struct Snapshot
+    {
+        uint32_t Tick;
+        const uint8_t* pData;
+        size_t Size;
+    };
+
+    JitterBuffer(uint64_t aTickNanoseconds, size_t aCapacity = DefaultCapacity) noexcept;
+    JitterBuffer(const JitterBuffer&) = delete;
+
+    JitterBuffer& operator=(const JitterBuffer&) = delete;
+
+    // Duplicates and snapshots already played are dropped, the oldest one goes when full
+    bool Push(uint32_t aTick, uint64_t aArrivalTime, const uint8_t* apData, size_t aSize) noexcept;
+
+    // Calls aInterpolate(from, to, alpha) with the two snapshots around the playback time, alpha in [0, 1)
+    // Past the newest snapshot aExtrapolate(newest, ticks) is called instead, with how far ahead of it playback is
+    // Returns false when nothing was received yet
+    template<class TInterpolate, class TExtrapolate>
+    bool Sample(uint64_t aRenderTime, TInterpolate&& aInterpolate, TExtrapolate&& aExtrapolate) noexcept;
+
+    void SetDelayLimits(uint64_t aMinimum, uint64_t aMaximum) noexcept;
+    uint64_t GetDelay() const noexcept;
+    uint64_t GetTargetDelay() const noexcept;
+    uint64_t GetJitter() const noexcept;
+    size_t GetCount() const noexcept;
+
+private:
+
+    struct Entry
+    {
+        uint32_t Tick;
+        std::vector<uint8_t, StlAllocator<uint8_t>> Data;
+    };
+
+    // Playback position in ticks, also drops snapshots that can't be played anymore
+    double Advance(uint64_t aRenderTime) noexcept;
+    static Snapshot ToSnapshot(const Entry& acEntry) noexcept;
+
+    // Sorted by tick
+    std::vector<Entry, StlAllocator<Entry>> m_entries;
+    size_t m_capacity;
+    uint64_t m_tickNanoseconds;
+
+    int64_t m_offset;
+    int64_t m_lastTransit;
+    uint64_t m_jitter;
+    uint64_t m_delay;
+    uint64_t m_minimumDelay;
+    uint64_t m_maximumDelay;
+    uint64_t m_lastRenderTime;
+    uint32_t m_playedTick;
+    bool m_received;
+    bool m_sampled;
+};
+
+template<class TInterpolate, class TExtrapolate>
+bool JitterBuffer::Sample(uint64_t aRenderTime, TInterpolate&& aInterpolate, TExtrapolate&& aExtrapolate) noexcept
+{
+    if (m_entries.empty())
+        return false;
+
+    const double cPosition = Advance(aRenderTime);
+
+    // Before the oldest snapshot, which only happens at the start, it is shown as is
+    if (cPosition < m_entries.front().Tick)
+    {
+        aInterpolate(ToSnapshot(m_entries.front()), ToSnapshot(m_entries.front()), 0.f);
+        return true;
+    }
+
+    for (size_t i = 1; i < m_entries.size(); ++i)
+    {
+        if (cPosition < m_entries[i].Tick)
+        {
+            const Entry& cFrom = m_entries[i - 1];
+            const Entry& cTo = m_entries[i];
+
+            aInterpolate(ToSnapshot(cFrom), ToSnapshot(cTo), float((cPosition - cFrom.Tick) / (cTo.Tick - cFrom.Tick)));
+            return true;
+        }
+    }
+
+    aExtrapolate(ToSnapshot(m_entries.back()), float(cPosition - m_entries.back().Tick));
+    return true;
+}
@@ -3,7 +3,10 @@
 #include <list>
 
 #include "Buffer.h"
+#include "BufferView.h"
+#include "BufferChain.h"
 #include "Allocator.h"
+#include "StlAllocator.h"
 
 class Message
 {
@@ -16,6 +19,8 @@ public:
 
     Message() noexcept;
     Message(uint32_t aSeq, uint8_t *apData, size_t aLen) noexcept;
+    // Shares the payload instead of copying it
+    Message(uint32_t aSeq, const BufferView& acData) noexcept;
     Message(Buffer::Reader & aReader) noexcept;
     Message(Message&& aRhs) noexcept;
     Message(const Message& acRhs) noexcept;
@@ -30,7 +35,12 @@ public:
     bool IsComplete() const noexcept;
     bool IsValid() const noexcept;
     Buffer::Reader GetData() const noexcept;
+    // Shares the data of a complete message, it stays valid after the message is gone
+    BufferView GetView() const noexcept;
     size_t Write(Buffer::Writer & aWriter, size_t aOffset=0) const noexcept;
+    // Writes the header to aWriter and appends the payload to aChain as a slice, without copying it
+    // aAvailableBytes is the room left in the packet for this message, header included
+    size_t Write(Buffer::Writer & aWriter, BufferChain & aChain, size_t aAvailableBytes, size_t aOffset=0) const noexcept;
 
 private:
 
@@ -39,6 +49,7 @@ private:
     public:
         Slice(size_t aOffset, size_t aLen) noexcept;
         Slice(uint8_t * apData, size_t aLen) noexcept;
+        Slice(const BufferView& acData) noexcept;
         Slice(Buffer::Reader& aReader, size_t aMessageLength) noexcept;
         Slice(Slice&& aRhs) noexcept;
         Slice(const Slice& acRhs) noexcept;
@@ -51,13 +62,13 @@ private:
     private:
         size_t m_offset;
         size_t m_len;
-        Buffer m_data;
+        BufferView m_data;
         bool m_empty;
 
         friend class Message;
     };
 
-    std::list<Slice> m_slices;
+    std::list<Slice, StlAllocator<Slice>> m_slices;
     size_t m_len;
     uint32_t m_seq;
 
@@ -2,6 +2,9 @@
 
 #include "Message.h"
 #include "Outcome.h"
+#include "Allocator.h"
+#include "MemoryBudget.h"
+
 
 class MessageReceiver: AllocatorCompatible
 {
@@ -12,18 +15,38 @@ public:
         kNoMessage,
         kIncomplete,
         kLengthsMismatch,
-        kOld
+        kOld,
+        kOutOfMemory
     };
 
-    MessageReceiver() noexcept;
+    // Messages waiting for reassembly are charged to the budget with their full length
+    MessageReceiver(size_t aMemoryLimit = MemoryBudget::cUnlimited, MemoryBudget* apParentBudget = nullptr) noexcept;
+    MessageReceiver(const MessageReceiver&) = delete;
     ~MessageReceiver() noexcept;
 
+    MessageReceiver& operator=(const MessageReceiver&) = delete;
+
     Outcome<Message, MessageReceiver::Error> ReadMessage(Buffer::Reader & aReader) noexcept;
 
+    const MemoryBudget& GetMemoryBudget() const noexcept;
+
 private:
 
     static constexpr size_t MessageBufferSize = 256;
-    
-    std::vector<Message *> m_messageBuffer;
+
+    // A message being reassembled, or the sequence of the last one delivered from this slot
+    struct Slot
+    {
+        Message* pMessage;
+        uint32_t Seq;
+        bool Completed;
+    };
+
+    // The slot's message was moved to acMessage
+    void Complete(Slot& aSlot, const Message& acMessage) noexcept;
+
+    // Most connections never receive a fragmented message, the table is only allocated for the first one
+    Slot* m_pMessageBuffer;
+    MemoryBudget m_memoryBudget;
 };
 
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Buffer.h"
+#include "Outcome.h"
+#include "StlAllocator.h"
+
+#include <vector>
+
+// Game state snapshots sent as bit level deltas against the newest snapshot the receiver acknowledged
+// The snapshot is XORed with the baseline a 32 bit word at a time, unchanged words cost a single bit and changed ones 33
+// Both sides keep the last HistorySize snapshots indexed by sequence, a snapshot is sent in full when no acknowledged one is left
+// Acks are small payloads the receiver sends back with WriteAck, losing some of them only makes deltas a bit larger
+class SnapshotSender : public AllocatorCompatible
+{
+public:
+
+    static constexpr uint32_t HistorySize = 32;
+
+    SnapshotSender() noexcept;
+    SnapshotSender(const SnapshotSender&) = delete;
+
+    SnapshotSender& operator=(const SnapshotSender&) = delete;
+
+    // Each call is a new snapshot with the next sequence, it is kept as a future baseline
+    bool Write(Buffer::Writer& aWriter, const uint8_t* apData, size_t aSize) noexcept;
+
+    // Acks that are late, duplicated or for snapshots never sent are ignored
+    bool ReadAck(Buffer::Reader& aReader) noexcept;
+    void Acknowledge(uint32_t aSeq) noexcept;
+
+    uint32_t GetSeq() const noexcept;
+    uint32_t GetAckedSeq() const noexcept;
+
+private:
+
+    struct Entry
+    {
+        uint32_t Seq;
+        std::vector<uint8_t, StlAllocator<uint8_t>> Data;
+    };
+
+    std::vector<Entry, StlAllocator<Entry>> m_history;
+    uint32_t m_seq;
+    uint32_t m_ackedSeq;
+};
+
+class SnapshotReceiver : public AllocatorCompatible
+{
+public:
+
+    enum Error
+    {
+        kMalformed,
+        // Not newer than the last snapshot read
+        kOld,
+        // Its baseline was never received or is too old, a later snapshot will be encoded against an acked one
+        kNoBaseline
+    };
+
+    static constexpr size_t MaxSnapshotSize = 1 << 20;
+
+    SnapshotReceiver() noexcept;
+    SnapshotReceiver(const SnapshotReceiver&) = delete;
+
+    SnapshotReceiver& operator=(const SnapshotReceiver&) = delete;
+
+    // Rebuilds the snapshot and returns its sequence, GetData stays valid until the next Read
+    Outcome<uint32_t, Error> Read(Buffer::Reader& aReader) noexcept;
+    // Acknowledges the last snapshot read
+    bool WriteAck(Buffer::Writer& aWriter) const noexcept;
+
+    uint32_t GetSeq() const noexcept;
+    const uint8_t* GetData() const noexcept;
+    size_t GetSize() const noexcept;
+
+private:
+
+    struct Entry
+    {
+        uint32_t Seq;
+        std::vector<uint8_t, StlAllocator<uint8_t>> Data;
+    };
+
+    std::vector<Entry, StlAllocator<Entry>> m_history;
+    std::vector<uint8_t, StlAllocator<uint8_t>> m_scratch;
+    uint32_t m_seq;
+};
@@ -30,43 +30,80 @@ namespace DHParams
 
 struct DHChachaFilterPimpl
 {
-    CryptoPP::DH m_dh;
     CryptoPP::XChaCha20::Encryption m_cipher;
+    std::array<uint8_t, 20> m_iv{ 0 };
+};
+
+// Group parameters and keys are only needed until both sides agreed on a secret
+struct DHChachaHandshake
+{
+    CryptoPP::DH m_dh;
     CryptoPP::SecByteBlock m_pubKey;
     CryptoPP::SecByteBlock m_priKey;
 };
 
 DHChachaFilter::DHChachaFilter()
     : m_pPimpl{GetAllocator()->New<DHChachaFilterPimpl>()}
-    , m_iv{0}
+    , m_pHandshake{GetAllocator()->New<DHChachaHandshake>()}
 {
-    m_pPimpl->m_dh.AccessGroupParameters().Initialize(DHParams::p, DHParams::q, DHParams::g);
+    m_pHandshake->m_dh.AccessGroupParameters().Initialize(DHParams::p, DHParams::q, DHParams::g);
 
-    m_pPimpl->m_priKey.resize(m_pPimpl->m_dh.PrivateKeyLength());
-    m_pPimpl->m_pubKey.resize(m_pPimpl->m_dh.PublicKeyLength());
+    m_pHandshake->m_priKey.resize(m_pHandshake->m_dh.PrivateKeyLength());
+    m_pHandshake->m_pubKey.resize(m_pHandshake->m_dh.PublicKeyLength());
 
     GenerateKeys();
 }
 
+DHChachaFilter::DHChachaFilter(DHChachaFilter&& aRhs) noexcept
+    : AllocatorCompatible(aRhs)
+    , m_pPimpl{aRhs.m_pPimpl}
+    , m_pHandshake{aRhs.m_pHandshake}
+{
+    aRhs.m_pPimpl = nullptr;
+    aRhs.m_pHandshake = nullptr;
+}
+
 DHChachaFilter::~DHChachaFilter()
 {
+    GetAllocator()->Delete(m_pHandshake);
     GetAllocator()->Delete(m_pPimpl);
 }
 
+DHChachaFilter& DHChachaFilter::operator=(DHChachaFilter&& aRhs) noexcept
+{
+    GetAllocator()->Delete(m_pHandshake);
+    GetAllocator()->Delete(m_pPimpl);
+
+    SetAllocator(aRhs.GetAllocator());
+    m_pPimpl = aRhs.m_pPimpl;
+    m_pHandshake = aRhs.m_pHandshake;
+
+    aRhs.m_pPimpl = nullptr;
+    aRhs.m_pHandshake = nullptr;
+
+    return *this;
+}
+
 bool DHChachaFilter::PreConnect(Buffer::Writer* apBuffer)
 {
-    return apBuffer->WriteBytes(m_pPimpl->m_pubKey.BytePtr(), m_pPimpl->m_pubKey.SizeInBytes());
+    if (m_pHandshake == nullptr)
+        return false;
+
+    return apBuffer->WriteBytes(m_pHandshake->m_pubKey.BytePtr(), m_pHandshake->m_pubKey.SizeInBytes());
 }
 
 bool DHChachaFilter::ReceiveConnect(Buffer::Reader* apBuffer)
 {
-    CryptoPP::SecByteBlock sharedSecret(m_pPimpl->m_dh.AgreedValueLength());
-    CryptoPP::SecByteBlock pubKey(m_pPimpl->m_dh.PublicKeyLength());
+    if (m_pHandshake == nullptr)
+        return false;
+
+    CryptoPP::SecByteBlock sharedSecret(m_pHandshake->m_dh.AgreedValueLength());
+    CryptoPP::SecByteBlock pubKey(m_pHandshake->m_dh.PublicKeyLength());
 
     if(!apBuffer->ReadBytes((CryptoPP::byte*)pubKey, pubKey.SizeInBytes()))
         return false;
 
-    if (!m_pPimpl->m_dh.Agree(sharedSecret, m_pPimpl->m_priKey, pubKey))
+    if (!m_pHandshake->m_dh.Agree(sharedSecret, m_pHandshake->m_priKey, pubKey))
         return false;
     
     CryptoPP::SecByteBlock key(CryptoPP::SHA256::DIGESTSIZE);
@@ -75,13 +112,24 @@ bool DHChachaFilter::ReceiveConnect(Buffer::Reader* apBuffer)
     CryptoPP::SHA256().CalculateDigest(key, sharedSecret, sharedSecret.SizeInBytes());
     CryptoPP::BLAKE2b().CalculateDigest(iv, sharedSecret, sharedSecret.SizeInBytes());
 
-    std::copy(iv.BytePtr(), iv.BytePtr() + std::size(m_iv), std::begin(m_iv));
+    std::copy(iv.BytePtr(), iv.BytePtr() + std::size(m_pPimpl->m_iv), std::begin(m_pPimpl->m_iv));
 
     m_pPimpl->m_cipher.SetKeyWithIV(key.BytePtr(), key.SizeInBytes(), iv.BytePtr());
 
     return true;
 }
 
+void DHChachaFilter::EndHandshake()
+{
+    GetAllocator()->Delete(m_pHandshake);
+    m_pHandshake = nullptr;
+}
+
+bool DHChachaFilter::IsHandshaking() const
+{
+    return m_pHandshake != nullptr;
+}
+
 bool DHChachaFilter::PreSend(Buffer::Writer* apBuffer, uint32_t aSequenceNumber)
 {
     (void)apBuffer;
@@ -98,12 +146,16 @@ bool DHChachaFilter::PostSend(uint8_t* apPayload, size_t aLength, uint32_t aSequ
 
 bool DHChachaFilter::PreReceive(uint8_t* apPayload, size_t aLength, uint32_t aSequenceNumber)
 {
+    if (m_pPimpl == nullptr)
+        return false;
+
     std::array<uint8_t, 24> iv;
+    const auto& cBaseIv = m_pPimpl->m_iv;
 
-    std::copy(std::begin(m_iv), std::end(m_iv), std::begin(iv));
+    std::copy(std::begin(cBaseIv), std::end(cBaseIv), std::begin(iv));
 
     uint8_t* pSequenceAsBytes = (uint8_t*)& aSequenceNumber;
-    std::copy(pSequenceAsBytes, pSequenceAsBytes + 4, std::begin(iv) + std::size(m_iv));
+    std::copy(pSequenceAsBytes, pSequenceAsBytes + 4, std::begin(iv) + std::size(cBaseIv));
 
     m_pPimpl->m_cipher.Resynchronize(iv.data(), std::size(iv));
     m_pPimpl->m_cipher.ProcessData(apPayload, apPayload, aLength);
@@ -115,5 +167,5 @@ void DHChachaFilter::GenerateKeys()
 {
     CryptoPP::AutoSeededRandomPool rng;
 
-    m_pPimpl->m_dh.GenerateKeyPair(rng, m_pPimpl->m_priKey, m_pPimpl->m_pubKey);
+    m_pHandshake->m_dh.GenerateKeyPair(rng, m_pHandshake->m_priKey, m_pHandshake->m_pubKey);
 }
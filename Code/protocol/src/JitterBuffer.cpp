@@ -0,0 +1,130 @@
+#include "JitterBuffer.h"
+
+#include <algorithm>
+
+JitterBuffer::JitterBuffer(uint64_t aTickNanoseconds, size_t aCapacity) noexcept
+    : m_entries(StlAllocator<Entry>(GetAllocator()))
+    , m_capacity(std::max<size_t>(aCapacity, 2))
+    , m_tickNanoseconds(std::max<uint64_t>(aTickNanoseconds, 1))
+    , m_offset(0)
+    , m_lastTransit(0)
+    , m_jitter(0)
+    , m_delay(m_tickNanoseconds)
+    , m_minimumDelay(m_tickNanoseconds)
+    , m_maximumDelay(std::max(DefaultMaximumDelay, m_tickNanoseconds))
+    , m_lastRenderTime(0)
+    , m_playedTick(0)
+    , m_received(false)
+    , m_sampled(false)
+{
+    m_entries.reserve(m_capacity);
+}
+
+bool JitterBuffer::Push(uint32_t aTick, uint64_t aArrivalTime, const uint8_t* apData, size_t aSize) noexcept
+{
+    if (aTick < m_playedTick)
+        return false;
+
+    auto itor = std::lower_bound(m_entries.begin(), m_entries.end(), aTick, [](const Entry& acEntry, uint32_t aTick) { return acEntry.Tick < aTick; });
+    if (itor != m_entries.end() && itor->Tick == aTick)
+        return false;
+
+    if (m_entries.size() == m_capacity)
+    {
+        if (itor == m_entries.begin())
+            return false;
+
+        m_entries.erase(m_entries.begin());
+        itor = std::lower_bound(m_entries.begin(), m_entries.end(), aTick, [](const Entry& acEntry, uint32_t aTick) { return acEntry.Tick < aTick; });
+    }
+
+    // How late the snapshot is compared to when its tick happened on the server, up to a constant
+    const int64_t cTransit = int64_t(aArrivalTime) - int64_t(uint64_t(aTick) * m_tickNanoseconds);
+
+    if (!m_received)
+    {
+        m_offset = cTransit;
+        m_lastTransit = cTransit;
+        m_received = true;
+    }
+    else
+    {
+        // Interarrival jitter as in RTP, a running mean of how much transit times change
+        const int64_t cDifference = cTransit > m_lastTransit ? cTransit - m_lastTransit : m_lastTransit - cTransit;
+        m_jitter = uint64_t(int64_t(m_jitter) + (cDifference - int64_t(m_jitter)) / 16);
+        m_lastTransit = cTransit;
+
+        // The fastest snapshot is the reference, it slowly gives way to follow clock drift
+        if (cTransit < m_offset)
+            m_offset = cTransit;
+        else
+            m_offset += (cTransit - m_offset) / 1024;
+    }
+
+    Entry entry{ aTick, std::vector<uint8_t, StlAllocator<uint8_t>>(apData, apData + aSize, StlAllocator<uint8_t>(GetAllocator())) };
+    m_entries.insert(itor, std::move(entry));
+
+    return true;
+}
+
+void JitterBuffer::SetDelayLimits(uint64_t aMinimum, uint64_t aMaximum) noexcept
+{
+    m_minimumDelay = aMinimum;
+    m_maximumDelay = std::max(aMinimum, aMaximum);
+}
+
+uint64_t JitterBuffer::GetDelay() const noexcept
+{
+    return m_delay;
+}
+
+uint64_t JitterBuffer::GetTargetDelay() const noexcept
+{
+    return std::min(std::max(m_tickNanoseconds + JitterFactor * m_jitter, m_minimumDelay), m_maximumDelay);
+}
+
+uint64_t JitterBuffer::GetJitter() const noexcept
+{
+    return m_jitter;
+}
+
+size_t JitterBuffer::GetCount() const noexcept
+{
+    return m_entries.size();
+}
+
+double JitterBuffer::Advance(uint64_t aRenderTime) noexcept
+{
+    // Playback runs at most 10% faster or slower while the delay catches up with its target
+    const uint64_t cElapsed = m_sampled && aRenderTime > m_lastRenderTime ? aRenderTime - m_lastRenderTime : 0;
+    const uint64_t cStep = cElapsed / 10;
+    const uint64_t cTarget = GetTargetDelay();
+
+    if (m_delay < cTarget)
+        m_delay = std::min(cTarget, m_delay + cStep);
+    else
+        m_delay = std::max(cTarget, m_delay > cStep ? m_delay - cStep : 0);
+
+    m_lastRenderTime = aRenderTime;
+    m_sampled = true;
+
+    const double cPosition = double(int64_t(aRenderTime) - m_offset - int64_t(m_delay)) / double(m_tickNanoseconds);
+
+    // One snapshot before the playback position is kept to interpolate from
+    size_t played = 0;
+    while (played + 1 < m_entries.size() && m_entries[played + 1].Tick <= cPosition)
+        ++played;
+
+    if (played > 0)
+    {
+        m_entries.erase(m_entries.begin(), m_entries.begin() + played);
+        m_playedTick = m_entries.front().Tick;
+    }
+
+    return cPosition;
+}
+
+JitterBuffer::Snapshot JitterBuffer::ToSnapshot(const Entry& acEntry) noexcept
+{
+    return Snapshot{ acEntry.Tick, acEntry.Data.data(), acEntry.Data.size() };
+}
@@ -59,13 +59,19 @@ Message& Message::Merge(Message& aDest, Message& aSource) noexcept
         if (next != aDest.m_slices.end() && !it->m_empty && !next->m_empty)
         {
             Buffer buffer(it->m_len + next->m_len);
+            if (buffer.GetData() == nullptr)
+            {
+                // Out of memory, the slices stay apart and the message incomplete
+                it++;
+                continue;
+            }
 
             std::copy(it->m_data.GetData(), it->m_data.GetData() + it->m_len, buffer.GetWriteData());
             std::copy(next->m_data.GetData(), next->m_data.GetData() + next->m_len, buffer.GetWriteData() + it->m_len);
 
             next->m_offset = it->m_offset;
             next->m_len = it->m_len + next->m_len;
-            next->m_data = std::move(buffer);
+            next->m_data = BufferView(std::move(buffer));
 
             it = aDest.m_slices.erase(it);
         }
@@ -96,6 +102,14 @@ Message::Message(uint32_t aSeq, uint8_t *apData, size_t aLen) noexcept
 
 }
 
+Message::Message(uint32_t aSeq, const BufferView& acData) noexcept
+    : m_slices({ Message::Slice(acData) })
+    , m_len(acData.GetSize())
+    , m_seq(aSeq)
+{
+
+}
+
 Message::Message(Buffer::Reader& aReader) noexcept
     : m_slices()
     , m_len(0)
@@ -196,7 +210,15 @@ bool Message::IsValid() const noexcept
 // Do not call this if IsComplete() returns false or face undefined behavior
 Buffer::Reader Message::GetData() const noexcept
 {
-    return Buffer::Reader((Buffer *)&m_slices.front().m_data);
+    return m_slices.front().m_data.GetReader();
+}
+
+BufferView Message::GetView() const noexcept
+{
+    if (!IsComplete())
+        return BufferView();
+
+    return m_slices.front().m_data.Slice(0, m_len);
 }
 
 // Returns the number of bytes of real data (not headers) written
@@ -225,6 +247,21 @@ size_t Message::Write(Buffer::Writer& aWriter, size_t aOffset) const noexcept
     return bytesToWrite;
 }
 
+size_t Message::Write(Buffer::Writer& aWriter, BufferChain& aChain, size_t aAvailableBytes, size_t aOffset) const noexcept
+{
+    if (!IsComplete() || aAvailableBytes <= Message::HeaderBytes || aChain.GetSegmentCount() == BufferChain::MaxSegments)
+        return 0;
+
+    aWriter.WriteBytes((uint8_t *)&m_seq, sizeof(m_seq));
+    aWriter.WriteBits(m_len, Message::MessageLenBits);
+    aWriter.WriteBits(aOffset, Message::MessageLenBits);
+
+    size_t bytesToWrite = std::min(aAvailableBytes - Message::HeaderBytes, m_len - aOffset);
+    aChain.Append(m_slices.front().m_data.Slice(aOffset, bytesToWrite));
+
+    return bytesToWrite;
+}
+
 Message::Slice::Slice(size_t aOffset, size_t aLen) noexcept
     : m_offset(aOffset)
     , m_len(aLen)
@@ -236,10 +273,17 @@ Message::Slice::Slice(size_t aOffset, size_t aLen) noexcept
 Message::Slice::Slice(uint8_t *apData, size_t aLen) noexcept
     : m_offset(0)
     , m_len(aLen)
+    , m_data(apData, aLen)
+    , m_empty(false)
+{
+}
+
+Message::Slice::Slice(const BufferView& acData) noexcept
+    : m_offset(0)
+    , m_len(acData.GetSize())
+    , m_data(acData)
     , m_empty(false)
 {
-    m_data = Buffer(aLen);
-    std::copy(apData, apData + aLen, m_data.GetWriteData());
 }
 
 Message::Slice::Slice(Buffer::Reader& aReader, size_t aMessageLength) noexcept
@@ -250,8 +294,9 @@ Message::Slice::Slice(Buffer::Reader& aReader, size_t aMessageLength) noexcept
     if (aReader.ReadBits(m_offset, Message::MessageLenBits) && m_offset < aMessageLength)
     {
         m_len = std::min(aReader.GetSize() - aReader.GetBytePosition(), aMessageLength - m_offset);
-        m_data = Buffer(m_len);
-        m_empty = !aReader.ReadBytes(m_data.GetWriteData(), m_len);
+        Buffer data(m_len);
+        m_empty = data.GetSize() != m_len || !aReader.ReadBytes(data.GetWriteData(), m_len);
+        m_data = BufferView(std::move(data));
     }
 }
 
@@ -1,19 +1,31 @@
 #include "MessageReceiver.h"
 
+#include <algorithm>
 
 
-MessageReceiver::MessageReceiver() noexcept
-    : m_messageBuffer(MessageReceiver::MessageBufferSize, nullptr)
+
+MessageReceiver::MessageReceiver(size_t aMemoryLimit, MemoryBudget* apParentBudget) noexcept
+    : m_pMessageBuffer(nullptr)
+    , m_memoryBudget(aMemoryLimit, apParentBudget)
 {}
 
 
 MessageReceiver::~MessageReceiver() noexcept
 {
-    for (Message *pMessage : m_messageBuffer)
+    if (m_pMessageBuffer == nullptr)
+        return;
+
+    for (size_t i = 0; i < MessageReceiver::MessageBufferSize; ++i)
     {
+        Message* pMessage = m_pMessageBuffer[i].pMessage;
         if (pMessage != nullptr)
+        {
+            m_memoryBudget.Release(pMessage->GetLen());
             GetAllocator()->Delete<Message>(pMessage);
+        }
     }
+
+    GetAllocator()->Free(m_pMessageBuffer);
 }
 
 Outcome<Message, MessageReceiver::Error> MessageReceiver::ReadMessage(Buffer::Reader &aReader) noexcept
@@ -32,26 +44,54 @@ Outcome<Message, MessageReceiver::Error> MessageReceiver::ReadMessage(Buffer::Re
         return message;
 
 
+    if (m_pMessageBuffer == nullptr)
+    {
+        m_pMessageBuffer = (Slot*)GetAllocator()->Allocate(sizeof(Slot) * MessageReceiver::MessageBufferSize, alignof(Slot));
+        if (m_pMessageBuffer == nullptr)
+            return MessageReceiver::Error::kOutOfMemory;
+
+        std::fill(m_pMessageBuffer, m_pMessageBuffer + MessageReceiver::MessageBufferSize, Slot{ nullptr, 0, false });
+    }
+
     size_t mPos = message.GetSeq() % MessageReceiver::MessageBufferSize;
+    Slot& slot = m_pMessageBuffer[mPos];
 
-    if (m_messageBuffer[mPos] == nullptr)
+    if (slot.pMessage == nullptr)
     {
-        m_messageBuffer[mPos] = GetAllocator()->New<Message>(std::move(message));
-        return *m_messageBuffer[mPos];
+        if (slot.Completed)
+        {
+            // Late fragment of a message that was already delivered, there is nothing to return
+            if (slot.Seq == message.GetSeq())
+                return Message();
+
+            if (slot.Seq > message.GetSeq())
+                return MessageReceiver::Error::kOld;
+        }
+
+        if (!m_memoryBudget.Reserve(message.GetLen()))
+            return MessageReceiver::Error::kOutOfMemory;
+
+        slot.pMessage = GetAllocator()->New<Message>(std::move(message));
+        slot.Completed = false;
+        return *slot.pMessage;
     }
 
-    Message& oldMessage = *m_messageBuffer[mPos];
+    Message& oldMessage = *slot.pMessage;
 
     if (oldMessage.GetSeq() == message.GetSeq())
     {
         if (oldMessage.GetLen() != message.GetLen())
             return MessageReceiver::Error::kLengthsMismatch;
 
-        if (oldMessage.IsComplete())
+        Message::Merge(oldMessage, message);
+        if (!oldMessage.IsComplete())
             return oldMessage;
 
-        Message::Merge(oldMessage, message);
-        return oldMessage;
+        // Delivered messages give their memory back, only their sequence is kept to recognize duplicates
+        Message completeMessage(std::move(oldMessage));
+        Complete(slot, completeMessage);
+
+        return completeMessage;
     }
     else
     {
@@ -59,10 +99,32 @@ Outcome<Message, MessageReceiver::Error> MessageReceiver::ReadMessage(Buffer::Re
             return MessageReceiver::Error::kOld;
 
         // Buffer entry is stale, replace it
-        GetAllocator()->Delete<Message>(m_messageBuffer[mPos]);
-        m_messageBuffer[mPos] = GetAllocator()->New<Message>(std::move(message));
-        return *m_messageBuffer[mPos];
+        const size_t cOldLen = oldMessage.GetLen();
+        GetAllocator()->Delete<Message>(slot.pMessage);
+        slot.pMessage = nullptr;
+        m_memoryBudget.Release(cOldLen);
+
+        if (!m_memoryBudget.Reserve(message.GetLen()))
+            return MessageReceiver::Error::kOutOfMemory;
+
+        slot.pMessage = GetAllocator()->New<Message>(std::move(message));
+        return *slot.pMessage;
     }
 
     // return MessageReceiver::Error::kUndeterminedErrorBecauseIveMissedSomeCondition;
+}
+
+void MessageReceiver::Complete(Slot& aSlot, const Message& acMessage) noexcept
+{
+    m_memoryBudget.Release(acMessage.GetLen());
+    GetAllocator()->Delete<Message>(aSlot.pMessage);
+
+    aSlot.pMessage = nullptr;
+    aSlot.Seq = acMessage.GetSeq();
+    aSlot.Completed = true;
+}
+
+const MemoryBudget& MessageReceiver::GetMemoryBudget() const noexcept
+{
+    return m_memoryBudget;
 }
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include "Snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+
+static constexpr size_t cWordSize = sizeof(uint32_t);
+
+// Words past the end of a snapshot read as zero, so a snapshot and its baseline can differ in size
+static uint32_t LoadWord(const uint8_t* apData, size_t aSize, size_t aWord) noexcept
+{
+    const size_t cOffset = aWord * cWordSize;
+    if (cOffset >= aSize)
+        return 0;
+
+    uint32_t word = 0;
+    std::memcpy(&word, apData + cOffset, std::min(cWordSize, aSize - cOffset));
+    return word;
+}
+
+static void StoreWord(uint8_t* apData, size_t aSize, size_t aWord, uint32_t aValue) noexcept
+{
+    const size_t cOffset = aWord * cWordSize;
+    std::memcpy(apData + cOffset, &aValue, std::min(cWordSize, aSize - cOffset));
+}
+
+SnapshotSender::SnapshotSender() noexcept
+    : m_history(HistorySize, Entry{ 0, std::vector<uint8_t, StlAllocator<uint8_t>>(StlAllocator<uint8_t>(GetAllocator())) }, StlAllocator<Entry>(GetAllocator()))
+    , m_seq(0)
+    , m_ackedSeq(0)
+{
+}
+
+bool SnapshotSender::Write(Buffer::Writer& aWriter, const uint8_t* apData, size_t aSize) noexcept
+{
+    const uint32_t cSeq = m_seq + 1;
+
+    // The baseline's slot is about to be reused once it is HistorySize behind
+    const Entry* pBaseline = nullptr;
+    if (m_ackedSeq != 0 && cSeq - m_ackedSeq < HistorySize)
+        pBaseline = &m_history[m_ackedSeq % HistorySize];
+
+    const uint8_t* pBaseData = pBaseline ? pBaseline->Data.data() : nullptr;
+    const size_t cBaseSize = pBaseline ? pBaseline->Data.size() : 0;
+
+    if (!aWriter.WriteVarint(cSeq) || !aWriter.WriteVarint(pBaseline ? cSeq - m_ackedSeq : 0) || !aWriter.WriteVarint(aSize))
+        return false;
+
+    const size_t cWordCount = (aSize + cWordSize - 1) / cWordSize;
+    for (size_t i = 0; i < cWordCount; ++i)
+    {
+        const uint32_t cDelta = LoadWord(apData, aSize, i) ^ LoadWord(pBaseData, cBaseSize, i);
+
+        if (!aWriter.WriteBits(cDelta != 0, 1))
+            return false;
+
+        if (cDelta != 0 && !aWriter.WriteBits(cDelta, 32))
+            return false;
+    }
+
+    // Capacity is kept, slots stop allocating once they held their largest snapshot
+    Entry& entry = m_history[cSeq % HistorySize];
+    entry.Seq = cSeq;
+    entry.Data.assign(apData, apData + aSize);
+
+    m_seq = cSeq;
+
+    return true;
+}
+
+bool SnapshotSender::ReadAck(Buffer::Reader& aReader) noexcept
+{
+    uint64_t seq = 0;
+    if (!aReader.ReadVarint(seq) || seq > UINT32_MAX)
+        return false;
+
+    Acknowledge(uint32_t(seq));
+    return true;
+}
+
+void SnapshotSender::Acknowledge(uint32_t aSeq) noexcept
+{
+    if (aSeq > m_ackedSeq && aSeq <= m_seq)
+        m_ackedSeq = aSeq;
+}
+
+uint32_t SnapshotSender::GetSeq() const noexcept
+{
+    return m_seq;
+}
+
+uint32_t SnapshotSender::GetAckedSeq() const noexcept
+{
+    return m_ackedSeq;
+}
+
+SnapshotReceiver::SnapshotReceiver() noexcept
+    : m_history(SnapshotSender::HistorySize, Entry{ 0, std::vector<uint8_t, StlAllocator<uint8_t>>(StlAllocator<uint8_t>(GetAllocator())) }, StlAllocator<Entry>(GetAllocator()))
+    , m_scratch(StlAllocator<uint8_t>(GetAllocator()))
+    , m_seq(0)
+{
+}
+
+Outcome<uint32_t, SnapshotReceiver::Error> SnapshotReceiver::Read(Buffer::Reader& aReader) noexcept
+{
+    uint64_t seq = 0, distance = 0, size = 0;
+    if (!aReader.ReadVarint(seq) || !aReader.ReadVarint(distance) || !aReader.ReadVarint(size))
+        return kMalformed;
+
+    if (seq == 0 || seq > UINT32_MAX || distance >= SnapshotSender::HistorySize || distance >= seq || size > MaxSnapshotSize)
+        return kMalformed;
+
+    // Every word takes at least a bit, sizes the packet can't hold are rejected before allocating
+    const size_t cWordCount = size_t(size + cWordSize - 1) / cWordSize;
+    if (cWordCount > aReader.GetSize() * 8 - aReader.GetBitPosition())
+        return kMalformed;
+
+    if (seq <= m_seq)
+        return kOld;
+
+    const Entry* pBaseline = nullptr;
+    if (distance != 0)
+    {
+        pBaseline = &m_history[(seq - distance) % SnapshotSender::HistorySize];
+        if (pBaseline->Seq != seq - distance)
+            return kNoBaseline;
+    }
+
+    const uint8_t* pBaseData = pBaseline ? pBaseline->Data.data() : nullptr;
+    const size_t cBaseSize = pBaseline ? pBaseline->Data.size() : 0;
+
+    // Decoded aside, a malformed snapshot leaves the history untouched
+    m_scratch.resize(size_t(size));
+
+    for (size_t i = 0; i < cWordCount; ++i)
+    {
+        uint64_t changed = 0, delta = 0;
+        if (!aReader.ReadBits(changed, 1) || (changed && !aReader.ReadBits(delta, 32)))
+            return kMalformed;
+
+        StoreWord(m_scratch.data(), m_scratch.size(), i, LoadWord(pBaseData, cBaseSize, i) ^ uint32_t(delta));
+    }
+
+    // The slot's old buffer becomes the next scratch, nothing allocates once buffers are large enough
+    Entry& entry = m_history[seq % SnapshotSender::HistorySize];
+    entry.Seq = uint32_t(seq);
+    entry.Data.swap(m_scratch);
+    m_seq = uint32_t(seq);
+
+    return m_seq;
+}
+
+bool SnapshotReceiver::WriteAck(Buffer::Writer& aWriter) const noexcept
+{
+    return aWriter.WriteVarint(m_seq);
+}
+
+uint32_t SnapshotReceiver::GetSeq() const noexcept
+{
+    return m_seq;
+}
+
+const uint8_t* SnapshotReceiver::GetData() const noexcept
+{
+    return m_seq ? m_history[m_seq % SnapshotSender::HistorySize].Data.data() : nullptr;
+}
+
+size_t SnapshotReceiver::GetSize() const noexcept
+{
+    return m_seq ? m_history[m_seq % SnapshotSender::HistorySize].Data.size() : 0;
+}
@@ -1,17 +1,30 @@
 #include "catch.hpp"
 
 #include "Buffer.h"
+#include "BufferView.h"
+#include "BufferChain.h"
 #include "Outcome.h"
 #include "StandardAllocator.h"
 #include "BoundedAllocator.h"
 #include "ScratchAllocator.h"
 #include "StackAllocator.h"
 #include "TrackAllocator.h"
+#include "StlAllocator.h"
+#include "FrameArena.h"
+#include "MemoryBudget.h"
+#include "VirtualArena.h"
+#include "Serialization.h"
+#include "TimingWheel.h"
+#include "TickScheduler.h"
+#include "SpscRing.h"
 
 #include <string>
 #include <thread>
 #include <future>
 #include <cstring>
+#include <vector>
+#include <list>
+#include <random>
 
 TEST_CASE("Outcome saves the result and errors", "[core.outcome]")
 {
@@ -131,6 +144,108 @@ TEST_CASE("Allocators allocate memory", "[core.allocators]")
     }
 }
 
+TEST_CASE("Memory budgets", "[core.budget]")
+{
+    GIVEN("A budget hierarchy")
+    {
+        MemoryBudget global(1000);
+        MemoryBudget server(800, &global);
+        MemoryBudget connection(500, &server);
+
+        WHEN("Reserving within the limits")
+        {
+            REQUIRE(connection.Reserve(400));
+            REQUIRE(connection.GetUsed() == 400);
+            REQUIRE(server.GetUsed() == 400);
+            REQUIRE(global.GetUsed() == 400);
+            REQUIRE(connection.GetAvailable() == 100);
+
+            connection.Release(400);
+            REQUIRE(global.GetUsed() == 0);
+            REQUIRE(connection.GetPeak() == 400);
+        }
+
+        WHEN("A parent runs out")
+        {
+            REQUIRE(global.Reserve(700));
+            REQUIRE(connection.GetAvailable() == 300);
+
+            // Fits the connection but not the global budget, nothing must stay reserved
+            REQUIRE_FALSE(connection.Reserve(400));
+            REQUIRE(connection.GetUsed() == 0);
+            REQUIRE(server.GetUsed() == 0);
+            REQUIRE(global.GetUsed() == 700);
+            REQUIRE(connection.GetDeniedCount() == 1);
+            REQUIRE(global.GetDeniedCount() == 1);
+
+            global.Release(700);
+        }
+
+        WHEN("A child is destroyed with memory reserved")
+        {
+            {
+                MemoryBudget child(100, &server);
+                REQUIRE(child.Reserve(100));
+                REQUIRE(global.GetUsed() == 100);
+            }
+
+            REQUIRE(global.GetUsed() == 0);
+        }
+    }
+
+    GIVEN("Many threads sharing a budget")
+    {
+        MemoryBudget budget(4000);
+
+        auto work = [&budget]()
+        {
+            for (auto i{ 0 }; i < 10000; ++i)
+            {
+                if (budget.Reserve(1000))
+                    budget.Release(1000);
+            }
+        };
+
+        std::thread threads[4];
+        for (auto& thread : threads)
+            thread = std::thread(work);
+        for (auto& thread : threads)
+            thread.join();
+
+        REQUIRE(budget.GetUsed() == 0);
+        REQUIRE(budget.GetPeak() <= 4000);
+    }
+
+    GIVEN("A bounded allocator")
+    {
+        MemoryBudget parent(1000);
+        BoundedAllocator allocator(1000, &parent);
+
+        // Sizes malloc rounds up, freeing them must give back exactly what was taken
+        for (auto i{ 0 }; i < 100; ++i)
+        {
+            auto pData = allocator.Allocate(13);
+            REQUIRE(pData != nullptr);
+            REQUIRE(allocator.Size(pData) == 13);
+            allocator.Free(pData);
+        }
+
+        REQUIRE(allocator.GetBudget().GetUsed() == 0);
+        REQUIRE(allocator.Size(nullptr) == 1000);
+
+        auto pData = allocator.Allocate(600);
+        REQUIRE(pData != nullptr);
+        REQUIRE(parent.GetUsed() == 600);
+        REQUIRE(parent.Reserve(300));
+        REQUIRE(allocator.Allocate(200) == nullptr);
+        REQUIRE(allocator.GetBudget().GetDeniedCount() == 1);
+
+        allocator.Free(pData);
+        parent.Release(300);
+        REQUIRE(parent.GetUsed() == 0);
+    }
+}
+
 TEST_CASE("Making sure allocator stacks work corrently", "[core.allocator.stack]")
 {
     GIVEN("No allocator has been pushed")
@@ -224,6 +339,507 @@ TEST_CASE("Allocating memory on the stack", "[core.allocator.stack]")
 
 }
 
+TEST_CASE("Aligned allocations", "[core.allocator.aligned]")
+{
+    struct alignas(64) CacheLine
+    {
+        uint8_t Data[64];
+    };
+
+    auto isAligned = [](void* apData, size_t aAlignment)
+    {
+        return (uintptr_t(apData) & (aAlignment - 1)) == 0;
+    };
+
+    SECTION("Standard")
+    {
+        StandardAllocator allocator;
+
+        for (size_t alignment : { size_t(16), size_t(64), size_t(4096) })
+        {
+            auto pData = allocator.Allocate(100, alignment);
+            REQUIRE(pData != nullptr);
+            REQUIRE(isAligned(pData, alignment));
+            REQUIRE(allocator.Size(pData) >= 100);
+            allocator.Free(pData);
+        }
+    }
+
+    SECTION("Scratch")
+    {
+        ScratchAllocator allocator(1000);
+
+        REQUIRE(allocator.Allocate(3) != nullptr);
+        auto pData = allocator.Allocate(100, 64);
+        REQUIRE(pData != nullptr);
+        REQUIRE(isAligned(pData, 64));
+        REQUIRE(allocator.Allocate(1000, 64) == nullptr);
+    }
+
+    SECTION("Stack")
+    {
+        StackAllocator<1000> allocator;
+
+        REQUIRE(allocator.Allocate(3) != nullptr);
+        auto pData = allocator.Allocate(100, 64);
+        REQUIRE(pData != nullptr);
+        REQUIRE(isAligned(pData, 64));
+    }
+
+    SECTION("Bounded")
+    {
+        BoundedAllocator allocator(1000);
+
+        auto pData = allocator.Allocate(100, 64);
+        REQUIRE(pData != nullptr);
+        REQUIRE(isAligned(pData, 64));
+        REQUIRE(allocator.Allocate(1000, 64) == nullptr);
+        allocator.Free(pData);
+    }
+
+    SECTION("Frame")
+    {
+        FrameArena arena(1000);
+
+        REQUIRE(arena.Allocate(3) != nullptr);
+        auto pData = arena.Allocate(100, 64);
+        REQUIRE(pData != nullptr);
+        REQUIRE(isAligned(pData, 64));
+
+        pData = arena.Allocate(2000, 256);
+        REQUIRE(pData != nullptr);
+        REQUIRE(isAligned(pData, 256));
+    }
+
+    SECTION("New")
+    {
+        TrackAllocator<StandardAllocator> tracker;
+        ScopedAllocator _{ &tracker };
+
+        auto pLine = New<CacheLine>();
+        REQUIRE(pLine != nullptr);
+        REQUIRE(isAligned(pLine, 64));
+        Delete(pLine);
+    }
+}
+
+TEST_CASE("Using a frame arena", "[core.allocator.frame]")
+{
+    TrackAllocator<StandardAllocator> tracker;
+    FrameArena arena(1000, &tracker);
+
+    REQUIRE(arena.GetCapacity() == 0);
+
+    auto pFirst = arena.Allocate(10);
+    REQUIRE(pFirst != nullptr);
+    REQUIRE((uintptr_t(pFirst) & (alignof(std::max_align_t) - 1)) == 0);
+    REQUIRE(arena.GetCapacity() == 1000);
+
+    GIVEN("A marker")
+    {
+        auto marker = arena.GetMarker();
+
+        auto pSecond = arena.Allocate(100);
+        REQUIRE(pSecond != nullptr);
+        REQUIRE(pSecond != pFirst);
+
+        arena.RewindTo(marker);
+        REQUIRE(arena.Allocate(100) == pSecond);
+    }
+
+    GIVEN("Allocations larger than a chunk")
+    {
+        auto pLarge = arena.Allocate(5000);
+        REQUIRE(pLarge != nullptr);
+        REQUIRE(arena.GetCapacity() == 6000);
+
+        auto pSmall = arena.Allocate(900);
+        REQUIRE(pSmall != nullptr);
+        REQUIRE(arena.GetCapacity() == 7000);
+
+        WHEN("Resetting the arena")
+        {
+            size_t usedMemory = tracker.GetUsedMemory();
+
+            arena.Reset();
+
+            // Chunks are reused and no more memory is requested
+            REQUIRE(arena.Allocate(10) == pFirst);
+            REQUIRE(arena.Allocate(5000) == pLarge);
+            REQUIRE(arena.Allocate(900) == pSmall);
+            REQUIRE(tracker.GetUsedMemory() == usedMemory);
+        }
+    }
+
+    GIVEN("Buffers created in an arena scope")
+    {
+        ScopedAllocator _{ &arena };
+
+        Buffer buffer(100);
+        REQUIRE(buffer.GetAllocator() == &arena);
+        REQUIRE(buffer.GetData() != nullptr);
+    }
+}
+
+TEST_CASE("Using a virtual arena", "[core.allocator.virtual]")
+{
+    GIVEN("Regular pages")
+    {
+        VirtualArena arena(1 << 20, VirtualArena::kRegularPages);
+
+        REQUIRE(arena.IsValid());
+        REQUIRE(arena.UsesHugePages() == false);
+        REQUIRE(arena.GetReservedSize() == 1 << 20);
+        REQUIRE(arena.GetCommittedSize() == 0);
+
+        auto pFirst = (uint8_t*)arena.Allocate(100);
+        REQUIRE(pFirst != nullptr);
+        REQUIRE(arena.GetCommittedSize() == arena.GetPageSize());
+        std::memset(pFirst, 42, 100);
+
+        auto pAligned = arena.Allocate(10, 4096);
+        REQUIRE(pAligned != nullptr);
+        REQUIRE((uintptr_t(pAligned) & 4095) == 0);
+
+        // Pages are committed as the arena grows
+        auto pLarge = (uint8_t*)arena.Allocate(100000);
+        REQUIRE(pLarge != nullptr);
+        std::memset(pLarge, 42, 100000);
+        REQUIRE(arena.GetCommittedSize() >= 100000);
+
+        REQUIRE(arena.Allocate(1 << 20) == nullptr);
+
+        WHEN("Resetting the arena")
+        {
+            const size_t cCommittedSize = arena.GetCommittedSize();
+
+            arena.Reset();
+
+            REQUIRE(arena.Allocate(100) == pFirst);
+            REQUIRE(arena.GetCommittedSize() == cCommittedSize);
+            REQUIRE(arena.Size(nullptr) == (1 << 20) - 100);
+        }
+    }
+
+    GIVEN("Huge pages when available")
+    {
+        VirtualArena arena(8 << 20, VirtualArena::kHugePages);
+
+        REQUIRE(arena.IsValid());
+        REQUIRE(arena.Prefault(4 << 20));
+        REQUIRE(arena.GetCommittedSize() >= 4 << 20);
+
+        auto pData = (uint8_t*)arena.Allocate(3 << 20);
+        REQUIRE(pData != nullptr);
+        std::memset(pData, 42, 3 << 20);
+    }
+
+    GIVEN("A frame arena taking its chunks from it")
+    {
+        VirtualArena arena(1 << 20, VirtualArena::kRegularPages);
+        FrameArena frameArena(1000, &arena);
+
+        auto pFirst = frameArena.Allocate(900);
+        auto pSecond = frameArena.Allocate(900);
+        REQUIRE(pFirst != nullptr);
+        REQUIRE(pSecond != nullptr);
+
+        // Chunks come out of the same contiguous range
+        REQUIRE(uintptr_t(pSecond) - uintptr_t(pFirst) < 2000);
+    }
+    GIVEN("Buffers allocated once the arena is full")
+    {
+        VirtualArena arena(1 << 20, VirtualArena::kRegularPages);
+        REQUIRE(arena.Allocate(1 << 20) != nullptr);
+
+        ScopedAllocator _{ &arena };
+
+        // The failure shows as an empty buffer, writers have no room in it
+        Buffer buffer(100);
+        REQUIRE(buffer.GetData() == nullptr);
+        REQUIRE(buffer.GetSize() == 0);
+
+        Buffer::Writer writer(&buffer);
+        REQUIRE(writer.WriteBits(42, 8) == false);
+    }
+}
+
+TEST_CASE("Timing wheels", "[core.timer]")
+{
+    GIVEN("Timers across every level")
+    {
+        std::mt19937_64 generator(99);
+        TimingWheel wheel(2000);
+
+        // Delays from a single tick to past the last level
+        std::vector<uint64_t> deadlines;
+        for (size_t i = 0; i < 2000; ++i)
+        {
+            const uint64_t cDelay = generator() % (uint64_t(1) << (4 + (i % 22)));
+            deadlines.push_back(wheel.GetTime() + std::max<uint64_t>(cDelay, 1));
+            REQUIRE(wheel.Schedule(cDelay, i) != TimingWheel::cInvalidTimer);
+        }
+
+        REQUIRE(wheel.GetCount() == 2000);
+        REQUIRE(wheel.Schedule(1, 0) == TimingWheel::cInvalidTimer);
+
+        size_t fired = 0;
+        uint64_t lastTime = 0;
+        bool onTime = true;
+        bool ordered = true;
+
+        // Uneven steps, timers must fire exactly at their deadline whatever the step
+        while (wheel.GetCount() > 0)
+        {
+            fired += wheel.Advance(1 + generator() % 100000, [&](uint64_t aUserData)
+            {
+                onTime &= wheel.GetTime() == deadlines[aUserData];
+                ordered &= wheel.GetTime() >= lastTime;
+                lastTime = wheel.GetTime();
+            });
+        }
+
+        REQUIRE(fired == 2000);
+        REQUIRE(onTime);
+        REQUIRE(ordered);
+    }
+
+    GIVEN("Cancelled and rescheduled timers")
+    {
+        TimingWheel wheel(4);
+
+        const TimingWheel::TimerId cFirst = wheel.Schedule(10, 1);
+        const TimingWheel::TimerId cSecond = wheel.Schedule(10, 2);
+        REQUIRE(wheel.IsScheduled(cFirst));
+        REQUIRE(wheel.Cancel(cFirst));
+        REQUIRE(wheel.IsScheduled(cFirst) == false);
+        REQUIRE(wheel.Cancel(cFirst) == false);
+
+        std::vector<uint64_t> fired;
+        REQUIRE(wheel.Advance(9, [&](uint64_t aUserData) { fired.push_back(aUserData); }) == 0);
+
+        // Periodic timer, scheduling from the callback reuses the slot that just fired
+        REQUIRE(wheel.Advance(1, [&](uint64_t aUserData)
+        {
+            fired.push_back(aUserData);
+            REQUIRE(wheel.Schedule(0, aUserData) == cSecond);
+        }) == 1);
+
+        REQUIRE(fired == std::vector<uint64_t>{ 2 });
+        REQUIRE(wheel.IsScheduled(cSecond));
+
+        // A delay of 0 fires on the next tick, never in the same call
+        REQUIRE(wheel.Advance(1, [&](uint64_t aUserData) { fired.push_back(aUserData); }) == 1);
+        REQUIRE(wheel.GetCount() == 0);
+        REQUIRE(wheel.GetTime() == 11);
+    }
+
+    GIVEN("Timers cancelled by a callback of the same tick")
+    {
+        TimingWheel wheel(4);
+
+        std::vector<TimingWheel::TimerId> timers;
+        for (uint64_t i = 0; i < 3; ++i)
+            timers.push_back(wheel.Schedule(5, i));
+
+        // Whichever fires first cancels its siblings and takes one of their ids back
+        std::vector<uint64_t> fired;
+        REQUIRE(wheel.Advance(5, [&](uint64_t aUserData)
+        {
+            fired.push_back(aUserData);
+
+            for (const TimingWheel::TimerId cTimer : timers)
+            {
+                if (cTimer != timers[aUserData])
+                    REQUIRE(wheel.Cancel(cTimer));
+            }
+
+            REQUIRE(wheel.Schedule(0, 42) != TimingWheel::cInvalidTimer);
+        }) == 1);
+
+        REQUIRE(fired.size() == 1);
+        REQUIRE(wheel.GetCount() == 1);
+
+        REQUIRE(wheel.Advance(1, [&](uint64_t aUserData) { fired.push_back(aUserData); }) == 1);
+        REQUIRE(fired.back() == 42);
+        REQUIRE(wheel.GetCount() == 0);
+    }
+}
+
+TEST_CASE("Tick schedulers", "[core.tick]")
+{
+    const uint64_t cStart = TickScheduler::Now();
+
+    GIVEN("A rate that doesn't divide a second")
+    {
+        TickScheduler scheduler(60, 5);
+        scheduler.Reset(cStart);
+
+        REQUIRE(scheduler.RunDue(cStart, [](uint64_t) {}) == 0);
+        REQUIRE(scheduler.GetTimeUntilNextTick(cStart) == 16666667);
+
+        // Ticking exactly on the deadlines for a second adds up to a second
+        uint64_t elapsed = 0;
+        uint32_t ticks = 0;
+        while (ticks < 60)
+        {
+            const uint64_t cDeadline = scheduler.GetNextDeadline();
+            REQUIRE(scheduler.GetTimeUntilNextTick(cDeadline) == 0);
+            REQUIRE(scheduler.RunDue(cDeadline - 1, [](uint64_t) {}) == 0);
+
+            ticks += scheduler.RunDue(cDeadline, [&elapsed](uint64_t aElapsedMilliseconds)
+            {
+                REQUIRE((aElapsedMilliseconds == 16 || aElapsedMilliseconds == 17));
+                elapsed += aElapsedMilliseconds;
+            });
+        }
+
+        REQUIRE(elapsed == 1000);
+        REQUIRE(scheduler.GetNextDeadline() == cStart + 1000000000 + 16666667);
+
+        WHEN("Stalling")
+        {
+            // Two seconds late, only five ticks are caught up and the schedule doesn't move
+            REQUIRE(scheduler.RunDue(cStart + 3000000000, [](uint64_t) {}) == 5);
+            REQUIRE(scheduler.GetStats().SkippedCount == 115);
+            REQUIRE(scheduler.GetStats().TickCount == 65);
+            REQUIRE(scheduler.GetNextDeadline() == cStart + 3000000000 + 16666667);
+        }
+    }
+
+    GIVEN("Slow ticks")
+    {
+        TickScheduler scheduler(1000);
+        scheduler.Reset(cStart);
+
+        REQUIRE(scheduler.RunDue(cStart + 2000000, [](uint64_t aElapsedMilliseconds)
+        {
+            REQUIRE(aElapsedMilliseconds == 1);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }) == 2);
+
+        const TickScheduler::Stats& cStats = scheduler.GetStats();
+        REQUIRE(cStats.TickCount == 2);
+        REQUIRE(cStats.OverrunCount == 2);
+        REQUIRE(cStats.MinNanoseconds >= 2000000);
+        REQUIRE(cStats.MaxNanoseconds >= cStats.MinNanoseconds);
+        REQUIRE(scheduler.GetMeanNanoseconds() >= cStats.MinNanoseconds);
+        REQUIRE(scheduler.GetMeanNanoseconds() <= cStats.MaxNanoseconds);
+
+        scheduler.ResetStats();
+        REQUIRE(scheduler.GetStats().TickCount == 0);
+        REQUIRE(scheduler.GetMeanNanoseconds() == 0);
+    }
+}
+
+TEST_CASE("SPSC rings", "[core.spscring]")
+{
+    GIVEN("A ring used from a single thread")
+    {
+        SpscRing<std::string> ring(5);
+        REQUIRE(ring.GetCapacity() == 8);
+        REQUIRE(ring.IsEmpty());
+
+        std::string value;
+        REQUIRE(ring.Pop(value) == false);
+
+        // Wraps around a few times
+        for (size_t round = 0; round < 3; ++round)
+        {
+            for (size_t i = 0; i < 8; ++i)
+                REQUIRE(ring.Push(std::to_string(i)));
+
+            std::string extra = "extra";
+            REQUIRE(ring.Push(std::move(extra)) == false);
+            REQUIRE(extra == "extra");
+
+            for (size_t i = 0; i < 8; ++i)
+            {
+                REQUIRE(ring.Pop(value));
+                REQUIRE(value == std::to_string(i));
+            }
+
+            REQUIRE(ring.IsEmpty());
+        }
+
+        // Entries left in the ring are destroyed with it
+        REQUIRE(ring.Push(std::string(100, 'a')));
+    }
+
+    GIVEN("A producer and a consumer thread")
+    {
+        constexpr uint64_t cCount = 100000;
+        SpscRing<uint64_t> ring(64);
+
+        std::thread producer([&ring]()
+        {
+            for (uint64_t i = 0; i < cCount; ++i)
+            {
+                uint64_t value = i;
+                while (!ring.Push(std::move(value)))
+                    std::this_thread::yield();
+            }
+        });
+
+        // Everything arrives once and in order
+        uint64_t expected = 0;
+        bool ordered = true;
+        while (expected < cCount)
+        {
+            uint64_t value = 0;
+            if (ring.Pop(value))
+            {
+                ordered = ordered && value == expected;
+                ++expected;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        producer.join();
+
+        REQUIRE(ordered);
+        REQUIRE(ring.IsEmpty());
+    }
+}
+
+TEST_CASE("Using standard containers with our allocators", "[core.allocator.stl]")
+{
+    TrackAllocator<StandardAllocator> tracker;
+
+    GIVEN("A container created in an allocator scope")
+    {
+        ScopedAllocator _{ &tracker };
+
+        std::vector<uint32_t, StlAllocator<uint32_t>> values;
+        REQUIRE(values.get_allocator().GetAllocator() == &tracker);
+
+        values.resize(100, 42);
+        REQUIRE(tracker.GetUsedMemory() >= 100 * sizeof(uint32_t));
+
+        WHEN("Moving it out of the scope")
+        {
+            StandardAllocator standardAllocator;
+            std::vector<uint32_t, StlAllocator<uint32_t>> movedValues{ StlAllocator<uint32_t>(&standardAllocator) };
+            movedValues = std::move(values);
+
+            REQUIRE(movedValues.get_allocator().GetAllocator() == &tracker);
+            REQUIRE(movedValues[99] == 42);
+        }
+    }
+
+    GIVEN("A container created outside of any scope")
+    {
+        std::list<uint32_t, StlAllocator<uint32_t>> values;
+        values.push_back(42);
+
+        REQUIRE(values.get_allocator().GetAllocator() == Allocator::GetDefault());
+        REQUIRE(tracker.GetUsedMemory() == 0);
+    }
+}
+
 TEST_CASE("Buffers", "[core.buffer]")
 {
     TrackAllocator<StandardAllocator> tracker;
@@ -288,18 +904,103 @@ TEST_CASE("Buffers", "[core.buffer]")
         }
     }
 
-    GIVEN("Views")
+    GIVEN("Small buffers")
     {
-        WHEN("Using a cursor")
+        const size_t cUsedMemory = tracker.GetUsedMemory();
+
+        Buffer small(16);
+        small[0] = 42;
+        small[15] = 84;
+
+        // Stored inline, nothing comes from the allocator
+        REQUIRE(small.IsInline());
+        REQUIRE(tracker.GetUsedMemory() == cUsedMemory);
+        REQUIRE(Buffer(Buffer::InlineCapacity).IsInline());
+        REQUIRE_FALSE(Buffer(Buffer::InlineCapacity + 1).IsInline());
+        REQUIRE_FALSE(Buffer().IsInline());
+
+        WHEN("Moving it")
         {
-            Buffer buffer(100);
-            Buffer::Cursor cursor(&buffer);
+            Buffer moved(std::move(small));
+
+            REQUIRE(moved.IsInline());
+            REQUIRE(moved.GetSize() == 16);
+            REQUIRE(moved[0] == 42);
+            REQUIRE(moved[15] == 84);
+            REQUIRE(small.GetSize() == 0);
+            REQUIRE(small.GetData() == nullptr);
+        }
 
-            REQUIRE(cursor.GetBitPosition() == 0);
-            REQUIRE(cursor.GetBytePosition() == 0);
-            REQUIRE(cursor.Eof() == false);
+        WHEN("Swapping it with a large buffer")
+        {
+            Buffer large(200);
+            large[0] = 1;
+            large[199] = 2;
+            const uint8_t* pLargeData = large.GetData();
 
-            cursor.Advance(10);
+            large = std::move(small);
+
+            REQUIRE(large.IsInline());
+            REQUIRE(large.GetSize() == 16);
+            REQUIRE(large[0] == 42);
+            REQUIRE(large[15] == 84);
+
+            // The heap block changed hands without a copy
+            REQUIRE(small.GetData() == pLargeData);
+            REQUIRE(small.GetSize() == 200);
+            REQUIRE(small[199] == 2);
+
+            small = std::move(large);
+
+            REQUIRE(small.IsInline());
+            REQUIRE(small[15] == 84);
+            REQUIRE(large.GetData() == pLargeData);
+        }
+
+        WHEN("Swapping two small buffers")
+        {
+            Buffer other(8);
+            other[0] = 7;
+
+            other = std::move(small);
+
+            REQUIRE(other.GetSize() == 16);
+            REQUIRE(other[15] == 84);
+            REQUIRE(small.GetSize() == 8);
+            REQUIRE(small[0] == 7);
+            REQUIRE(small.GetData() != other.GetData());
+        }
+    }
+
+    GIVEN("An aligned buffer")
+    {
+        Buffer buffer(100, cCacheLineSize);
+
+        REQUIRE(buffer.GetSize() == 100);
+        REQUIRE(buffer.GetAlignment() == cCacheLineSize);
+        REQUIRE((uintptr_t(buffer.GetData()) & (cCacheLineSize - 1)) == 0);
+
+        WHEN("Copying it")
+        {
+            Buffer copy(buffer);
+
+            REQUIRE(copy.GetAlignment() == cCacheLineSize);
+            REQUIRE((uintptr_t(copy.GetData()) & (cCacheLineSize - 1)) == 0);
+        }
+    }
+
+    GIVEN("Views")
+    {
+        WHEN("Using a cursor")
+        {
+            Buffer buffer(100);
+            Buffer::Cursor cursor(&buffer);
+
+            REQUIRE(cursor.GetBitPosition() == 0);
+            REQUIRE(cursor.GetBytePosition() == 0);
+            REQUIRE(cursor.Eof() == false);
+
+            cursor.Advance(10);
 
             REQUIRE(cursor.GetBitPosition() == 80);
             REQUIRE(cursor.GetBytePosition() == 10);
@@ -441,4 +1142,898 @@ TEST_CASE("Buffers", "[core.buffer]")
     }
 
     REQUIRE(tracker.GetUsedMemory() == 0);
+}
+
+TEST_CASE("Growable writers", "[core.buffer.grow]")
+{
+    TrackAllocator<StandardAllocator> tracker;
+    ScopedAllocator _{ &tracker };
+
+    GIVEN("A fixed writer")
+    {
+        Buffer buffer(4);
+        Buffer::Writer writer(&buffer);
+
+        REQUIRE(writer.IsGrowable() == false);
+        REQUIRE(writer.WriteBits(0, 40) == false);
+        REQUIRE(writer.Reserve(10) == false);
+        REQUIRE(buffer.GetSize() == 4);
+    }
+
+    GIVEN("A growable writer over an empty buffer")
+    {
+        Buffer buffer;
+
+        {
+            Buffer::Writer writer(&buffer, true);
+
+            size_t resizeCount = 0;
+            size_t lastSize = buffer.GetSize();
+
+            for (uint32_t i = 0; i < 10000; ++i)
+            {
+                REQUIRE(writer.WriteBits(i & 0x7FF, 11));
+                REQUIRE(writer.WriteBytes((const uint8_t*)&i, sizeof(i)));
+
+                if (buffer.GetSize() != lastSize)
+                {
+                    lastSize = buffer.GetSize();
+                    ++resizeCount;
+                }
+            }
+
+            // Geometric growth, not one reallocation per write
+            REQUIRE(resizeCount < 20);
+            REQUIRE(buffer.GetSize() >= writer.GetBytePosition());
+        }
+
+        Buffer::Reader reader(&buffer);
+        for (uint32_t i = 0; i < 10000; ++i)
+        {
+            uint64_t bits = 0;
+            uint32_t bytes = 0;
+            REQUIRE(reader.ReadBits(bits, 11));
+            REQUIRE(bits == (i & 0x7FF));
+            REQUIRE(reader.ReadBytes((uint8_t*)&bytes, sizeof(bytes)));
+            REQUIRE(bytes == i);
+        }
+    }
+
+    GIVEN("A reserve hint")
+    {
+        Buffer buffer(10);
+        buffer[0] = 42;
+
+        Buffer::Writer writer(&buffer, true);
+        writer.Advance(1);
+
+        REQUIRE(writer.Reserve(1000));
+        REQUIRE(buffer.GetSize() == 1001);
+        REQUIRE(buffer[0] == 42);
+
+        const uint8_t* pData = buffer.GetData();
+        for (auto i{ 0 }; i < 1000; ++i)
+            REQUIRE(writer.WriteBits(1, 8));
+
+        // Everything fit in the reserved space
+        REQUIRE(buffer.GetData() == pData);
+    }
+
+    REQUIRE(tracker.GetUsedMemory() == 0);
+}
+
+TEST_CASE("Buffer views", "[core.buffer.view]")
+{
+    TrackAllocator<StandardAllocator> tracker;
+    ScopedAllocator _{ &tracker };
+
+    GIVEN("A view over a buffer")
+    {
+        Buffer buffer(200);
+        for (size_t i = 0; i < buffer.GetSize(); ++i)
+            buffer[i] = uint8_t(i);
+
+        const uint8_t* pData = buffer.GetData();
+        BufferView view(std::move(buffer));
+
+        // The buffer is adopted, not copied
+        REQUIRE(view.GetData() == pData);
+        REQUIRE(view.GetSize() == 200);
+        REQUIRE(view.GetUseCount() == 1);
+
+        WHEN("Copying and slicing it")
+        {
+            BufferView copy(view);
+            BufferView slice = view.Slice(50, 10);
+            BufferView clamped = view.Slice(190, 100);
+            BufferView outside = view.Slice(300, 10);
+
+            REQUIRE(view.GetUseCount() == 5);
+            REQUIRE(copy.GetData() == pData);
+            REQUIRE(slice.GetData() == pData + 50);
+            REQUIRE(slice.GetSize() == 10);
+            REQUIRE(clamped.GetSize() == 10);
+            REQUIRE(outside.IsEmpty());
+
+            Buffer::Reader reader = slice.GetReader();
+            uint8_t bytes[10];
+            REQUIRE(reader.ReadBytes(bytes, 10));
+            REQUIRE(bytes[0] == 50);
+            REQUIRE(bytes[9] == 59);
+            REQUIRE(reader.ReadBytes(bytes, 1) == false);
+
+            BufferView moved(std::move(slice));
+            REQUIRE(slice.IsEmpty());
+            REQUIRE(view.GetUseCount() == 5);
+        }
+
+        REQUIRE(view.GetUseCount() == 1);
+
+        WHEN("Releasing the last view")
+        {
+            view = BufferView();
+            REQUIRE(view.IsEmpty());
+            REQUIRE(tracker.GetUsedMemory() == 0);
+        }
+    }
+
+    GIVEN("A view copied from raw memory")
+    {
+        const char cData[] = "abcdef";
+        BufferView view((const uint8_t*)cData, sizeof(cData));
+
+        REQUIRE(view.GetSize() == sizeof(cData));
+        REQUIRE(view.GetData() != (const uint8_t*)cData);
+        REQUIRE(std::memcmp(view.GetData(), cData, sizeof(cData)) == 0);
+
+        REQUIRE(BufferView(nullptr, 0).IsEmpty());
+        REQUIRE(BufferView(Buffer()).GetUseCount() == 0);
+    }
+
+    GIVEN("Views shared between threads")
+    {
+        BufferView view(Buffer(100));
+
+        auto work = [&view]()
+        {
+            for (auto i{ 0 }; i < 10000; ++i)
+            {
+                BufferView copy(view);
+                (void)copy;
+            }
+        };
+
+        std::thread threads[4] = { std::thread(work), std::thread(work), std::thread(work), std::thread(work) };
+        for (auto& thread : threads)
+            thread.join();
+
+        REQUIRE(view.GetUseCount() == 1);
+    }
+
+    REQUIRE(tracker.GetUsedMemory() == 0);
+}
+
+// Byte at a time implementation the bit streams used before the scratch register, kept as a reference
+namespace Legacy
+{
+    static bool WriteBits(Buffer& aBuffer, size_t& aBitPosition, uint64_t aData, size_t aCount)
+    {
+        auto bitIndex = aBitPosition & 0x7;
+        size_t bitsToWrite = 0;
+
+        auto countOffset = aCount + bitIndex;
+        auto bytesToWrite = ((countOffset & ~0x7) + ((countOffset & 0x7) != 0 ? 8 : 0)) >> 3;
+
+        if (bytesToWrite + aBitPosition / 8 > aBuffer.GetSize())
+            return false;
+
+        auto* pLocation = aBuffer.GetWriteData() + aBitPosition / 8;
+
+        if (bitIndex != 0)
+        {
+            bitsToWrite = 8 - bitIndex;
+            bitsToWrite = bitsToWrite > aCount ? aCount : bitsToWrite;
+
+            auto workByte = *pLocation;
+            workByte &= ((1 << bitIndex) - 1);
+
+            *pLocation = ((uint8_t)(aData & 0xFF) & ((1 << bitsToWrite) - 1)) << bitIndex;
+            *pLocation |= workByte;
+
+            pLocation++;
+            bytesToWrite--;
+
+            aData >>= bitsToWrite;
+        }
+
+        uint8_t* pDirectAccess = (uint8_t*)&aData;
+        std::copy(pDirectAccess, pDirectAccess + bytesToWrite, pLocation);
+
+        aBitPosition += aCount;
+
+        return true;
+    }
+
+    static bool ReadBits(const Buffer& acBuffer, size_t& aBitPosition, uint64_t& aDestination, size_t aCount)
+    {
+        aDestination = 0;
+
+        auto bitIndex = aBitPosition & 0x7;
+        size_t bitsToRead = 0;
+
+        auto countOffset = aCount + bitIndex;
+        auto bytesToRead = ((countOffset & ~0x7) + ((countOffset & 0x7) != 0 ? 8 : 0)) >> 3;
+        if (bytesToRead + aBitPosition / 8 > acBuffer.GetSize())
+            return false;
+
+        uint64_t endBits = 0;
+
+        auto* pLocation = acBuffer.GetData() + aBitPosition / 8;
+
+        if (bitIndex != 0)
+        {
+            bitsToRead = 8 - bitIndex;
+            bitsToRead = bitsToRead > aCount ? aCount : bitsToRead;
+
+            endBits = ((*pLocation) >> bitIndex) & ((1 << bitsToRead) - 1);
+
+            pLocation++;
+            bytesToRead--;
+        }
+
+        std::copy(pLocation, pLocation + bytesToRead, (uint8_t*)&aDestination);
+        aDestination <<= bitsToRead;
+        aDestination |= endBits;
+        aDestination &= ((uint64_t(1) << aCount) - 1);
+
+        aBitPosition += aCount;
+
+        return true;
+    }
+}
+
+TEST_CASE("Buffer chains", "[core.buffer.chain]")
+{
+    static const std::string header{ "header" };
+    static const std::string payload{ "some payload" };
+    static const std::string trailer{ "tag" };
+
+    GIVEN("A chain built around a payload")
+    {
+        BufferView payloadView((const uint8_t*)payload.data(), payload.size());
+
+        BufferChain chain;
+        REQUIRE(chain.IsEmpty());
+        REQUIRE(chain.Append(payloadView.Slice(5, 7)));
+        REQUIRE(chain.Prepend(BufferView((const uint8_t*)header.data(), header.size())));
+        REQUIRE(chain.Append(BufferView((const uint8_t*)trailer.data(), trailer.size())));
+        REQUIRE(chain.Append(BufferView()));
+
+        REQUIRE(chain.GetSegmentCount() == 3);
+        REQUIRE(chain.GetSize() == header.size() + 7 + trailer.size());
+
+        // The payload is referenced, not copied
+        REQUIRE(chain[1].GetData() == payloadView.GetData() + 5);
+        REQUIRE(payloadView.GetUseCount() == 2);
+
+        BufferView flat = chain.Flatten();
+        REQUIRE(flat.GetSize() == chain.GetSize());
+        REQUIRE(std::memcmp(flat.GetData(), "headerpayloadtag", flat.GetSize()) == 0);
+
+        chain.Clear();
+        REQUIRE(chain.GetSegmentCount() == 0);
+        REQUIRE(payloadView.GetUseCount() == 1);
+    }
+
+    GIVEN("A full chain")
+    {
+        BufferView segment((const uint8_t*)payload.data(), payload.size());
+
+        BufferChain chain;
+        for (size_t i = 0; i < BufferChain::MaxSegments; ++i)
+            REQUIRE(chain.Append(segment));
+
+        REQUIRE(chain.Append(segment) == false);
+        REQUIRE(chain.Prepend(segment) == false);
+        REQUIRE(chain.GetSize() == BufferChain::MaxSegments * payload.size());
+
+        // A single segment doesn't need a copy
+        BufferChain single;
+        single.Append(segment);
+        REQUIRE(single.Flatten().GetData() == segment.GetData());
+    }
+}
+
+TEST_CASE("Bit streams", "[core.buffer.bits]")
+{
+    std::mt19937_64 generator(42);
+
+    GIVEN("Random fields of every width")
+    {
+        std::vector<std::pair<uint64_t, size_t>> fields;
+        size_t totalBits = 0;
+        while (totalBits < 8000)
+        {
+            size_t count = 1 + generator() % 64;
+            uint64_t value = generator();
+            if (count < 64)
+                value &= (uint64_t(1) << count) - 1;
+
+            fields.emplace_back(value, count);
+            totalBits += count;
+        }
+
+        Buffer buffer((totalBits + 7) / 8);
+        Buffer buffered((totalBits + 7) / 8);
+        Buffer reference((totalBits + 7) / 8);
+        size_t referencePosition = 0;
+
+        {
+            Buffer::Writer writer(&buffer);
+            Buffer::Writer bufferedWriter(&buffered, false, Buffer::Writer::kBuffered);
+            for (auto& field : fields)
+            {
+                REQUIRE(writer.WriteBits(field.first, field.second));
+                REQUIRE(bufferedWriter.WriteBits(field.first, field.second));
+                REQUIRE(Legacy::WriteBits(reference, referencePosition, field.first, field.second));
+            }
+
+            REQUIRE(writer.GetBitPosition() == totalBits);
+            REQUIRE(writer.WriteBits(0, 8) == false);
+            REQUIRE(bufferedWriter.WriteBits(0, 8) == false);
+
+            // Only the write-through writer already shows everything
+            REQUIRE(std::memcmp(buffer.GetData(), reference.GetData(), buffer.GetSize()) == 0);
+        }
+
+        // The layout on the wire must not change
+        REQUIRE(std::memcmp(buffer.GetData(), reference.GetData(), buffer.GetSize()) == 0);
+        REQUIRE(std::memcmp(buffered.GetData(), reference.GetData(), buffered.GetSize()) == 0);
+
+        Buffer::Reader reader(&buffer);
+        for (auto& field : fields)
+        {
+            uint64_t value = 0;
+            REQUIRE(reader.ReadBits(value, field.second));
+            REQUIRE(value == field.first);
+        }
+
+        uint64_t value = 0;
+        REQUIRE(reader.ReadBits(value, 8) == false);
+    }
+
+    GIVEN("Bits mixed with bytes and flushes")
+    {
+        Buffer buffer(32);
+        const uint32_t cBytes = 0xDEADBEEF;
+
+        {
+            Buffer::Writer writer(&buffer);
+            writer.WriteBits(0x5, 3);
+            writer.Flush();
+            // Resumes in the middle of the byte that was flushed
+            writer.WriteBits(0x1F, 5);
+            writer.WriteBits(0x3, 2);
+            writer.WriteBytes((const uint8_t*)&cBytes, sizeof(cBytes));
+            writer.WriteBits(0x123456789ABCDEF, 61);
+        }
+
+        Buffer::Reader reader(&buffer);
+        uint64_t value = 0;
+        uint32_t bytes = 0;
+
+        REQUIRE(reader.ReadBits(value, 3));
+        REQUIRE(value == 0x5);
+        REQUIRE(reader.ReadBits(value, 5));
+        REQUIRE(value == 0x1F);
+        REQUIRE(reader.ReadBits(value, 2));
+        REQUIRE(value == 0x3);
+        REQUIRE(reader.ReadBytes((uint8_t*)&bytes, sizeof(bytes)));
+        REQUIRE(bytes == cBytes);
+        REQUIRE(reader.ReadBits(value, 61));
+        REQUIRE(value == 0x123456789ABCDEF);
+    }
+}
+
+TEST_CASE("Bit arrays", "[core.buffer.bits]")
+{
+    std::mt19937 generator(1337);
+
+    GIVEN("Arrays of every width at every alignment")
+    {
+        std::vector<uint32_t> values(203);
+        std::vector<uint32_t> decoded(values.size());
+
+        for (size_t width = 1; width <= 32; ++width)
+        {
+            for (size_t offset = 0; offset < 8; ++offset)
+            {
+                // Values wider than the field are truncated like WriteBits does
+                for (auto& value : values)
+                    value = generator();
+
+                const size_t cBits = offset + values.size() * width;
+                Buffer buffer((cBits + 7) / 8);
+                Buffer reference((cBits + 7) / 8);
+
+                {
+                    Buffer::Writer writer(&buffer);
+                    Buffer::Writer referenceWriter(&reference);
+                    writer.WriteBits(0x55, offset);
+                    referenceWriter.WriteBits(0x55, offset);
+
+                    REQUIRE(writer.WriteBitsArray(values.data(), values.size(), width));
+                    for (uint32_t value : values)
+                        referenceWriter.WriteBits(value, width);
+
+                    REQUIRE(writer.GetBitPosition() == cBits);
+                }
+
+                REQUIRE(std::memcmp(buffer.GetData(), reference.GetData(), buffer.GetSize()) == 0);
+
+                Buffer::Reader reader(&buffer);
+                uint64_t prefix = 0;
+                reader.ReadBits(prefix, offset);
+                REQUIRE(reader.ReadBitsArray(decoded.data(), decoded.size(), width));
+                REQUIRE(reader.GetBitPosition() == cBits);
+
+                const uint32_t cMask = uint32_t((uint64_t(1) << width) - 1);
+                for (size_t i = 0; i < values.size(); ++i)
+                    REQUIRE(decoded[i] == (values[i] & cMask));
+            }
+        }
+    }
+
+    GIVEN("Arrays that don't fit")
+    {
+        const uint32_t cValues[4] = { 1, 2, 3, 4 };
+        uint32_t decoded[4] = {};
+
+        Buffer buffer(1);
+        Buffer::Writer writer(&buffer);
+        REQUIRE(writer.WriteBitsArray(cValues, 4, 3) == false);
+        REQUIRE(writer.GetBitPosition() == 0);
+        REQUIRE(writer.WriteBitsArray(cValues, 1, 33) == false);
+
+        Buffer::Reader reader(&buffer);
+        REQUIRE(reader.ReadBitsArray(decoded, 4, 3) == false);
+        REQUIRE(reader.GetBitPosition() == 0);
+    }
+}
+
+TEST_CASE("Bit stream benchmarks", "[.benchmark][core.buffer.bits]")
+{
+    // Header sized fields, the common case for protocol headers
+    constexpr size_t cFieldCount = 4096;
+    const size_t cWidths[] = { 6, 3, 11, 1, 16, 5 };
+
+    Buffer buffer(cFieldCount * 2);
+    uint64_t sum = 0;
+
+    BENCHMARK("Legacy WriteBits")
+    {
+        size_t bitPosition = 0;
+        for (size_t i = 0; i < cFieldCount; ++i)
+            Legacy::WriteBits(buffer, bitPosition, i, cWidths[i % 6]);
+    }
+
+    BENCHMARK("WriteBits")
+    {
+        Buffer::Writer writer(&buffer);
+        for (size_t i = 0; i < cFieldCount; ++i)
+            writer.WriteBits(i, cWidths[i % 6]);
+    }
+
+    BENCHMARK("Buffered WriteBits")
+    {
+        Buffer::Writer writer(&buffer, false, Buffer::Writer::kBuffered);
+        for (size_t i = 0; i < cFieldCount; ++i)
+            writer.WriteBits(i, cWidths[i % 6]);
+    }
+
+    BENCHMARK("Legacy ReadBits")
+    {
+        size_t bitPosition = 0;
+        uint64_t value = 0;
+        for (size_t i = 0; i < cFieldCount; ++i)
+        {
+            Legacy::ReadBits(buffer, bitPosition, value, cWidths[i % 6]);
+            sum += value;
+        }
+    }
+
+    BENCHMARK("ReadBits")
+    {
+        Buffer::Reader reader(&buffer);
+        uint64_t value = 0;
+        for (size_t i = 0; i < cFieldCount; ++i)
+        {
+            reader.ReadBits(value, cWidths[i % 6]);
+            sum += value;
+        }
+    }
+
+
+    // Entity ids, the same width for the whole array
+    constexpr size_t cIdWidth = 20;
+    std::vector<uint32_t> ids(cFieldCount);
+    for (size_t i = 0; i < cFieldCount; ++i)
+        ids[i] = uint32_t(i * 2654435761u);
+
+    Buffer idBuffer(cFieldCount * cIdWidth / 8);
+
+    BENCHMARK("WriteBits ids")
+    {
+        Buffer::Writer writer(&idBuffer, false, Buffer::Writer::kBuffered);
+        for (uint32_t id : ids)
+            writer.WriteBits(id, cIdWidth);
+    }
+
+    BENCHMARK("WriteBitsArray ids")
+    {
+        Buffer::Writer writer(&idBuffer);
+        writer.WriteBitsArray(ids.data(), ids.size(), cIdWidth);
+    }
+
+    BENCHMARK("ReadBits ids")
+    {
+        Buffer::Reader reader(&idBuffer);
+        uint64_t value = 0;
+        for (size_t i = 0; i < cFieldCount; ++i)
+        {
+            reader.ReadBits(value, cIdWidth);
+            sum += value;
+        }
+    }
+
+    BENCHMARK("ReadBitsArray ids")
+    {
+        Buffer::Reader reader(&idBuffer);
+        reader.ReadBitsArray(ids.data(), ids.size(), cIdWidth);
+        sum += ids[cFieldCount - 1];
+    }
+
+    REQUIRE(sum != 0);
+}
+
+TEST_CASE("Schemas", "[core.serialization]")
+{
+    struct Sample
+    {
+        char Tag[2];
+        uint64_t Kind;
+        int32_t Cell;
+        float Height;
+    };
+
+    using SampleSchema = Serialization::Schema<
+        Serialization::Field<&Sample::Tag, Serialization::Bytes<2>>,
+        Serialization::Field<&Sample::Kind, Serialization::Bits<3>>,
+        Serialization::Field<&Sample::Cell, Serialization::Range<-512, 511>>,
+        Serialization::Field<&Sample::Height, Serialization::Quantized<-100, 100, 12>>>;
+
+    static_assert(SampleSchema::BitCount == 16 + 3 + 10 + 12);
+    static_assert(SampleSchema::ByteCount == 6);
+
+    GIVEN("A schema that fits in a word")
+    {
+        Buffer buffer(SampleSchema::ByteCount);
+        const Sample cSample{ { 'M', 'G' }, 5, -300, 42.5f };
+
+        {
+            Buffer::Writer writer(&buffer);
+            REQUIRE(SampleSchema::Write(writer, cSample));
+            REQUIRE(writer.GetBitPosition() == SampleSchema::BitCount);
+        }
+
+        // Byte fields keep their order on the wire
+        REQUIRE(buffer.GetData()[0] == 'M');
+        REQUIRE(buffer.GetData()[1] == 'G');
+
+        Sample sample{};
+        Buffer::Reader reader(&buffer);
+        REQUIRE(SampleSchema::Read(reader, sample));
+        REQUIRE(sample.Tag[0] == 'M');
+        REQUIRE(sample.Tag[1] == 'G');
+        REQUIRE(sample.Kind == 5);
+        REQUIRE(sample.Cell == -300);
+        REQUIRE(std::abs(sample.Height - 42.5f) <= 200.f / 4095.f);
+
+        WHEN("The buffer is too small")
+        {
+            Buffer small(SampleSchema::ByteCount - 1);
+            Buffer::Writer writer(&small);
+            REQUIRE(SampleSchema::Write(writer, cSample) == false);
+
+            Buffer::Reader smallReader(&small);
+            REQUIRE(SampleSchema::Read(smallReader, sample) == false);
+        }
+    }
+
+    GIVEN("Values out of range")
+    {
+        Buffer buffer(SampleSchema::ByteCount);
+        const Sample cSample{ { 'a', 'b' }, 9, 4000, -1000.f };
+
+        {
+            Buffer::Writer writer(&buffer);
+            REQUIRE(SampleSchema::Write(writer, cSample));
+        }
+
+        Sample sample{};
+        Buffer::Reader reader(&buffer);
+        REQUIRE(SampleSchema::Read(reader, sample));
+        REQUIRE(sample.Kind == 1);
+        REQUIRE(sample.Cell == 511);
+        REQUIRE(sample.Height == -100.f);
+    }
+
+    GIVEN("Wide quantized fields followed by another field")
+    {
+        struct Wide
+        {
+            float Height;
+            uint32_t Flags;
+        };
+
+        using WideSchema = Serialization::Schema<
+            Serialization::Field<&Wide::Height, Serialization::Quantized<0, 1, 28>>,
+            Serialization::Field<&Wide::Flags, Serialization::Bits<4>>>;
+
+        // The maximum used to round past 28 bits and set a bit of the next field
+        for (const Wide& acWide : { Wide{ 1.f, 0 }, Wide{ 0.f, 15 }, Wide{ 1.f, 9 } })
+        {
+            Buffer buffer(WideSchema::ByteCount);
+            {
+                Buffer::Writer writer(&buffer);
+                REQUIRE(WideSchema::Write(writer, acWide));
+            }
+
+            Wide wide{};
+            Buffer::Reader reader(&buffer);
+            REQUIRE(WideSchema::Read(reader, wide));
+            REQUIRE(wide.Height == acWide.Height);
+            REQUIRE(wide.Flags == acWide.Flags);
+        }
+    }
+
+    GIVEN("A schema larger than a word")
+    {
+        struct Large
+        {
+            uint64_t First;
+            uint64_t Second;
+            char Name[12];
+        };
+
+        using LargeSchema = Serialization::Schema<
+            Serialization::Field<&Large::First, Serialization::Bits<40>>,
+            Serialization::Field<&Large::Second, Serialization::Bits<64>>,
+            Serialization::Field<&Large::Name, Serialization::Bytes<12>>>;
+
+        static_assert(LargeSchema::BitCount == 200);
+
+        Buffer buffer(LargeSchema::ByteCount);
+        const Large cLarge{ 0xFFFFFFFFFF, 0x0123456789ABCDEF, "schemas" };
+
+        {
+            Buffer::Writer writer(&buffer);
+            REQUIRE(LargeSchema::Write(writer, cLarge));
+        }
+
+        Large large{};
+        Buffer::Reader reader(&buffer);
+        REQUIRE(LargeSchema::Read(reader, large));
+        REQUIRE(large.First == cLarge.First);
+        REQUIRE(large.Second == cLarge.Second);
+        REQUIRE(std::strcmp(large.Name, "schemas") == 0);
+    }
+}
+
+TEST_CASE("Compact encodings", "[core.buffer.encodings]")
+{
+    GIVEN("Varints")
+    {
+        const uint64_t cValues[] = { 0, 1, 127, 128, 300, 16383, 16384, uint64_t(1) << 35, UINT64_MAX };
+        const size_t cSizes[] = { 1, 1, 1, 2, 2, 2, 3, 6, 10 };
+
+        Buffer buffer(64);
+        {
+            Buffer::Writer writer(&buffer);
+            for (size_t i = 0; i < std::size(cValues); ++i)
+            {
+                const size_t cStart = writer.GetBitPosition();
+                REQUIRE(writer.WriteVarint(cValues[i]));
+                REQUIRE(writer.GetBitPosition() - cStart == cSizes[i] * 8);
+            }
+        }
+
+        // Standard LEB128 on the wire
+        REQUIRE(buffer[3] == 0x80);
+        REQUIRE(buffer[4] == 0x01);
+
+        Buffer::Reader reader(&buffer);
+        for (uint64_t expected : cValues)
+        {
+            uint64_t value = 0;
+            REQUIRE(reader.ReadVarint(value));
+            REQUIRE(value == expected);
+        }
+
+        WHEN("The varint is truncated")
+        {
+            Buffer::Reader truncated(buffer.GetData(), 4);
+            truncated.Advance(3);
+
+            uint64_t value = 0;
+            REQUIRE(truncated.ReadVarint(value) == false);
+            REQUIRE(truncated.GetBytePosition() == 3);
+        }
+
+        WHEN("The varint is not byte aligned")
+        {
+            Buffer unaligned(16);
+            {
+                Buffer::Writer writer(&unaligned);
+                writer.WriteBits(1, 3);
+                REQUIRE(writer.WriteVarint(uint64_t(1) << 62));
+            }
+
+            Buffer::Reader unalignedReader(&unaligned);
+            uint64_t value = 0;
+            unalignedReader.ReadBits(value, 3);
+            REQUIRE(unalignedReader.ReadVarint(value));
+            REQUIRE(value == uint64_t(1) << 62);
+        }
+    }
+
+    GIVEN("Signed varints")
+    {
+        const int64_t cValues[] = { 0, -1, 1, -64, 63, -65, INT64_MIN, INT64_MAX };
+
+        Buffer buffer(64);
+        {
+            Buffer::Writer writer(&buffer);
+            for (int64_t value : cValues)
+                REQUIRE(writer.WriteSignedVarint(value));
+        }
+
+        // Small magnitudes take a single byte whatever their sign
+        REQUIRE(buffer[1] == 0x01);
+        REQUIRE(buffer[3] == 0x7F);
+
+        Buffer::Reader reader(&buffer);
+        for (int64_t expected : cValues)
+        {
+            int64_t value = 0;
+            REQUIRE(reader.ReadSignedVarint(value));
+            REQUIRE(value == expected);
+        }
+    }
+
+    GIVEN("Bounded integers")
+    {
+        Buffer buffer(16);
+        {
+            Buffer::Writer writer(&buffer);
+            REQUIRE(writer.WriteRange(-3, -10, 10));
+            REQUIRE(writer.GetBitPosition() == 5);
+            REQUIRE(writer.WriteRange(1000, 0, 255));
+            REQUIRE(writer.WriteRange(7, 7, 7));
+            REQUIRE(writer.WriteRange(INT64_MIN, INT64_MIN, INT64_MAX));
+            REQUIRE(writer.GetBitPosition() == 5 + 8 + 0 + 64);
+        }
+
+        Buffer::Reader reader(&buffer);
+        int64_t value = 0;
+        REQUIRE(reader.ReadRange(value, -10, 10));
+        REQUIRE(value == -3);
+        REQUIRE(reader.ReadRange(value, 0, 255));
+        REQUIRE(value == 255);
+        REQUIRE(reader.ReadRange(value, 7, 7));
+        REQUIRE(value == 7);
+        REQUIRE(reader.ReadRange(value, INT64_MIN, INT64_MAX));
+        REQUIRE(value == INT64_MIN);
+    }
+
+    GIVEN("Quantized floats and vectors")
+    {
+        const float cStep = 2000.f / 65535.f;
+        const float cPosition[3] = { -512.25f, 0.f, 999.9f };
+
+        Buffer buffer((20 + 48 + 96 + 7) / 8);
+        {
+            Buffer::Writer writer(&buffer);
+            REQUIRE(writer.WriteQuantized(0.3f, 0.f, 1.f, 10));
+            REQUIRE(writer.WriteQuantized(5.f, 0.f, 1.f, 10));
+            REQUIRE(writer.WriteVector(cPosition, -1000.f, 1000.f, 16));
+            REQUIRE(writer.WriteVector(cPosition, -1000.f, 1000.f, 32));
+            REQUIRE(writer.GetBitPosition() == 20 + 48 + 96);
+        }
+
+        Buffer::Reader reader(&buffer);
+        float value = 0.f;
+        REQUIRE(reader.ReadQuantized(value, 0.f, 1.f, 10));
+        REQUIRE(std::abs(value - 0.3f) <= 0.5f / 1023.f);
+        REQUIRE(reader.ReadQuantized(value, 0.f, 1.f, 10));
+        REQUIRE(value == 1.f);
+
+        float position[3];
+        REQUIRE(reader.ReadVector(position, -1000.f, 1000.f, 16));
+        for (size_t i = 0; i < 3; ++i)
+            REQUIRE(std::abs(position[i] - cPosition[i]) <= cStep);
+
+        REQUIRE(reader.ReadVector(position, -1000.f, 1000.f, 32));
+        for (size_t i = 0; i < 3; ++i)
+            REQUIRE(std::abs(position[i] - cPosition[i]) <= 0.001f);
+
+        REQUIRE(reader.ReadVector(position, -1000.f, 1000.f, 16) == false);
+    }
+
+    GIVEN("The ends of the range on wide quantizations")
+    {
+        const float cCorner[3] = { 1000.f, -1000.f, 1000.f };
+
+        for (const size_t cBitCount : { size_t(24), size_t(32) })
+        {
+            Buffer buffer(32);
+            {
+                Buffer::Writer writer(&buffer);
+                REQUIRE(writer.WriteQuantized(1.f, 0.f, 1.f, cBitCount));
+                REQUIRE(writer.WriteQuantized(0.f, 0.f, 1.f, cBitCount));
+                REQUIRE(writer.WriteVector(cCorner, -1000.f, 1000.f, cBitCount));
+            }
+
+            // The maximum used to round to 2^N and be masked to 0, or to spill into the next component
+            Buffer::Reader reader(&buffer);
+            float value = 0.5f;
+            REQUIRE(reader.ReadQuantized(value, 0.f, 1.f, cBitCount));
+            REQUIRE(value == 1.f);
+            REQUIRE(reader.ReadQuantized(value, 0.f, 1.f, cBitCount));
+            REQUIRE(value == 0.f);
+
+            float corner[3];
+            REQUIRE(reader.ReadVector(corner, -1000.f, 1000.f, cBitCount));
+            for (size_t i = 0; i < 3; ++i)
+                REQUIRE(corner[i] == cCorner[i]);
+        }
+    }
+
+    GIVEN("Quaternions")
+    {
+        std::mt19937 generator(7);
+        std::normal_distribution<float> distribution;
+
+        Buffer buffer(8);
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            float quaternion[4];
+            float norm = 0.f;
+            for (float& component : quaternion)
+            {
+                component = distribution(generator);
+                norm += component * component;
+            }
+
+            for (float& component : quaternion)
+                component /= std::sqrt(norm);
+
+            {
+                Buffer::Writer writer(&buffer);
+                REQUIRE(writer.WriteQuaternion(quaternion, 12));
+                REQUIRE(writer.GetBitPosition() == 2 + 3 * 12);
+            }
+
+            float decoded[4];
+            Buffer::Reader reader(&buffer);
+            REQUIRE(reader.ReadQuaternion(decoded, 12));
+
+            // q and -q are the same rotation, compare with the dot product
+            float dot = 0.f;
+            for (size_t j = 0; j < 4; ++j)
+                dot += quaternion[j] * decoded[j];
+
+            REQUIRE(std::abs(dot) >= 0.9999f);
+        }
+    }
 }
\ No newline at end of file
@@ -5,9 +5,18 @@
 #include "Server.h"
 #include "Selector.h"
 #include "Client.h"
+#include "StandardAllocator.h"
+#include "TrackAllocator.h"
+#include "AdmissionControl.h"
+#include "InterestGrid.h"
 
 #include <cstring>
 #include <thread>
+#include <chrono>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <set>
 
 
 TEST_CASE("Endpoint", "[network.endpoint]")
@@ -261,6 +270,38 @@ TEST_CASE("Networking", "[network]")
         REQUIRE(std::memcmp(data.Payload.GetData(), buffer.GetData(), buffer.GetSize()) == 0);
         REQUIRE(data.Remote.IsIPv6());
     }
+    GIVEN("A chain sent over sockets")
+    {
+        static const std::string header = "head";
+        static const std::string payload = "payload";
+
+        Socket client(Endpoint::kIPv4), server(Endpoint::kIPv4);
+        REQUIRE(client.Bind());
+        REQUIRE(server.Bind());
+
+        Selector serverSelector(server);
+
+        Resolver localhostResolver("127.0.0.1");
+        Endpoint serverEndpoint = localhostResolver[0];
+        serverEndpoint.SetPort(server.GetPort());
+
+        BufferChain chain;
+        chain.Append(BufferView((const uint8_t*)payload.data(), payload.size()));
+        chain.Prepend(BufferView((const uint8_t*)header.data(), header.size()));
+
+        REQUIRE(client.Send(serverEndpoint, chain));
+        REQUIRE(serverSelector.IsReady());
+
+        // The segments arrive as a single datagram
+        auto result = server.Receive();
+        REQUIRE(result.HasError() == false);
+        REQUIRE(result.GetResult().Payload.GetSize() == header.size() + payload.size());
+        REQUIRE(std::memcmp(result.GetResult().Payload.GetData(), "headpayload", header.size() + payload.size()) == 0);
+
+        // Wrong address family
+        Resolver ipv6Resolver("[::1]");
+        REQUIRE(client.Send(ipv6Resolver[0], chain) == false);
+    }
 }
 
 TEST_CASE("Connection", "[network.connection]")
@@ -276,10 +317,11 @@ TEST_CASE("Connection", "[network.connection]")
 
         struct DummyCommunication : Connection::ICommunication
         {
-            bool Send(const Endpoint& acRemote, Buffer aBuffer) override
+            bool Send(const Endpoint& acRemote, const BufferView& acBuffer) override
             {
                 REQUIRE(acRemote == remoteEndpoint);
-                buffer = aBuffer;
+                buffer = Buffer(acBuffer.GetSize());
+                std::copy(acBuffer.GetData(), acBuffer.GetData() + acBuffer.GetSize(), buffer.GetWriteData());
                 ++s_count;
                 return true;
             }
@@ -320,6 +362,585 @@ TEST_CASE("Connection", "[network.connection]")
         REQUIRE(clientConnection.ProcessPacket(reader).GetError() == Connection::HeaderErrors::kDeadConnection);
         REQUIRE(clientConnection.GetState() == Connection::kNone);
     }
+
+    GIVEN("A connection moving to another address")
+    {
+        static Buffer s_packet;
+        static Endpoint s_destination;
+        Resolver localhostResolver("127.0.0.1");
+
+        struct CapturingCommunication : Connection::ICommunication
+        {
+            bool Send(const Endpoint& acRemote, const BufferView& acBuffer) override
+            {
+                s_destination = acRemote;
+                s_packet = Buffer(acBuffer.GetSize());
+                std::copy(acBuffer.GetData(), acBuffer.GetData() + acBuffer.GetSize(), s_packet.GetWriteData());
+                return true;
+            }
+        };
+
+        CapturingCommunication comm;
+
+        Endpoint serverEndpoint = localhostResolver[0];
+        serverEndpoint.SetPort(12345);
+        Endpoint clientEndpoint = localhostResolver[0];
+        clientEndpoint.SetPort(23456);
+        Endpoint reboundEndpoint = localhostResolver[0];
+        reboundEndpoint.SetPort(34567);
+
+        Connection clientConnection(comm, serverEndpoint);
+        Connection serverConnection(comm, clientEndpoint, true);
+        serverConnection.SetId(42);
+
+        clientConnection.Update(1);
+        Buffer::Reader reader(&s_packet);
+        REQUIRE(serverConnection.ProcessPacket(reader).GetResult() == Connection::Header::kNegotiation);
+        serverConnection.Update(1);
+        reader = Buffer::Reader(&s_packet);
+        REQUIRE(clientConnection.ProcessPacket(reader).GetResult() == Connection::Header::kNegotiation);
+        reader = Buffer::Reader(&s_packet);
+        REQUIRE(serverConnection.ProcessPacket(reader).GetResult() == Connection::Header::kConnection);
+
+        // The id came with the server's negotiation
+        REQUIRE(clientConnection.GetId() == 42);
+
+        serverConnection.RequestRebind(reboundEndpoint);
+        REQUIRE(s_destination == reboundEndpoint);
+        REQUIRE(serverConnection.GetRebindEndpoint() == reboundEndpoint);
+
+        reader = Buffer::Reader(&s_packet);
+        auto header = Connection::ReadHeader(reader);
+        REQUIRE(header.GetResult().Type == Connection::Header::kRebind);
+        REQUIRE(header.GetResult().ConnectionId == 42);
+
+        reader = Buffer::Reader(&s_packet);
+        REQUIRE(clientConnection.ProcessPacket(reader).GetResult() == Connection::Header::kRebind);
+        REQUIRE(s_destination == serverEndpoint);
+
+        WHEN("Challenges are requested faster than the resend interval")
+        {
+            REQUIRE(serverConnection.CanRequestRebind() == false);
+            REQUIRE(serverConnection.RequestRebind(reboundEndpoint) == false);
+            REQUIRE(s_destination == serverEndpoint);
+
+            serverConnection.AddElapsedTime(Connection::NegotiationResendInterval);
+            REQUIRE(serverConnection.RequestRebind(reboundEndpoint));
+            REQUIRE(s_destination == reboundEndpoint);
+        }
+
+        WHEN("The answer is right")
+        {
+            reader = Buffer::Reader(&s_packet);
+            REQUIRE(serverConnection.ProcessPacket(reader).GetResult() == Connection::Header::kRebind);
+
+            serverConnection.SetRemoteEndpoint(reboundEndpoint);
+            REQUIRE(serverConnection.GetRemoteEndpoint() == reboundEndpoint);
+            REQUIRE(serverConnection.GetRebindEndpoint().IsValid() == false);
+            REQUIRE(serverConnection.IsConnected());
+        }
+
+        WHEN("The answer is wrong")
+        {
+            s_packet.GetWriteData()[s_packet.GetSize() - 4] ^= 1;
+            s_packet.GetWriteData()[s_packet.GetSize() - 5] ^= 1;
+
+            reader = Buffer::Reader(&s_packet);
+            REQUIRE(serverConnection.ProcessPacket(reader).GetError() == Connection::kBadChallenge);
+            REQUIRE(serverConnection.IsConnected());
+        }
+
+        WHEN("The id is wrong")
+        {
+            serverConnection.SetId(43);
+
+            reader = Buffer::Reader(&s_packet);
+            REQUIRE(serverConnection.ProcessPacket(reader).GetError() == Connection::kUnknownChannel);
+        }
+    }
+
+    GIVEN("Connection timers")
+    {
+        static uint32_t s_sent{ 0 };
+        Resolver localhostResolver("127.0.0.1");
+
+        struct CountingCommunication : Connection::ICommunication
+        {
+            bool Send(const Endpoint& acRemote, const BufferView& acBuffer) override
+            {
+                ++s_sent;
+                return true;
+            }
+        };
+
+        CountingCommunication comm;
+        Connection connection(comm, localhostResolver[0]);
+
+        // The first negotiation goes out right away, then on its own interval rather than on every update
+        REQUIRE(connection.GetTimeUntilNextEvent() == 0);
+        REQUIRE(connection.Update(1) == Connection::kNegociating);
+        REQUIRE(s_sent == 1);
+        REQUIRE(connection.GetTimeUntilNextEvent() == Connection::NegotiationResendInterval);
+
+        REQUIRE(connection.Update(Connection::NegotiationResendInterval - 1) == Connection::kNegociating);
+        REQUIRE(s_sent == 1);
+        REQUIRE(connection.GetTimeUntilNextEvent() == 1);
+        REQUIRE(connection.Update(1) == Connection::kNegociating);
+        REQUIRE(s_sent == 2);
+
+        // Close to the timeout, it comes before the next resend
+        connection.AddElapsedTime(Connection::Timeout - Connection::NegotiationResendInterval - 50);
+        REQUIRE(connection.Update(0) == Connection::kNegociating);
+        REQUIRE(s_sent == 3);
+        REQUIRE(connection.GetTimeUntilNextEvent() == 50);
+        REQUIRE(connection.Update(49) == Connection::kNegociating);
+        REQUIRE(connection.Update(1) == Connection::kNone);
+        REQUIRE(connection.GetTimeUntilNextEvent() == 0);
+    }
+}
+
+TEST_CASE("Connection manager", "[network.connection.manager]")
+{
+    struct NullCommunication : Connection::ICommunication
+    {
+        bool Send(const Endpoint& acRemote, const BufferView& acBuffer) override
+        {
+            return true;
+        }
+    };
+
+    static NullCommunication comm;
+
+    GIVEN("A full manager")
+    {
+        constexpr size_t cCount = 1000;
+
+        Resolver ipv4Resolver("127.0.0.1");
+        Resolver ipv6Resolver("[::1]");
+
+        std::vector<Endpoint> endpoints;
+        for (size_t i = 0; i < cCount; ++i)
+        {
+            Endpoint endpoint = (i % 2) ? ipv4Resolver[0] : ipv6Resolver[0];
+            endpoint.SetPort(uint16_t(1000 + i / 2));
+            endpoints.push_back(endpoint);
+        }
+
+        ConnectionManager manager(cCount);
+        for (auto& endpoint : endpoints)
+            REQUIRE(manager.Add(Connection(comm, endpoint, true)));
+
+        REQUIRE(manager.IsFull());
+        REQUIRE(manager.GetCount() == cCount);
+        REQUIRE(manager.Add(Connection(comm, endpoints[0], true)) == false);
+
+        for (auto& endpoint : endpoints)
+        {
+            REQUIRE(manager.Find(endpoint) != nullptr);
+            REQUIRE(manager.Find(endpoint)->GetRemoteEndpoint() == endpoint);
+        }
+
+        Endpoint unknown = ipv4Resolver[0];
+        unknown.SetPort(999);
+        REQUIRE(manager.Find(unknown) == nullptr);
+
+        WHEN("Some connections are dropped")
+        {
+            for (size_t i = 0; i < cCount; i += 3)
+                manager.Find(endpoints[i])->Disconnect();
+
+            size_t disconnected = 0;
+            manager.Update(1, [&disconnected](const Endpoint&) { ++disconnected; return true; });
+
+            REQUIRE(disconnected == (cCount + 2) / 3);
+            REQUIRE(manager.GetCount() == cCount - disconnected);
+
+            // Entries that collided with the removed ones must still be reachable
+            for (size_t i = 0; i < cCount; ++i)
+                REQUIRE((manager.Find(endpoints[i]) == nullptr) == (i % 3 == 0));
+
+            for (size_t i = 0; i < cCount; i += 3)
+                REQUIRE(manager.Add(Connection(comm, endpoints[i], true)));
+
+            REQUIRE(manager.IsFull());
+        }
+
+        WHEN("Every connection times out")
+        {
+            manager.Update(20 * 1000);
+
+            REQUIRE(manager.GetCount() == 0);
+            REQUIRE(manager.Find(endpoints[0]) == nullptr);
+        }
+
+        WHEN("Connections are found by id")
+        {
+            for (auto& endpoint : endpoints)
+            {
+                Connection* pConnection = manager.Find(endpoint);
+                REQUIRE(pConnection->GetId() != Connection::cInvalidId);
+                REQUIRE(manager.Get(pConnection->GetId()) == pConnection);
+            }
+
+            REQUIRE(manager.Get(Connection::cInvalidId) == nullptr);
+            REQUIRE(manager.Get(ConnectionManager::MaxConnections - 1) == nullptr);
+
+            // The id of a removed connection doesn't reach the one reusing its slot
+            const Connection::Id cOldId = manager.Find(endpoints[0])->GetId();
+            manager.Find(endpoints[0])->Disconnect();
+            manager.Update(1);
+            REQUIRE(manager.Get(cOldId) == nullptr);
+
+            REQUIRE(manager.Add(Connection(comm, endpoints[0], true)));
+            REQUIRE(manager.Find(endpoints[0])->GetId() != cOldId);
+            REQUIRE(manager.Get(manager.Find(endpoints[0])->GetId()) == manager.Find(endpoints[0]));
+        }
+
+        WHEN("A connection moves to another endpoint")
+        {
+            Connection* pConnection = manager.Find(endpoints[10]);
+
+            REQUIRE(manager.Rebind(*pConnection, endpoints[11]) == false);
+            REQUIRE(manager.Rebind(*pConnection, unknown));
+
+            REQUIRE(manager.Find(endpoints[10]) == nullptr);
+            REQUIRE(manager.Find(unknown) == pConnection);
+            REQUIRE(manager.Get(pConnection->GetId()) == pConnection);
+
+            for (size_t i = 0; i < cCount; ++i)
+                REQUIRE((manager.Find(endpoints[i]) != nullptr) == (i != 10));
+        }
+    }
+}
+
+TEST_CASE("Connection manager benchmarks", "[.benchmark][network.connection.manager]")
+{
+    struct NullCommunication : Connection::ICommunication
+    {
+        bool Send(const Endpoint& acRemote, const BufferView& acBuffer) override
+        {
+            return true;
+        }
+    };
+
+    static NullCommunication comm;
+
+    constexpr size_t cCount = 10000;
+
+    Resolver resolver("[::1]");
+    std::vector<Endpoint> endpoints;
+    for (size_t i = 0; i < cCount; ++i)
+    {
+        Endpoint endpoint = resolver[0];
+        endpoint.GetIPv6()[7] = uint16_t(i);
+        endpoint.SetPort(uint16_t(40000 + i % 7));
+        endpoints.push_back(endpoint);
+    }
+
+    ConnectionManager manager(cCount);
+    std::unordered_map<Endpoint, uint32_t> reference;
+    for (size_t i = 0; i < cCount; ++i)
+    {
+        manager.Add(Connection(comm, endpoints[i], true));
+        reference[endpoints[i]] = uint32_t(i);
+    }
+
+    // Lookups in a random order, like packets from many clients
+    std::shuffle(endpoints.begin(), endpoints.end(), std::mt19937(42));
+
+    size_t found = 0;
+
+    BENCHMARK("unordered_map Find 10k")
+    {
+        for (auto& endpoint : endpoints)
+            found += reference.count(endpoint);
+    }
+
+    BENCHMARK("ConnectionManager Find 10k")
+    {
+        for (auto& endpoint : endpoints)
+            found += manager.Find(endpoint) != nullptr;
+    }
+
+    REQUIRE(found != 0);
+}
+
+TEST_CASE("Connection footprint benchmarks", "[.benchmark][network.connection.manager]")
+{
+    // Keeps the last packet so it can be handed to the other side
+    static Buffer s_packet;
+
+    struct LoopbackCommunication : Connection::ICommunication
+    {
+        bool Send(const Endpoint& acRemote, const BufferView& acBuffer) override
+        {
+            // Outlives the tracker of each round
+            ScopedAllocator _(Allocator::GetDefault());
+            s_packet = Buffer(acBuffer.GetSize());
+            std::copy(acBuffer.GetData(), acBuffer.GetData() + acBuffer.GetSize(), s_packet.GetWriteData());
+            return true;
+        }
+    };
+
+    static LoopbackCommunication comm;
+
+    Resolver resolver("[::1]");
+
+    // Every connection goes through a real handshake, this takes a while with the full key exchange
+    for (size_t count : { 1000, 10000, 100000 })
+    {
+        TrackAllocator<StandardAllocator> tracker;
+        ConnectionManager* pManager = nullptr;
+        {
+            ScopedAllocator _(&tracker);
+            pManager = New<ConnectionManager>(count);
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            Endpoint endpoint = resolver[0];
+            endpoint.GetIPv6()[6] = uint16_t(i >> 16);
+            endpoint.GetIPv6()[7] = uint16_t(i);
+            endpoint.SetPort(40000);
+
+            Connection client(comm, endpoint);
+            client.Update(0);
+
+            // Only what the server keeps is tracked, the client is gone at the end of the iteration
+            ScopedAllocator _(&tracker);
+
+            REQUIRE(pManager->Add(Connection(comm, endpoint, true)));
+            Connection* pServer = pManager->Find(endpoint);
+
+            Buffer::Reader reader(&s_packet);
+            pServer->ProcessPacket(reader);
+            pServer->Update(0);
+
+            reader = Buffer::Reader(&s_packet);
+            client.ProcessPacket(reader);
+
+            reader = Buffer::Reader(&s_packet);
+            pServer->ProcessPacket(reader);
+            REQUIRE(pServer->IsConnected());
+        }
+
+        // The first tick updates every new connection once, they are idle from there
+        pManager->Update(1);
+        REQUIRE(pManager->GetCount() == count);
+
+        // Memory allocated by the crypto library itself doesn't go through our allocators
+        WARN(count << " idle connections: " << tracker.GetUsedMemory() / count << " bytes each, Connection is " << sizeof(Connection) << " bytes");
+
+        // Ten seconds, every connection sends a keepalive once and nothing times out
+        BENCHMARK("ConnectionManager Update " + std::to_string(count) + ", 10000 ticks")
+        {
+            for (size_t tick = 0; tick < 10000; ++tick)
+                pManager->Update(1);
+        }
+
+        Delete(pManager);
+    }
+}
+
+TEST_CASE("Admission control", "[network.admission]")
+{
+    AdmissionControl admission;
+    admission.SetSourceRate(2, 4);
+
+    GIVEN("A single source")
+    {
+        Endpoint source(0x0100007F, 1000);
+
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            // Changing ports doesn't make a new source
+            source.SetPort(uint16_t(1000 + i));
+            REQUIRE(admission.Admit(source));
+        }
+
+        REQUIRE(admission.Admit(source) == false);
+        REQUIRE(admission.GetAdmittedCount() == 4);
+        REQUIRE(admission.GetDeniedCount() == 1);
+
+        // Other sources still get in
+        REQUIRE(admission.Admit(Endpoint(0x0200007F, 1000)));
+
+        // Two per second
+        admission.Advance(499);
+        REQUIRE(admission.Admit(source) == false);
+        admission.Advance(1);
+        REQUIRE(admission.Admit(source));
+        REQUIRE(admission.Admit(source) == false);
+
+        // Refills stop at the burst
+        admission.Advance(60000);
+        for (uint32_t i = 0; i < 4; ++i)
+            REQUIRE(admission.Admit(source));
+        REQUIRE(admission.Admit(source) == false);
+    }
+
+    GIVEN("Bursts larger than a bucket holds")
+    {
+        // A burst in thousandths that no longer fits in 32 bits
+        admission.SetSourceRate(1000000, 4294968);
+        admission.SetGlobalRate(1000000, 4294968);
+        admission.Advance(10000);
+
+        const Endpoint cSource(0x0100007F, 1000);
+        for (uint32_t i = 0; i < 10000; ++i)
+            REQUIRE(admission.Admit(cSource));
+    }
+
+    GIVEN("IPv6 sources")
+    {
+        uint16_t address[8] = { 0x20, 0x1, 0xdb8, 0x1, 0, 0, 0, 1 };
+
+        for (uint16_t i = 0; i < 4; ++i)
+        {
+            // The same /64
+            address[7] = i;
+            REQUIRE(admission.Admit(Endpoint(address, 1000)));
+        }
+
+        REQUIRE(admission.Admit(Endpoint(address, 1000)) == false);
+
+        address[3] = 2;
+        REQUIRE(admission.Admit(Endpoint(address, 1000)));
+    }
+
+    GIVEN("Many sources")
+    {
+        admission.SetGlobalRate(100, 100);
+
+        size_t admitted = 0;
+        for (uint32_t i = 0; i < 1000; ++i)
+        {
+            if (admission.Admit(Endpoint(0x0A000000 | i, 1000)))
+                ++admitted;
+        }
+
+        // Every source had tokens left but the global bucket ran out
+        REQUIRE(admitted == 100);
+        REQUIRE(admission.GetDeniedCount() == 900);
+
+        admission.Advance(100);
+        REQUIRE(admission.Admit(Endpoint(0x0B000000, 1000)));
+    }
+}
+
+TEST_CASE("Interest grid", "[network.interest]")
+{
+    Resolver localhostResolver("127.0.0.1");
+    Endpoint first = localhostResolver[0];
+    Endpoint second = localhostResolver[0];
+    first.SetPort(1000);
+    second.SetPort(1001);
+
+    GIVEN("Two observers far apart")
+    {
+        InterestGrid grid(10.f);
+
+        const auto cFirst = grid.AddObserver(first, 0.f, 0.f, 1);
+        const auto cSecond = grid.AddObserver(second, 100.f, 0.f, 1);
+
+        const auto cEntity = grid.AddEntity(5.f, 5.f);
+        const auto cOther = grid.AddEntity(105.f, 5.f);
+
+        REQUIRE(grid.GetEventCount() == 2);
+        REQUIRE(grid.GetEvents()[0].Type == InterestGrid::Event::kEnter);
+        REQUIRE(grid.GetEvents()[0].Observer == cFirst);
+        REQUIRE(grid.GetEvents()[0].Entity == cEntity);
+        REQUIRE(grid.GetEvents()[1].Observer == cSecond);
+        REQUIRE(grid.GetEvents()[1].Entity == cOther);
+        grid.ClearEvents();
+
+        std::vector<Endpoint> remotes;
+        grid.ForEachObserver(cEntity, [&remotes](InterestGrid::ObserverId, const Endpoint& acRemote) { remotes.push_back(acRemote); });
+        REQUIRE(remotes.size() == 1);
+        REQUIRE(remotes[0] == first);
+
+        // Still in view
+        grid.MoveEntity(cEntity, 15.f, -5.f);
+        REQUIRE(grid.GetEventCount() == 0);
+
+        // Out of everyone's view, then into the second observer's
+        grid.MoveEntity(cEntity, 85.f, 5.f);
+        REQUIRE(grid.GetEventCount() == 1);
+        REQUIRE(grid.GetEvents()[0].Type == InterestGrid::Event::kLeave);
+        REQUIRE(grid.GetEvents()[0].Observer == cFirst);
+
+        grid.MoveEntity(cEntity, 95.f, 5.f);
+        REQUIRE(grid.GetEventCount() == 2);
+        REQUIRE(grid.GetEvents()[1].Type == InterestGrid::Event::kEnter);
+        REQUIRE(grid.GetEvents()[1].Observer == cSecond);
+        grid.ClearEvents();
+
+        // The first observer follows
+        grid.MoveObserver(cFirst, 80.f, 0.f);
+        REQUIRE(grid.GetEventCount() == 1);
+        REQUIRE(grid.GetEvents()[0].Type == InterestGrid::Event::kEnter);
+        REQUIRE(grid.GetEvents()[0].Entity == cEntity);
+        grid.ClearEvents();
+
+        size_t relevant = 0;
+        grid.ForEachRelevant(cSecond, [&relevant](InterestGrid::EntityId) { ++relevant; });
+        REQUIRE(relevant == 2);
+
+        grid.RemoveEntity(cOther);
+        REQUIRE(grid.GetEventCount() == 1);
+        REQUIRE(grid.GetEvents()[0].Type == InterestGrid::Event::kLeave);
+        REQUIRE(grid.GetEvents()[0].Observer == cSecond);
+    }
+
+    GIVEN("Random movements")
+    {
+        InterestGrid grid(8.f);
+
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> position(-100.f, 100.f);
+
+        std::vector<InterestGrid::ObserverId> observers;
+        for (uint16_t i = 0; i < 8; ++i)
+        {
+            Endpoint remote = first;
+            remote.SetPort(uint16_t(2000 + i));
+            observers.push_back(grid.AddObserver(remote, position(rng), position(rng), 2));
+        }
+
+        std::vector<InterestGrid::EntityId> entities;
+        for (uint32_t i = 0; i < 200; ++i)
+            entities.push_back(grid.AddEntity(position(rng), position(rng)));
+
+        for (uint32_t step = 0; step < 2000; ++step)
+        {
+            if (step % 10 == 0)
+                grid.MoveObserver(observers[rng() % observers.size()], position(rng), position(rng));
+            else
+                grid.MoveEntity(entities[rng() % entities.size()], position(rng), position(rng));
+        }
+
+        // The events replayed give the same relevant sets as a full scan, seen from both sides
+        std::set<std::pair<InterestGrid::ObserverId, InterestGrid::EntityId>> replayed;
+        for (size_t i = 0; i < grid.GetEventCount(); ++i)
+        {
+            const InterestGrid::Event& cEvent = grid.GetEvents()[i];
+            if (cEvent.Type == InterestGrid::Event::kEnter)
+                REQUIRE(replayed.insert({ cEvent.Observer, cEvent.Entity }).second);
+            else
+                REQUIRE(replayed.erase({ cEvent.Observer, cEvent.Entity }) == 1);
+        }
+
+        std::set<std::pair<InterestGrid::ObserverId, InterestGrid::EntityId>> scanned;
+        for (auto observer : observers)
+            grid.ForEachRelevant(observer, [&](InterestGrid::EntityId aEntity) { scanned.insert({ observer, aEntity }); });
+
+        std::set<std::pair<InterestGrid::ObserverId, InterestGrid::EntityId>> broadcast;
+        for (auto entity : entities)
+            grid.ForEachObserver(entity, [&](InterestGrid::ObserverId aObserver, const Endpoint&) { broadcast.insert({ aObserver, entity }); });
+
+        REQUIRE(replayed == scanned);
+        REQUIRE(replayed == broadcast);
+    }
 }
 
 TEST_CASE("Server", "[network.server]")
@@ -549,4 +1170,249 @@ TEST_CASE("Server", "[network.server]")
             REQUIRE(server.GetNumClients() == 0);
         }
     }
-}
\ No newline at end of file
+}
+TEST_CASE("Threaded server", "[network.server.threaded]")
+{
+    class EchoServer : public Server
+    {
+    public:
+        std::vector<std::string> m_messages;
+        std::thread::id m_callbackThread;
+        size_t m_connected{ 0 };
+        size_t m_disconnected{ 0 };
+
+    protected:
+        bool OnMessageReceived(const Endpoint& acRemoteEndpoint, const Message& acMessage) noexcept override
+        {
+            m_callbackThread = std::this_thread::get_id();
+
+            std::string text(acMessage.GetLen(), '\0');
+            acMessage.GetData().ReadBytes((uint8_t *)text.data(), text.size());
+            m_messages.push_back(text);
+
+            // Queued for the I/O thread, the payload is shared with the received message
+            return SendPayload(acRemoteEndpoint, acMessage.GetView());
+        }
+
+        bool OnClientConnected(const Endpoint& acRemoteEndpoint) noexcept override
+        {
+            m_callbackThread = std::this_thread::get_id();
+            ++m_connected;
+            return true;
+        }
+
+        bool OnClientDisconnected(const Endpoint& acRemoteEndpoint) noexcept override
+        {
+            m_callbackThread = std::this_thread::get_id();
+            ++m_disconnected;
+            return true;
+        }
+    };
+
+    class EchoClient : public Client
+    {
+    public:
+        std::vector<std::string> m_messages;
+        bool m_connected{ false };
+
+        EchoClient(const Endpoint& acRemoteEndpoint)
+            : Client(acRemoteEndpoint)
+        {}
+
+    protected:
+        bool OnMessageReceived(const Endpoint& acRemoteEndpoint, const Message& acMessage) noexcept override
+        {
+            std::string text(acMessage.GetLen(), '\0');
+            acMessage.GetData().ReadBytes((uint8_t *)text.data(), text.size());
+            m_messages.push_back(text);
+            return true;
+        }
+
+        bool OnConnected(const Endpoint& acRemoteEndpoint) noexcept override
+        {
+            m_connected = true;
+            return true;
+        }
+
+        bool OnDisconnected(const Endpoint& acRemoteEndpoint) noexcept override
+        {
+            m_connected = false;
+            return true;
+        }
+    };
+
+    Resolver localhostResolver("127.0.0.1");
+    Endpoint serverEndpoint = localhostResolver[0];
+
+    EchoServer server;
+    REQUIRE(server.Start(0, Server::kThreaded));
+    serverEndpoint.SetPort(server.GetPort());
+
+    EchoClient client(serverEndpoint);
+
+    // The server's I/O thread works on its own, Update only delivers what it got so far
+    auto pump = [&](auto aCondition)
+    {
+        for (size_t i = 0; i < 2000 && !aCondition(); ++i)
+        {
+            client.Update(1);
+            server.Update(1);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return aCondition();
+    };
+
+    REQUIRE(pump([&]() { return client.m_connected && server.m_connected == 1; }));
+
+    // Fragmented, reassembled on the I/O thread
+    const std::string cText(3000, 'x');
+    REQUIRE(client.SendPayload((uint8_t *)cText.data(), cText.size()));
+    REQUIRE(pump([&]() { return client.m_messages.size() == 1; }));
+
+    REQUIRE(server.m_messages == std::vector<std::string>{ cText });
+    REQUIRE(client.m_messages[0] == cText);
+    REQUIRE(server.m_callbackThread == std::this_thread::get_id());
+
+    client.Disconnect();
+    REQUIRE(pump([&]() { return server.m_disconnected == 1; }));
+}
+
+TEST_CASE("Batched delivery", "[network.server.batched]")
+{
+    class BatchServer : public Server
+    {
+    public:
+        size_t m_connected{ 0 };
+
+    protected:
+        // Batched delivery, messages never come through here
+        bool OnMessageReceived(const Endpoint&, const Message&) noexcept override
+        {
+            return false;
+        }
+
+        bool OnClientConnected(const Endpoint& acRemoteEndpoint) noexcept override
+        {
+            ++m_connected;
+            return true;
+        }
+
+        bool OnClientDisconnected(const Endpoint& acRemoteEndpoint) noexcept override
+        {
+            return true;
+        }
+    };
+
+    class BatchClient : public Client
+    {
+    public:
+        bool m_connected{ false };
+
+        BatchClient(const Endpoint& acRemoteEndpoint)
+            : Client(acRemoteEndpoint)
+        {}
+
+    protected:
+        // Batched delivery, messages never come through here
+        bool OnMessageReceived(const Endpoint&, const Message&) noexcept override
+        {
+            return false;
+        }
+
+        bool OnConnected(const Endpoint& acRemoteEndpoint) noexcept override
+        {
+            m_connected = true;
+            return true;
+        }
+
+        bool OnDisconnected(const Endpoint& acRemoteEndpoint) noexcept override
+        {
+            m_connected = false;
+            return true;
+        }
+    };
+
+    Resolver localhostResolver("127.0.0.1");
+    Endpoint serverEndpoint = localhostResolver[0];
+
+    BatchServer server;
+    server.SetBatchedDelivery(true);
+    REQUIRE(server.Start(0));
+    serverEndpoint.SetPort(server.GetPort());
+
+    BatchClient client1(serverEndpoint), client2(serverEndpoint);
+    client1.SetBatchedDelivery(true);
+
+    client1.Update(1);
+    client2.Update(1);
+    server.Update(1);
+    client1.Update(1);
+    client2.Update(1);
+    server.Update(1);
+    REQUIRE(server.m_connected == 2);
+
+    // A small one and a fragmented one from each client
+    const std::string cSmall = "small";
+    const std::string cLarge(3000, 'l');
+    for (BatchClient* pClient : { &client1, &client2 })
+    {
+        REQUIRE(pClient->SendPayload((uint8_t *)cSmall.data(), cSmall.size()));
+        REQUIRE(pClient->SendPayload((uint8_t *)cLarge.data(), cLarge.size()));
+    }
+
+    server.Update(1);
+    REQUIRE(server.GetReceivedMessageCount() == 4);
+
+    ReceivedMessage* pMessages = server.GetReceivedMessages();
+    std::stable_sort(pMessages, pMessages + server.GetReceivedMessageCount(), [](const ReceivedMessage& acLhs, const ReceivedMessage& acRhs)
+    {
+        return acLhs.ConnectionId < acRhs.ConnectionId;
+    });
+
+    for (size_t i = 0; i < 4; ++i)
+    {
+        const ReceivedMessage& cMessage = pMessages[i];
+        const std::string& cExpected = (i % 2) ? cLarge : cSmall;
+
+        REQUIRE(cMessage.ConnectionId != Connection::cInvalidId);
+        REQUIRE(cMessage.Data.GetSize() == cExpected.size());
+        REQUIRE(std::memcmp(cMessage.Data.GetData(), cExpected.data(), cExpected.size()) == 0);
+    }
+
+    REQUIRE(pMessages[0].ConnectionId == pMessages[1].ConnectionId);
+    REQUIRE(pMessages[0].Remote == pMessages[1].Remote);
+    REQUIRE(pMessages[0].ConnectionId != pMessages[2].ConnectionId);
+
+    // The same views are sent back to both clients, the batched one gets them in one go
+    for (size_t i = 0; i < 4; ++i)
+        REQUIRE(server.SendPayload(pMessages[i].Remote, pMessages[i].Data));
+
+    client1.Update(1);
+    REQUIRE(client1.GetReceivedMessageCount() == 2);
+    REQUIRE(client1.GetReceivedMessages()[0].Data.GetSize() == cSmall.size());
+    REQUIRE(client1.GetReceivedMessages()[1].Data.GetSize() == cLarge.size());
+
+    // A batch only lasts until the next update
+    server.Update(1);
+    REQUIRE(server.GetReceivedMessageCount() == 0);
+
+    // Packets arriving while waiting for a scheduled tick are processed early and delivered with it
+    REQUIRE(client1.SendPayload((uint8_t *)cSmall.data(), cSmall.size()));
+
+    TickScheduler scheduler(100);
+    uint64_t elapsed = 0;
+    size_t received = 0;
+    uint32_t ticks = 0;
+    while (ticks == 0)
+    {
+        ticks = server.Run(scheduler, [&](uint64_t aElapsedMilliseconds)
+        {
+            elapsed += aElapsedMilliseconds;
+            received += server.GetReceivedMessageCount();
+        });
+    }
+
+    REQUIRE(elapsed == 10 * ticks);
+    REQUIRE(received == 1);
+}
@@ -3,6 +3,8 @@
 #include "DHChachaFilter.h"
 #include "Message.h"
 #include "MessageReceiver.h"
+#include "Snapshot.h"
+#include "JitterBuffer.h"
 #include <cstring>
 #include <algorithm>
 #include <random>
@@ -36,6 +38,20 @@ TEST_CASE("Protocol DHChaCha", "[protocol.dhchacha]")
             REQUIRE(serverFilter.PreConnect(&writerServer) == true);
             // Client reads generated packet
             REQUIRE(clientFilter.ReceiveConnect(&readerServer) == true);
+
+            // Keys are dropped once connected, the agreed cipher keeps working
+            serverFilter.EndHandshake();
+            REQUIRE(serverFilter.IsHandshaking() == false);
+            REQUIRE(clientFilter.IsHandshaking() == true);
+
+            writerServer.Reset();
+            REQUIRE(serverFilter.PreConnect(&writerServer) == false);
+
+            Buffer buffer(data.length());
+            std::memcpy(buffer.GetWriteData(), data.data(), data.length());
+            REQUIRE(serverFilter.PostSend(buffer.GetWriteData(), buffer.GetSize(), 7) == true);
+            REQUIRE(clientFilter.PreReceive(buffer.GetWriteData(), buffer.GetSize(), 7) == true);
+            REQUIRE(std::memcmp(buffer.GetData(), data.data(), data.length()) == 0);
         }
 
         WHEN("Using symmetric encryption")
@@ -141,4 +157,367 @@ TEST_CASE("Message", "[protocol.message]")
         REQUIRE(reader.ReadBytes(completeBuffer.GetWriteData(), data.length()) == true);
         REQUIRE(std::memcmp(completeBuffer.GetData(), data.data(), data.length()) == 0);
     }
-}
\ No newline at end of file
+
+    GIVEN("A message built from a shared payload")
+    {
+        BufferView payload((const uint8_t*)data.data(), data.length());
+
+        {
+            Message first(1, payload);
+            Message second(2, payload);
+
+            // Both messages point to the same bytes
+            REQUIRE(payload.GetUseCount() == 3);
+            REQUIRE(first.IsComplete());
+            REQUIRE(first.GetLen() == data.length());
+
+            Buffer::Reader reader = second.GetData();
+            REQUIRE(reader.GetSize() == data.length());
+
+            Buffer buffer(100);
+            Buffer::Writer writer(&buffer);
+            REQUIRE(first.Write(writer) == data.length());
+            REQUIRE(std::memcmp(buffer.GetData() + Message::HeaderBytes, data.data(), data.length()) == 0);
+        }
+
+        REQUIRE(payload.GetUseCount() == 1);
+    }
+
+    GIVEN("A message written to a chain")
+    {
+        BufferView payload((const uint8_t*)data.data(), data.length());
+        Message senderMessage(24, payload);
+
+        Buffer header(Message::HeaderBytes);
+        BufferChain chain;
+        {
+            Buffer::Writer writer(&header);
+            REQUIRE(senderMessage.Write(writer, chain, Message::HeaderBytes, 4) == 0);
+            REQUIRE(writer.GetBitPosition() == 0);
+            REQUIRE(senderMessage.Write(writer, chain, Message::HeaderBytes + 10, 4) == 10);
+        }
+
+        // The payload is a slice of the message's data
+        REQUIRE(chain.GetSegmentCount() == 1);
+        REQUIRE(chain[0].GetData() == payload.GetData() + 4);
+        REQUIRE(chain[0].GetSize() == 10);
+
+        REQUIRE(chain.Prepend(BufferView(std::move(header))));
+
+        // Same bytes as a contiguous write
+        Buffer reference(Message::HeaderBytes + 10);
+        Buffer::Writer writer(&reference);
+        REQUIRE(senderMessage.Write(writer, 4) == 10);
+        writer.Flush();
+
+        BufferView flat = chain.Flatten();
+        REQUIRE(flat.GetSize() == reference.GetSize());
+        REQUIRE(std::memcmp(flat.GetData(), reference.GetData(), reference.GetSize()) == 0);
+    }
+
+    GIVEN("A receiver with a memory budget")
+    {
+        Message senderMessage(24, (uint8_t *)data.data(), data.length());
+        Buffer buffer(1 + Message::HeaderBytes);
+        Buffer::Writer writer(&buffer);
+        Buffer::Reader reader(&buffer);
+
+        MemoryBudget parentBudget;
+
+        WHEN("The message fits")
+        {
+            {
+                MessageReceiver messageReceiver(data.length(), &parentBudget);
+
+                REQUIRE(senderMessage.Write(writer, 0) == 1);
+                REQUIRE(messageReceiver.ReadMessage(reader).HasError() == false);
+
+                // Pending messages are charged with their full length, to the parent as well
+                REQUIRE(messageReceiver.GetMemoryBudget().GetUsed() == data.length());
+                REQUIRE(parentBudget.GetUsed() == data.length());
+            }
+
+            REQUIRE(parentBudget.GetUsed() == 0);
+            REQUIRE(parentBudget.GetPeak() == data.length());
+        }
+
+        WHEN("The message is too large")
+        {
+            MessageReceiver messageReceiver(data.length() - 1, &parentBudget);
+
+            REQUIRE(senderMessage.Write(writer, 0) == 1);
+            auto messageOutcome = messageReceiver.ReadMessage(reader);
+            REQUIRE(messageOutcome.HasError() == true);
+            REQUIRE(messageOutcome.GetError() == MessageReceiver::kOutOfMemory);
+            REQUIRE(messageReceiver.GetMemoryBudget().GetDeniedCount() == 1);
+            REQUIRE(parentBudget.GetUsed() == 0);
+        }
+
+        WHEN("More than the limit is reassembled over time")
+        {
+            constexpr size_t cLimit = 1 << 20;
+            MessageReceiver messageReceiver(cLimit, &parentBudget);
+
+            std::vector<uint8_t> payload(60000, 0x5A);
+            Buffer fragment(25000 + Message::HeaderBytes);
+
+            // Twice the limit in total, delivered messages don't keep their reservation
+            for (uint32_t seq = 0; seq * payload.size() < 2 * cLimit; ++seq)
+            {
+                Message largeMessage(seq, payload.data(), payload.size());
+
+                size_t offset = 0;
+                bool completed = false;
+                while (offset < payload.size())
+                {
+                    Buffer::Writer fragmentWriter(&fragment);
+                    Buffer::Reader fragmentReader(&fragment);
+
+                    const size_t cWritten = largeMessage.Write(fragmentWriter, offset);
+                    REQUIRE(cWritten > 0);
+                    fragmentWriter.Flush();
+                    offset += cWritten;
+
+                    auto messageOutcome = messageReceiver.ReadMessage(fragmentReader);
+                    REQUIRE(messageOutcome.HasError() == false);
+                    completed = messageOutcome.GetResult().IsComplete();
+                }
+
+                REQUIRE(completed);
+                REQUIRE(messageReceiver.GetMemoryBudget().GetUsed() == 0);
+
+                // A duplicate of the first fragment is recognized, nothing is delivered twice
+                Buffer::Writer fragmentWriter(&fragment);
+                Buffer::Reader fragmentReader(&fragment);
+                largeMessage.Write(fragmentWriter, 0);
+                fragmentWriter.Flush();
+
+                auto messageOutcome = messageReceiver.ReadMessage(fragmentReader);
+                REQUIRE(messageOutcome.HasError() == false);
+                REQUIRE(messageOutcome.GetResult().IsComplete() == false);
+                REQUIRE(messageReceiver.GetMemoryBudget().GetUsed() == 0);
+            }
+
+            REQUIRE(messageReceiver.GetMemoryBudget().GetDeniedCount() == 0);
+        }
+    }
+}
+
+TEST_CASE("Snapshots", "[protocol.snapshot]")
+{
+    SnapshotSender sender;
+    SnapshotReceiver receiver;
+
+    std::mt19937 rng(7);
+    std::vector<uint8_t> state(1000);
+    for (auto& byte : state)
+        byte = uint8_t(rng());
+
+    // Returns the encoded size in bytes
+    auto send = [&sender](Buffer& aPacket, const std::vector<uint8_t>& acState)
+    {
+        Buffer::Writer writer(&aPacket);
+        REQUIRE(sender.Write(writer, acState.data(), acState.size()));
+        writer.Flush();
+        return (writer.GetBitPosition() + 7) / 8;
+    };
+
+    auto receive = [&receiver](Buffer& aPacket, const std::vector<uint8_t>& acExpected)
+    {
+        Buffer::Reader reader(&aPacket);
+        auto result = receiver.Read(reader);
+        REQUIRE(result.HasError() == false);
+        REQUIRE(receiver.GetSize() == acExpected.size());
+        REQUIRE(std::memcmp(receiver.GetData(), acExpected.data(), acExpected.size()) == 0);
+        return result.GetResult();
+    };
+
+    auto ack = [&sender, &receiver]()
+    {
+        Buffer packet(16);
+        Buffer::Writer writer(&packet);
+        REQUIRE(receiver.WriteAck(writer));
+        writer.Flush();
+
+        Buffer::Reader reader(&packet);
+        REQUIRE(sender.ReadAck(reader));
+    };
+
+    Buffer packet(2000);
+
+    // Nothing acknowledged yet, the first one is complete
+    REQUIRE(send(packet, state) > state.size());
+    REQUIRE(receive(packet, state) == 1);
+    ack();
+    REQUIRE(sender.GetAckedSeq() == 1);
+
+    GIVEN("A few changes")
+    {
+        state[10] ^= 0xFF;
+        state[500] ^= 0x01;
+        state[999] ^= 0x80;
+
+        // One bit per unchanged word
+        const size_t cSize = send(packet, state);
+        REQUIRE(cSize < 50);
+        REQUIRE(receive(packet, state) == 2);
+
+        WHEN("Snapshots are lost")
+        {
+            state[20] = 1;
+            send(packet, state);
+
+            // Still against the first snapshot, the receiver never saw the lost one
+            state[30] = 2;
+            send(packet, state);
+            REQUIRE(receive(packet, state) == 4);
+
+            // Late ones are refused
+            Buffer late(2000);
+            send(late, state);
+            state[40] = 3;
+            send(packet, state);
+            REQUIRE(receive(packet, state) == 6);
+
+            Buffer::Reader reader(&late);
+            auto result = receiver.Read(reader);
+            REQUIRE(result.HasError());
+            REQUIRE(result.GetError() == SnapshotReceiver::kOld);
+        }
+
+        WHEN("The size changes")
+        {
+            ack();
+
+            state.resize(1201, 0x55);
+            send(packet, state);
+            receive(packet, state);
+            ack();
+
+            state.resize(3);
+            send(packet, state);
+            receive(packet, state);
+        }
+
+        WHEN("Acks stop")
+        {
+            for (uint32_t i = 0; i < SnapshotSender::HistorySize; ++i)
+                send(packet, state);
+
+            // The acknowledged snapshot is gone from the history
+            REQUIRE(send(packet, state) > state.size());
+            receive(packet, state);
+        }
+    }
+
+    GIVEN("A snapshot against a baseline the receiver doesn't have")
+    {
+        SnapshotReceiver other;
+
+        state[0] = 0;
+        send(packet, state);
+
+        Buffer::Reader reader(&packet);
+        auto result = other.Read(reader);
+        REQUIRE(result.HasError());
+        REQUIRE(result.GetError() == SnapshotReceiver::kNoBaseline);
+    }
+
+    GIVEN("A size the packet can't hold")
+    {
+        Buffer::Writer writer(&packet);
+        REQUIRE(writer.WriteVarint(1));
+        REQUIRE(writer.WriteVarint(0));
+        REQUIRE(writer.WriteVarint(SnapshotReceiver::MaxSnapshotSize));
+        writer.Flush();
+
+        SnapshotReceiver other;
+        Buffer::Reader reader(&packet);
+        auto result = other.Read(reader);
+        REQUIRE(result.HasError());
+        REQUIRE(result.GetError() == SnapshotReceiver::kMalformed);
+    }
+}
+
+TEST_CASE("Jitter buffers", "[protocol.jitter]")
+{
+    constexpr uint64_t cTick = 10 * 1000 * 1000;
+    constexpr uint64_t cLatency = 50 * 1000 * 1000;
+
+    JitterBuffer buffer(cTick);
+
+    uint32_t ticks[16];
+    for (uint32_t i = 0; i < 16; ++i)
+        ticks[i] = i * 100;
+
+    GIVEN("Snapshots arriving on time")
+    {
+        for (uint32_t i = 0; i < 10; ++i)
+            REQUIRE(buffer.Push(i, i * cTick + cLatency, (const uint8_t*)&ticks[i], sizeof(uint32_t)));
+
+        REQUIRE(buffer.Push(4, 4 * cTick + cLatency, (const uint8_t*)&ticks[4], sizeof(uint32_t)) == false);
+        REQUIRE(buffer.GetJitter() == 0);
+        REQUIRE(buffer.GetTargetDelay() == cTick);
+
+        uint32_t from = 0, to = 0;
+        float alpha = -1.f, ahead = -1.f;
+
+        auto interpolate = [&](const JitterBuffer::Snapshot& acFrom, const JitterBuffer::Snapshot& acTo, float aAlpha)
+        {
+            std::memcpy(&from, acFrom.pData, sizeof(uint32_t));
+            std::memcpy(&to, acTo.pData, sizeof(uint32_t));
+            alpha = aAlpha;
+        };
+
+        auto extrapolate = [&](const JitterBuffer::Snapshot& acNewest, float aTicks)
+        {
+            REQUIRE(acNewest.Size == sizeof(uint32_t));
+            std::memcpy(&from, acNewest.pData, sizeof(uint32_t));
+            ahead = aTicks;
+        };
+
+        // Half way between the fifth and sixth tick, one tick in the past
+        REQUIRE(buffer.Sample(5 * cTick + cTick / 2 + cLatency + cTick, interpolate, extrapolate));
+        REQUIRE(from == 500);
+        REQUIRE(to == 600);
+        REQUIRE(alpha == Approx(0.5f));
+
+        // Played snapshots are gone
+        REQUIRE(buffer.GetCount() == 5);
+        REQUIRE(buffer.Push(3, 3 * cTick + cLatency, (const uint8_t*)&ticks[3], sizeof(uint32_t)) == false);
+
+        REQUIRE(buffer.Sample(12 * cTick + cLatency + cTick, interpolate, extrapolate));
+        REQUIRE(from == 900);
+        REQUIRE(ahead == Approx(3.f));
+
+        REQUIRE(buffer.Push(10, 10 * cTick + cLatency, (const uint8_t*)&ticks[10], sizeof(uint32_t)));
+    }
+
+    GIVEN("Snapshots arriving with jitter")
+    {
+        const uint64_t cNoise = 4 * 1000 * 1000;
+
+        for (uint32_t i = 0; i < 16; ++i)
+            REQUIRE(buffer.Push(i, i * cTick + cLatency + ((i % 2) ? cNoise : 0), (const uint8_t*)&ticks[i], sizeof(uint32_t)));
+
+        REQUIRE(buffer.GetJitter() > 0);
+        REQUIRE(buffer.GetTargetDelay() > cTick);
+
+        // The delay doesn't jump to its target, playback only stretches
+        uint64_t previous = buffer.GetDelay();
+        for (uint64_t time = cLatency; time < cLatency + 16 * cTick; time += cTick / 4)
+        {
+            buffer.Sample(time, [](const JitterBuffer::Snapshot&, const JitterBuffer::Snapshot&, float) {}, [](const JitterBuffer::Snapshot&, float) {});
+
+            REQUIRE(buffer.GetDelay() - previous <= cTick / 40);
+            previous = buffer.GetDelay();
+        }
+
+        REQUIRE(buffer.GetDelay() == buffer.GetTargetDelay());
+    }
+
+    GIVEN("An empty buffer")
+    {
+        REQUIRE(buffer.Sample(0, [](const JitterBuffer::Snapshot&, const JitterBuffer::Snapshot&, float) {}, [](const JitterBuffer::Snapshot&, float) {}) == false);
+    }
+}